@@ -0,0 +1,290 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "./include/arrowipc.h"
+
+using namespace std;
+
+/*
+ * The flatbuffers are built front to back: a table is its vtable, padded
+ * to 8, then the table, and the strings, vectors and tables it points to
+ * are appended after it and patched into its offset fields. Offsets
+ * always point forward, as flatbuffers requires.
+ */
+
+// Message.fbs, Schema.fbs and File.fbs enums
+#define FB_METADATA_V5 (4)
+#define FB_HEADER_SCHEMA (1)
+#define FB_HEADER_RECORD_BATCH (3)
+#define FB_TYPE_INT (2)
+#define FB_TYPE_FLOATING_POINT (3)
+#define FB_TYPE_TIMESTAMP (10)
+#define FB_PRECISION_SINGLE (1)
+#define FB_PRECISION_DOUBLE (2)
+#define FB_TIME_UNIT_SECOND (0)
+
+/**
+ * A table field, size 0 leaves it out. Offset fields are 4 byte
+ * placeholders patched once their target is written.
+ */
+struct FbSlot {
+    int size;
+    uint64_t value;
+    size_t pos;         // set by fbTable
+};
+
+static void fbPad(string &b, size_t align)
+{
+    while (b.size() % align != 0)
+        b += '\0';
+}
+
+template <typename T>
+static void fbPut(string &b, T v)
+{
+    b.append((const char*)&v, sizeof(v));
+}
+
+static void fbPatch(string &b, size_t field, size_t target)
+{
+    uint32_t v = (uint32_t)(target - field);
+    memcpy(&b[field], &v, sizeof(v));
+}
+
+static size_t fbTable(string &b, FbSlot* s, int n)
+{
+    // field offsets within the table, after its vtable offset
+    uint16_t off[16];
+    size_t size = 4;
+    for (int i = 0; i < n; i++) {
+        off[i] = 0;
+        if (s[i].size == 0)
+            continue;
+        size = (size + s[i].size - 1) / s[i].size * s[i].size;
+        off[i] = (uint16_t)size;
+        size += s[i].size;
+    }
+
+    fbPad(b, 2);
+    size_t vt = b.size();
+    fbPut<uint16_t>(b, (uint16_t)(4 + 2 * n));
+    fbPut<uint16_t>(b, (uint16_t)size);
+    for (int i = 0; i < n; i++)
+        fbPut<uint16_t>(b, off[i]);
+
+    fbPad(b, 8);
+    size_t t = b.size();
+    fbPut<int32_t>(b, (int32_t)(t - vt));
+    b.resize(t + size, '\0');
+    for (int i = 0; i < n; i++) {
+        if (s[i].size == 0)
+            continue;
+        s[i].pos = t + off[i];
+        memcpy(&b[s[i].pos], &s[i].value, s[i].size);
+    }
+    return t;
+}
+
+static size_t fbString(string &b, const char* str)
+{
+    fbPad(b, 4);
+    size_t pos = b.size();
+    uint32_t len = (uint32_t)strlen(str);
+    fbPut<uint32_t>(b, len);
+    b.append(str, len);
+    b += '\0';
+    return pos;
+}
+
+// a vector of n offsets, element i is patched at pos + 4 + 4 * i
+static size_t fbOffsetVector(string &b, int n)
+{
+    fbPad(b, 4);
+    size_t pos = b.size();
+    fbPut<uint32_t>(b, (uint32_t)n);
+    b.resize(b.size() + 4 * n, '\0');
+    return pos;
+}
+
+// a vector of 8 byte aligned structs
+static size_t fbStructVector(string &b, const void* p, int n, size_t size)
+{
+    fbPad(b, 4);
+    if ((b.size() + 4) % 8 != 0)
+        fbPut<uint32_t>(b, 0);
+    size_t pos = b.size();
+    fbPut<uint32_t>(b, (uint32_t)n);
+    if (n > 0)
+        b.append((const char*)p, n * size);
+    return pos;
+}
+
+static size_t fbType(string &b, int type, uint8_t* typeId)
+{
+    switch (type) {
+    case ARROW_I32: {
+        FbSlot s[2] = {{4, 32, 0}, {1, 1, 0}};      // bitWidth, is_signed
+        *typeId = FB_TYPE_INT;
+        return fbTable(b, s, 2);
+    }
+    case ARROW_TIMESTAMP_S: {
+        FbSlot s[2] = {{2, FB_TIME_UNIT_SECOND, 0}, {4, 0, 0}};    // unit, timezone
+        *typeId = FB_TYPE_TIMESTAMP;
+        size_t t = fbTable(b, s, 2);
+        fbPatch(b, s[1].pos, fbString(b, "UTC"));
+        return t;
+    }
+    default: {
+        uint64_t precision = type == ARROW_F64 ? FB_PRECISION_DOUBLE : FB_PRECISION_SINGLE;
+        FbSlot s[1] = {{2, precision, 0}};
+        *typeId = FB_TYPE_FLOATING_POINT;
+        return fbTable(b, s, 1);
+    }
+    }
+}
+
+static size_t fbSchema(string &b, const ArrowColumn* cols, int n)
+{
+    // endianness (little), fields
+    FbSlot s[2] = {{2, 0, 0}, {4, 0, 0}};
+    size_t t = fbTable(b, s, 2);
+    size_t fields = fbOffsetVector(b, n);
+    fbPatch(b, s[1].pos, fields);
+
+    for (int i = 0; i < n; i++) {
+        // name, nullable, type_type, type, dictionary, children
+        FbSlot f[6] = {{4, 0, 0}, {1, cols[i].nullable, 0}, {1, 0, 0},
+                       {4, 0, 0}, {0, 0, 0}, {4, 0, 0}};
+        size_t ft = fbTable(b, f, 6);
+        fbPatch(b, fields + 4 + 4 * i, ft);
+        fbPatch(b, f[0].pos, fbString(b, cols[i].name));
+        uint8_t typeId;
+        size_t type = fbType(b, cols[i].type, &typeId);
+        b[f[2].pos] = (char)typeId;
+        fbPatch(b, f[3].pos, type);
+        // readers require the children even when there are none
+        fbPatch(b, f[5].pos, fbOffsetVector(b, 0));
+    }
+    return t;
+}
+
+/**
+ * Wraps the metadata flatbuffer, the body then starts 8 byte aligned.
+ */
+static void encapsulate(string &out, const string &fb)
+{
+    int32_t len = (int32_t)arrowPad((int64_t)fb.size());
+    fbPut<uint32_t>(out, ARROW_CONTINUATION);
+    fbPut<int32_t>(out, len);
+    out += fb;
+    out.resize(out.size() + (len - fb.size()), '\0');
+}
+
+/**
+ * Starts a Message table, returns the header's offset field.
+ */
+static size_t fbMessage(string &b, int header, int64_t bodyLen)
+{
+    b.assign(4, '\0');      // root offset
+    // version, header_type, header, bodyLength
+    FbSlot m[4] = {{2, FB_METADATA_V5, 0}, {1, (uint64_t)header, 0}, {4, 0, 0},
+                   {8, (uint64_t)bodyLen, 0}};
+    fbPatch(b, 0, fbTable(b, m, 4));
+    return m[2].pos;
+}
+
+/**
+ *
+ */
+int arrowWidth(int type)
+{
+    return type == ARROW_F64 || type == ARROW_TIMESTAMP_S ? 8 : 4;
+}
+
+/**
+ *
+ */
+void arrowSchemaMessage(string &out, const ArrowColumn* cols, int n)
+{
+    string b;
+    size_t header = fbMessage(b, FB_HEADER_SCHEMA, 0);
+    fbPatch(b, header, fbSchema(b, cols, n));
+    encapsulate(out, b);
+}
+
+/**
+ *
+ */
+int64_t arrowBatchLayout(int64_t rows, const ArrowColumn* cols,
+                         const int64_t* nulls, int n, ArrowBuffer* bufs)
+{
+    int64_t off = 0;
+    for (int i = 0; i < n; i++) {
+        bufs[2 * i].offset = off;
+        bufs[2 * i].length = nulls[i] > 0 ? (rows + 7) / 8 : 0;
+        off += arrowPad(bufs[2 * i].length);
+        bufs[2 * i + 1].offset = off;
+        bufs[2 * i + 1].length = rows * arrowWidth(cols[i].type);
+        off += arrowPad(bufs[2 * i + 1].length);
+    }
+    return off;
+}
+
+/**
+ *
+ */
+void arrowBatchMessage(string &out, int64_t rows, const int64_t* nulls,
+                       int n, const ArrowBuffer* bufs, int64_t bodyLen)
+{
+    string b;
+    size_t header = fbMessage(b, FB_HEADER_RECORD_BATCH, bodyLen);
+
+    // length, nodes, buffers
+    FbSlot s[3] = {{8, (uint64_t)rows, 0}, {4, 0, 0}, {4, 0, 0}};
+    fbPatch(b, header, fbTable(b, s, 3));
+
+    vector<int64_t> nodes(2 * n);
+    for (int i = 0; i < n; i++) {
+        nodes[2 * i] = rows;
+        nodes[2 * i + 1] = nulls[i];
+    }
+    fbPatch(b, s[1].pos, fbStructVector(b, &nodes[0], n, 2 * sizeof(int64_t)));
+    fbPatch(b, s[2].pos, fbStructVector(b, bufs, 2 * n, sizeof(ArrowBuffer)));
+    encapsulate(out, b);
+}
+
+/**
+ *
+ */
+void arrowFileEnd(string &out, const ArrowColumn* cols, int n,
+                  const vector<ArrowBlock> &batches)
+{
+    fbPut<uint32_t>(out, ARROW_CONTINUATION);
+    fbPut<int32_t>(out, 0);
+
+    // Block is {i64 offset, i32 metaDataLength, pad, i64 bodyLength}
+    vector<char> blocks(batches.size() * 24 + 1, 0);
+    for (size_t i = 0; i < batches.size(); i++) {
+        memcpy(&blocks[24 * i], &batches[i].offset, 8);
+        memcpy(&blocks[24 * i + 8], &batches[i].metaLen, 4);
+        memcpy(&blocks[24 * i + 16], &batches[i].bodyLen, 8);
+    }
+
+    string b(4, '\0');
+    // version, schema, dictionaries, recordBatches
+    FbSlot f[4] = {{2, FB_METADATA_V5, 0}, {4, 0, 0}, {4, 0, 0}, {4, 0, 0}};
+    fbPatch(b, 0, fbTable(b, f, 4));
+    fbPatch(b, f[1].pos, fbSchema(b, cols, n));
+    fbPatch(b, f[2].pos, fbStructVector(b, NULL, 0, 24));
+    fbPatch(b, f[3].pos, fbStructVector(b, &blocks[0], (int)batches.size(), 24));
+    fbPad(b, 8);
+
+    out += b;
+    fbPut<int32_t>(out, (int32_t)b.size());
+    out += ARROW_MAGIC;
+}
@@ -0,0 +1,217 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/stats.h"
+#include "./include/sink.h"
+#include "./include/arrowipc.h"
+#include "./include/arrowsink.h"
+
+using namespace std;
+
+enum {
+    COL_TIME = 0
+    ,COL_WALL
+    ,COL_CYCLE
+    ,NUM_FIXED_COLUMNS
+};
+
+#define MAX_COLUMNS (NUM_FIXED_COLUMNS + MAX_CHANNELS)
+
+static ofstream gArrowFd;
+static SinkStream gStream = {ENC_ARROW, 0, NULL};
+
+// the batch being filled, column by column
+static ArrowColumn gCols[MAX_COLUMNS];
+static int gNumCols;
+static int gRows;
+static int64_t gBatchStart;
+static double gTime[ARROW_BATCH_ROWS];
+static int64_t gWall[ARROW_BATCH_ROWS];
+static int32_t gCycle[ARROW_BATCH_ROWS];
+static char gValues[MAX_CHANNELS][ARROW_BATCH_ROWS * sizeof(double)];
+static uint8_t gValid[MAX_CHANNELS][ARROW_BATCH_ROWS / 8];
+static int64_t gNulls[MAX_COLUMNS];
+
+// file offset of the next message and the batches written so far
+static int64_t gOffset;
+static vector<ArrowBlock> gBatches;
+
+static void emitBatch(void);
+static void appendBuffer(const void* p, const ArrowBuffer &b);
+static void arrowWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void arrowFlush(Sink* s);
+static void arrowClose(Sink* s);
+
+/**
+ * Writes the magic and the schema and registers the file sink.
+ */
+bool arrowSinkOpen(const string &file)
+{
+    if (gArrowFd.is_open())
+        gArrowFd.close();
+
+    gArrowFd.open(file, ofstream::binary | ofstream::trunc);
+    if (!gArrowFd.is_open()) {
+        LPRINTF("DataLogger Plugin: unable to open the arrow file ");
+        LPRINTF(file.c_str()); LPRINTF("\n");
+        return false;
+    }
+    statsAddShared(gStats.filesOpened, 1);
+
+    gCols[COL_TIME].name = "time";
+    gCols[COL_TIME].type = ARROW_F64;
+    gCols[COL_WALL].name = "wall";
+    gCols[COL_WALL].type = ARROW_TIMESTAMP_S;
+    gCols[COL_CYCLE].name = "cycle";
+    gCols[COL_CYCLE].type = ARROW_I32;
+    for (int c = 0; c < NUM_FIXED_COLUMNS; c++)
+        gCols[c].nullable = false;
+    for (int i = 0; i < gChannelCount; i++) {
+        ArrowColumn &col = gCols[NUM_FIXED_COLUMNS + i];
+        col.name = gChannelDefs[i].name;
+        col.type = gChannelDefs[i].type == xplmType_Double ? ARROW_F64 : ARROW_F32;
+        col.nullable = true;
+    }
+    gNumCols = NUM_FIXED_COLUMNS + gChannelCount;
+
+    string hdr(ARROW_MAGIC);
+    hdr.resize(ARROW_PREFIX_SIZE, '\0');
+    arrowSchemaMessage(hdr, gCols, gNumCols);
+    gArrowFd.write(hdr.data(), hdr.size());
+    gOffset = (int64_t)hdr.size();
+    gBatches.clear();
+    gRows = 0;
+    memset(gValid, 0, sizeof(gValid));
+    memset(gNulls, 0, sizeof(gNulls));
+
+    gStream.cur = NULL;
+    if (sinkCreate(ENC_ARROW, gConfig.policy[ENC_ARROW], NULL, arrowWrite,
+                   arrowFlush, arrowClose) == NULL) {
+        gArrowFd.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Adds a row, channels of the groups that weren't sampled are null.
+ */
+void arrowEncode(const Sample &s, uint64_t changed)
+{
+    if (gRows == 0)
+        gBatchStart = s.tick;
+
+    int r = gRows;
+    gTime[r] = s.elapsed;
+    gWall[r] = (int64_t)s.wallTime;
+    gCycle[r] = s.cycle;
+    uint64_t present = channelsInGroups(s.groups);
+    for (int i = 0; i < gChannelCount; i++) {
+        if (present & CHANNEL_BIT(i)) {
+            gValid[i][r >> 3] |= (uint8_t)(1 << (r & 7));
+            if (gCols[NUM_FIXED_COLUMNS + i].type == ARROW_F64) {
+                memcpy(&gValues[i][r * sizeof(double)], &s.ch[i], sizeof(double));
+            } else {
+                float f = (float)s.ch[i];
+                memcpy(&gValues[i][r * sizeof(float)], &f, sizeof(float));
+            }
+        } else {
+            memset(&gValues[i][r * sizeof(double)], 0, sizeof(double));
+            gNulls[NUM_FIXED_COLUMNS + i] += 1;
+        }
+    }
+    gRows += 1;
+
+    if (gRows == ARROW_BATCH_ROWS || s.tick - gBatchStart >= ARROW_BATCH_US)
+        emitBatch();
+}
+
+/**
+ * Writes the last rows, the end of stream marker and the footer, the
+ * writer thread's last call.
+ */
+void arrowEncodeFinish(void)
+{
+    emitBatch();
+    string end;
+    arrowFileEnd(end, gCols, gNumCols, gBatches);
+    sinkAppend(gStream, end.data(), end.size());
+    sinkEnd(gStream);
+}
+
+/**
+ * Publishes the batch's message and body, each column's buffers are
+ * appended straight from the column arrays.
+ */
+void emitBatch(void)
+{
+    if (gRows == 0)
+        return;
+
+    ArrowBuffer bufs[2 * MAX_COLUMNS];
+    int64_t bodyLen = arrowBatchLayout(gRows, gCols, gNulls, gNumCols, bufs);
+    string meta;
+    arrowBatchMessage(meta, gRows, gNulls, gNumCols, bufs, bodyLen);
+    sinkAppend(gStream, meta.data(), meta.size());
+
+    appendBuffer(gTime, bufs[2 * COL_TIME + 1]);
+    appendBuffer(gWall, bufs[2 * COL_WALL + 1]);
+    appendBuffer(gCycle, bufs[2 * COL_CYCLE + 1]);
+    for (int i = 0; i < gChannelCount; i++) {
+        int c = NUM_FIXED_COLUMNS + i;
+        appendBuffer(gValid[i], bufs[2 * c]);
+        appendBuffer(gValues[i], bufs[2 * c + 1]);
+    }
+    sinkEnd(gStream);
+
+    ArrowBlock blk;
+    blk.offset = gOffset;
+    blk.metaLen = (int32_t)meta.size();
+    blk.bodyLen = bodyLen;
+    gBatches.push_back(blk);
+    gOffset += (int64_t)meta.size() + bodyLen;
+
+    memset(gValid, 0, sizeof(gValid[0]) * gChannelCount);
+    memset(gNulls, 0, sizeof(gNulls));
+    gRows = 0;
+}
+
+void appendBuffer(const void* p, const ArrowBuffer &b)
+{
+    static const char zeros[8] = {0};
+    if (b.length == 0)
+        return;
+    sinkAppend(gStream, (const char*)p, (size_t)b.length);
+    if (arrowPad(b.length) > b.length)
+        sinkAppend(gStream, zeros, (size_t)(arrowPad(b.length) - b.length));
+}
+
+void arrowWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    for (int i = 0; i < n; i++) {
+        gArrowFd.write(bufs[i]->data, bufs[i]->len);
+        statsAddShared(gStats.bytesWritten, bufs[i]->len);
+    }
+}
+
+void arrowFlush(Sink* s)
+{
+    gArrowFd.flush();
+}
+
+void arrowClose(Sink* s)
+{
+    gArrowFd.close();
+}
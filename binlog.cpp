@@ -0,0 +1,197 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <fstream>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/stats.h"
+#include "./include/sink.h"
+#include "./include/blockindex.h"
+#include "./include/binlog.h"
+
+using namespace std;
+
+static ofstream gBinFd;
+static SinkStream gStream = {ENC_BINLOG, 0, NULL};
+
+// the index, its sink thread half tracks the file size
+static ofstream gIdxFd;
+static string gIdxPath;
+static uint64_t gFileSize;
+static uint64_t gBlockStart;
+static SinkStream gIdxStream = {ENC_BINLOG, BINLOG_TAG_INDEX, NULL};
+
+// the writer's current block and the last value written of each channel
+static IndexEntry gBlock;
+static double gLast[MAX_CHANNELS];
+static uint64_t gWritten;
+
+template <typename T>
+static inline char* put(char* p, T v)
+{
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static inline bool isDouble(int ch)
+{
+    return gChannelDefs[ch].type == xplmType_Double;
+}
+
+static void closeBlock(void);
+static void binlogWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void binlogFlush(Sink* s);
+static void binlogClose(Sink* s);
+
+/**
+ * Writes the header and registers the file sink.
+ */
+bool binlogOpen(const string &file)
+{
+    if (gBinFd.is_open())
+        gBinFd.close();
+    if (gIdxFd.is_open())
+        gIdxFd.close();
+
+    gBinFd.open(file, ofstream::binary | ofstream::trunc);
+    if (!gBinFd.is_open()) {
+        LPRINTF("DataLogger Plugin: unable to open the binary file ");
+        LPRINTF(file.c_str()); LPRINTF("\n");
+        return false;
+    }
+
+    statsAddShared(gStats.filesOpened, 1);
+
+    string hdr(BINLOG_MAGIC);
+    uint16_t version = BINLOG_VERSION;
+    uint16_t count = (uint16_t)gChannelCount;
+    hdr.append((const char*)&version, sizeof(version));
+    hdr.append((const char*)&count, sizeof(count));
+    for (int i = 0; i < gChannelCount; i++) {
+        size_t len = strlen(gChannelDefs[i].name);
+        hdr += (char)gChannelDefs[i].group;
+        hdr += isDouble(i) ? 'd' : 'f';
+        hdr += (char)len;
+        hdr.append(gChannelDefs[i].name, len);
+        hdr.append((const char*)&gConfig.deadAbs[i], sizeof(float));
+        hdr.append((const char*)&gConfig.deadRel[i], sizeof(float));
+    }
+    gBinFd.write(hdr.data(), hdr.size());
+    gIdxPath = file + string(".idx");
+    gFileSize = hdr.size();
+    gBlockStart = gFileSize;
+    blockIndexReset(gBlock);
+    gWritten = 0;
+
+    gStream.cur = NULL;
+    gIdxStream.cur = NULL;
+    if (sinkCreate(ENC_BINLOG, gConfig.policy[ENC_BINLOG], NULL, binlogWrite,
+                   binlogFlush, binlogClose) == NULL) {
+        gBinFd.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Encodes the changed channels prefixed with their bitmap, channels
+ * that didn't move beyond their deadband and groups that weren't due
+ * aren't repeated, except in a block's first record. A segment break is
+ * written even when nothing moved, the GPX track has it.
+ */
+void binlogEncode(const Sample &s, uint64_t changed)
+{
+    uint8_t flags = (s.flags & SAMPLE_NEW_SEGMENT) ? BINLOG_NEW_SEGMENT : 0;
+    if (changed == 0 && flags == 0)
+        return;
+
+    for (int i = 0; i < gChannelCount; i++) {
+        if (changed & CHANNEL_BIT(i))
+            gLast[i] = s.ch[i];
+    }
+    gWritten |= changed;
+    if (gBlock.count == 0)
+        changed = gWritten;
+
+    char buf[BINLOG_BITMAP_SIZE(MAX_CHANNELS) + 4 + 4 + 4 + 1 + MAX_CHANNELS * sizeof(double)];
+    char* p = buf;
+    for (int b = 0; b < BINLOG_BITMAP_SIZE(gChannelCount); b++)
+        *p++ = (char)(changed >> (b * 8));
+    p = put<uint32_t>(p, (uint32_t)s.wallTime);
+    p = put<uint32_t>(p, (uint32_t)s.cycle);
+    p = put<float>(p, s.elapsed);
+    p = put<uint8_t>(p, flags);
+    p = channelsEncode(p, gLast, changed);
+    sinkAppend(gStream, buf, p - buf);
+
+    blockIndexAdd(gBlock, (uint32_t)s.wallTime, s.elapsed, s.cycle);
+    if (s.groups & GROUP_BIT(GROUP_POSITION))
+        blockIndexPosition(gBlock, s.ch[CH_LAT], s.ch[CH_LON], s.ch[CH_ALT]);
+    gBlock.length += p - buf;
+    if (blockIndexFull(gBlock))
+        closeBlock();
+}
+
+/**
+ *
+ */
+void binlogEncodeEnd(void)
+{
+    sinkEnd(gStream);
+}
+
+/**
+ *
+ */
+void binlogEncodeFinish(void)
+{
+    closeBlock();
+}
+
+/**
+ * Publishes the block's records and then its entry, so the sink thread
+ * sees the entry once the whole block is in the file.
+ */
+void closeBlock(void)
+{
+    if (gBlock.count == 0)
+        return;
+    sinkEnd(gStream);
+    sinkAppend(gIdxStream, (const char*)&gBlock, sizeof(gBlock));
+    sinkEnd(gIdxStream);
+    blockIndexReset(gBlock);
+}
+
+void binlogWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (bufs[i]->tag == BINLOG_TAG_INDEX) {
+            blockIndexWrite(gIdxFd, gIdxPath, bufs[i]->data, gBlockStart, gFileSize);
+            gBlockStart = gFileSize;
+            continue;
+        }
+        gBinFd.write(bufs[i]->data, bufs[i]->len);
+        gFileSize += bufs[i]->len;
+        statsAddShared(gStats.bytesWritten, bufs[i]->len);
+    }
+}
+
+void binlogFlush(Sink* s)
+{
+    gBinFd.flush();
+    gIdxFd.flush();
+}
+
+void binlogClose(Sink* s)
+{
+    gBinFd.close();
+    gIdxFd.close();
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <fstream>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/msgqueue.h"
+#include "./include/stats.h"
+#include "./include/blockindex.h"
+
+using namespace std;
+
+/**
+ * The writer fills in the entry's contents, the sink thread its place in
+ * the file, which only it knows once the block is written.
+ */
+void blockIndexWrite(ofstream &fd, const string &path, const char* entry,
+                     uint64_t start, uint64_t end)
+{
+    if (!fd.is_open()) {
+        fd.open(path, ofstream::binary | ofstream::trunc);
+        if (!fd.is_open()) {
+            msgPost("DataLogger Plugin: unable to open the index file %s\n", path.c_str());
+            return;
+        }
+        string hdr(INDEX_MAGIC);
+        uint16_t version = INDEX_VERSION;
+        uint16_t size = (uint16_t)sizeof(IndexEntry);
+        hdr.append((const char*)&version, sizeof(version));
+        hdr.append((const char*)&size, sizeof(size));
+        fd.write(hdr.data(), hdr.size());
+    }
+
+    IndexEntry e;
+    memcpy(&e, entry, sizeof(e));
+    e.offset = start;
+    e.length = end - start;
+    fd.write((const char*)&e, sizeof(e));
+    statsAddShared(gStats.bytesWritten, sizeof(e));
+}
@@ -0,0 +1,303 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "./SDK/CHeaders/XPLM/XPLMDataAccess.h"
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/channels.h"
+#include "./include/deadband.h"
+#include "./include/schema.h"
+
+using namespace std;
+
+// the built-in channels, in channel order
+#define BUILTIN_CHANNELS \
+    {"lat",      "sim/flightmodel/position/latitude",              xplmType_Double,     0, GROUP_POSITION}     \
+    ,{"lon",      "sim/flightmodel/position/longitude",             xplmType_Double,     0, GROUP_POSITION}    \
+    ,{"alt",      "sim/flightmodel/position/elevation",             xplmType_Double,     0, GROUP_POSITION}    \
+    ,{"gs",       "sim/flightmodel/position/groundspeed",           xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"hdg",      "sim/flightmodel/position/psi",                   xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"pitch",    "sim/flightmodel/position/theta",                 xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"roll",     "sim/flightmodel/position/phi",                   xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"vs",       "sim/flightmodel/position/vh_ind",                xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"ias",      "sim/flightmodel/position/indicated_airspeed",    xplmType_Float,      0, GROUP_POSITION}    \
+    ,{"n1",       "sim/flightmodel/engine/ENGN_N1_",                xplmType_FloatArray, 0, GROUP_ENGINE}      \
+    ,{"rpm",      "sim/cockpit2/engine/indicators/engine_speed_rpm", xplmType_FloatArray, 0, GROUP_ENGINE}     \
+    ,{"egt",      "sim/flightmodel/engine/ENGN_EGT_c",              xplmType_FloatArray, 0, GROUP_ENGINE}      \
+    ,{"ff",       "sim/cockpit2/engine/indicators/fuel_flow_kg_sec", xplmType_FloatArray, 0, GROUP_ENGINE}     \
+    ,{"oilp",     "sim/cockpit2/engine/indicators/oil_pressure_psi", xplmType_FloatArray, 0, GROUP_ENGINE}     \
+    ,{"fuel",     "sim/flightmodel/weight/m_fuel_total",            xplmType_Float,      0, GROUP_ENVIRONMENT} \
+    ,{"wind_spd", "sim/weather/wind_speed_kt",                      xplmType_Float,      0, GROUP_ENVIRONMENT} \
+    ,{"wind_dir", "sim/weather/wind_direction_degt",                xplmType_Float,      0, GROUP_ENVIRONMENT} \
+    ,{"baro",     "sim/weather/barometer_sealevel_inhg",            xplmType_Float,      0, GROUP_ENVIRONMENT} \
+    ,{"oat",      "sim/weather/temperature_ambient_c",              xplmType_Float,      0, GROUP_ENVIRONMENT}
+
+static constexpr ChannelDef gBuiltinDefs[NUM_CHANNELS] = { BUILTIN_CHANNELS };
+
+// defs.h replaces the keyword in release builds
+#ifdef static_assert
+ #undef static_assert
+#endif
+static_assert(BuiltinSchema::count == NUM_CHANNELS && BuiltinSchema::check(gBuiltinDefs),
+              "the channel table doesn't match the schema");
+
+ChannelDef gChannelDefs[MAX_CHANNELS] = { BUILTIN_CHANNELS };
+
+int gChannelCount = NUM_CHANNELS;
+
+const char* gGroupNames[NUM_GROUPS] = {
+    "position"
+    ,"engine"
+    ,"environment"
+};
+
+uint64_t gGroupChannels[NUM_GROUPS];
+
+static XPLMDataRef gChannelRefs[MAX_CHANNELS];
+
+// config file channels, storage for their names and datarefs
+static string gUserNames[MAX_CHANNELS];
+static string gUserDatarefs[MAX_CHANNELS];
+static uint64_t gUserChannels;
+
+static inline int ctz64(uint64_t m)
+{
+#if defined(_MSC_VER) && defined(_M_IX86)
+    // no 64-bit bit scan on x86
+    unsigned long i;
+    if (_BitScanForward(&i, (unsigned long)m))
+        return (int)i;
+    _BitScanForward(&i, (unsigned long)(m >> 32));
+    return (int)i + 32;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, m);
+    return (int)i;
+#else
+    return __builtin_ctzll(m);
+#endif
+}
+
+static double readGeneric(int i);
+
+/**
+ * Adds a channel from a channel.<group>.<name>=<dataref> or
+ * <dataref>[index] config line, the value type is looked up by
+ * channelsInit.
+ */
+bool channelsAdd(const string &group, const string &name, const string &dataref)
+{
+    int g = 0;
+    while (g < NUM_GROUPS && group != gGroupNames[g])
+        g++;
+    if (g == NUM_GROUPS) {
+        LPRINTF("DataLogger Plugin: unknown channel group ");
+        LPRINTF(group.c_str()); LPRINTF("\n");
+        return false;
+    }
+    for (int i = 0; i < gChannelCount; i++) {
+        if (name == gChannelDefs[i].name) {
+            LPRINTF("DataLogger Plugin: duplicate channel ");
+            LPRINTF(name.c_str()); LPRINTF("\n");
+            return false;
+        }
+    }
+    if (gChannelCount == MAX_CHANNELS || name.empty() || dataref.empty()) {
+        LPRINTF("DataLogger Plugin: can't add channel ");
+        LPRINTF(name.c_str()); LPRINTF("\n");
+        return false;
+    }
+
+    int i = gChannelCount++;
+    int index = 0;
+    size_t b = dataref.find('[');
+    gUserNames[i] = name;
+    gUserDatarefs[i] = dataref.substr(0, b);
+    if (b != string::npos)
+        index = atoi(dataref.c_str() + b + 1);
+
+    ChannelDef &def = gChannelDefs[i];
+    def.name = gUserNames[i].c_str();
+    def.dataref = gUserDatarefs[i].c_str();
+    def.type = xplmType_Unknown;
+    def.index = index;
+    def.group = g;
+    gUserChannels |= CHANNEL_BIT(i);
+    return true;
+}
+
+/**
+ * Looks up the channel datarefs and the per-group channel masks.
+ */
+void channelsInit(void)
+{
+    for (int g = 0; g < NUM_GROUPS; g++)
+        gGroupChannels[g] = 0;
+
+    for (int i = 0; i < gChannelCount; i++) {
+        ChannelDef &def = gChannelDefs[i];
+        gChannelRefs[i] = XPLMFindDataRef(def.dataref);
+        if (gChannelRefs[i] == NULL) {
+            LPRINTF("DataLogger Plugin: dataref not found ");
+            LPRINTF(def.dataref); LPRINTF("\n");
+        }
+        if (i >= NUM_CHANNELS) {
+            // prefer the widest scalar, arrays are read at the index
+            XPLMDataTypeID t = gChannelRefs[i] ? XPLMGetDataRefTypes(gChannelRefs[i]) : 0;
+            if (t & xplmType_Double)
+                def.type = xplmType_Double;
+            else if (t & xplmType_Float)
+                def.type = xplmType_Float;
+            else if (t & xplmType_Int)
+                def.type = xplmType_Int;
+            else if (t & xplmType_FloatArray)
+                def.type = xplmType_FloatArray;
+            else if (t & xplmType_IntArray)
+                def.type = xplmType_IntArray;
+            else
+                def.type = xplmType_Unknown;
+        }
+        gGroupChannels[def.group] |= CHANNEL_BIT(i);
+    }
+}
+
+/**
+ *
+ */
+uint64_t channelsInGroups(uint32_t groups)
+{
+    uint64_t mask = 0;
+    for (int g = 0; g < NUM_GROUPS; g++) {
+        if (groups & GROUP_BIT(g))
+            mask |= gGroupChannels[g];
+    }
+    return mask;
+}
+
+/**
+ * Reads the channels of the groups set in the bitmask, the others
+ * are left untouched.
+ */
+void channelsRead(double* ch, uint32_t groups)
+{
+    if (groups & GROUP_BIT(GROUP_POSITION))
+        PositionSchema::read(ch, gChannelRefs);
+    if (groups & GROUP_BIT(GROUP_ENGINE))
+        EngineSchema::read(ch, gChannelRefs);
+    if (groups & GROUP_BIT(GROUP_ENVIRONMENT))
+        EnvironmentSchema::read(ch, gChannelRefs);
+
+    for (uint64_t m = gUserChannels & channelsInGroups(groups); m != 0; m &= m - 1) {
+        int i = ctz64(m);
+        ch[i] = readGeneric(i);
+    }
+}
+
+/**
+ * The deadband moved bits of every channel, see deadband.h.
+ */
+uint64_t channelsMoved(const DeadbandState &st, const double* ch,
+                       const float* absBand, const float* relBand)
+{
+    return BuiltinSchema::moved(st, ch, absBand, relBand) |
+           deadbandMoved(st, ch, absBand, relBand, NUM_CHANNELS, gChannelCount);
+}
+
+/**
+ * Writes the changed channels in channel order, doubles as f64 and
+ * everything else as f32. Returns the end of the output.
+ */
+char* channelsEncode(char* p, const double* ch, uint64_t changed)
+{
+    p = BuiltinSchema::encode(p, ch, changed);
+    return channelsEncodeGeneric(p, ch, changed & gUserChannels);
+}
+
+/**
+ * channelsEncode from the channel table, the path of the config file
+ * channels.
+ */
+char* channelsEncodeGeneric(char* p, const double* ch, uint64_t changed)
+{
+    for (uint64_t m = changed; m != 0; m &= m - 1) {
+        int i = ctz64(m);
+        if (gChannelDefs[i].type == xplmType_Double) {
+            memcpy(p, &ch[i], sizeof(double));
+            p += sizeof(double);
+        } else {
+            float f = (float)ch[i];
+            memcpy(p, &f, sizeof(float));
+            p += sizeof(float);
+        }
+    }
+    return p;
+}
+
+/**
+ * Formats the present channels as "name":value pairs separated by
+ * commas, without the enclosing braces. Returns the length, the output
+ * is truncated to size - 1 and always terminated.
+ */
+size_t channelsFormat(char* out, size_t size, const double* ch, uint64_t present)
+{
+    if (size == 0)
+        return 0;
+    char* end = out + size - 1;
+    char* p = BuiltinSchema::format(out, end, ch, present);
+    p = channelsFormatGeneric(p, end, ch, present & gUserChannels);
+    // drop the trailing comma
+    if (p > out && p[-1] == ',')
+        p--;
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+/**
+ * The "name":value, pairs of the present channels from the channel table,
+ * up to end. Returns the end of the output.
+ */
+char* channelsFormatGeneric(char* p, char* end, const double* ch, uint64_t present)
+{
+    for (uint64_t m = present; m != 0 && p < end; m &= m - 1) {
+        int i = ctz64(m);
+        int n = snprintf(p, end - p, "\"%s\":%.8g,", gChannelDefs[i].name, ch[i]);
+        p = n > 0 && n < end - p ? p + n : end;
+    }
+    return p;
+}
+
+double readGeneric(int i)
+{
+    const ChannelDef &def = gChannelDefs[i];
+    switch (def.type) {
+    case xplmType_Double:
+        return XPLMGetDatad(gChannelRefs[i]);
+    case xplmType_Float:
+        return XPLMGetDataf(gChannelRefs[i]);
+    case xplmType_Int:
+        return XPLMGetDatai(gChannelRefs[i]);
+    case xplmType_FloatArray: {
+        float v = 0.0f;
+        XPLMGetDatavf(gChannelRefs[i], &v, def.index, 1);
+        return v;
+    }
+    case xplmType_IntArray: {
+        int v = 0;
+        XPLMGetDatavi(gChannelRefs[i], &v, def.index, 1);
+        return v;
+    }
+    default:
+        return 0.0;
+    }
+}
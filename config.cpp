@@ -0,0 +1,208 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cmath>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/udpfeed.h"
+#include "./include/gdl90.h"
+#include "./include/nmeasink.h"
+#include "./include/httpd.h"
+
+using namespace std;
+
+Config gConfig = {
+    false,  // traffic
+    false,  // binary
+    false,  // trace
+    false,  // shm
+    false,  // udp
+    "127.0.0.1",            // udpHost
+    UDP_FEED_DEFAULT_PORT,  // udpPort
+    UDP_FEED_DEFAULT_MTU,   // udpMtu
+    false,  // gdl90
+    "255.255.255.255",      // gdl90Host
+    GDL90_DEFAULT_PORT,     // gdl90Port
+    false,  // nmea
+    NMEA_PTY,               // nmeaDevice
+    4800,                   // nmeaBaud
+    1.0f,                   // nmeaRate
+    false,  // http
+    HTTP_DEFAULT_PORT,      // httpPort
+    2.0f,                   // httpRate
+    false,  // arrow
+    false,  // sqlite
+    "",                     // sqliteFile
+    {10.0f, 2.0f, 0.1f},    // rate: position, engine, environment
+    10.0f,                  // panelMinutes
+    // files wait for a slow disk, a live feed drops what it can't send
+    {SINK_BLOCK, SINK_BLOCK, SINK_DROP, SINK_DROP, SINK_DROP, SINK_DROP, SINK_BLOCK, SINK_BLOCK},
+    {0.0f},                 // deadAbs, any change is written
+    {0.0f},                 // deadRel
+};
+
+// deadband.<channel> lines, resolved once every line is read
+static vector<pair<string, string> > gDeadbands;
+
+static string trim(const string &s)
+{
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+/**
+ * Parses one key=value line, lines starting with # are comments.
+ */
+void configParseLine(const string &line)
+{
+    string l = trim(line);
+    if (l.empty() || l[0] == '#')
+        return;
+
+    size_t eq = l.find('=');
+    if (eq == string::npos) {
+        LPRINTF("DataLogger Plugin: ignoring config line ");
+        LPRINTF(l.c_str()); LPRINTF("\n");
+        return;
+    }
+    string key = trim(l.substr(0, eq));
+    string val = trim(l.substr(eq + 1));
+
+    if (key == "traffic") {
+        gConfig.traffic = atoi(val.c_str()) != 0;
+    } else if (key == "binary") {
+        gConfig.binary = atoi(val.c_str()) != 0;
+    } else if (key == "trace") {
+        gConfig.trace = atoi(val.c_str()) != 0;
+    } else if (key == "shm") {
+        gConfig.shm = atoi(val.c_str()) != 0;
+    } else if (key == "udp") {
+        gConfig.udp = atoi(val.c_str()) != 0;
+    } else if (key == "udp.host") {
+        gConfig.udpHost = val;
+    } else if (key == "udp.port") {
+        gConfig.udpPort = atoi(val.c_str());
+    } else if (key == "udp.mtu") {
+        gConfig.udpMtu = atoi(val.c_str());
+    } else if (key == "gdl90") {
+        gConfig.gdl90 = atoi(val.c_str()) != 0;
+    } else if (key == "gdl90.host") {
+        gConfig.gdl90Host = val;
+    } else if (key == "gdl90.port") {
+        gConfig.gdl90Port = atoi(val.c_str());
+    } else if (key == "nmea") {
+        gConfig.nmea = atoi(val.c_str()) != 0;
+    } else if (key == "nmea.device") {
+        gConfig.nmeaDevice = val;
+    } else if (key == "nmea.baud") {
+        gConfig.nmeaBaud = atoi(val.c_str());
+    } else if (key == "nmea.rate") {
+        gConfig.nmeaRate = (float)atof(val.c_str());
+    } else if (key == "http") {
+        gConfig.http = atoi(val.c_str()) != 0;
+    } else if (key == "http.port") {
+        gConfig.httpPort = atoi(val.c_str());
+    } else if (key == "http.rate") {
+        gConfig.httpRate = (float)atof(val.c_str());
+    } else if (key == "arrow") {
+        gConfig.arrow = atoi(val.c_str()) != 0;
+    } else if (key == "sqlite") {
+        gConfig.sqlite = atoi(val.c_str()) != 0;
+    } else if (key == "sqlite.file") {
+        gConfig.sqliteFile = val;
+    } else if (key == "panel.minutes") {
+        gConfig.panelMinutes = (float)atof(val.c_str());
+    } else if (key.compare(0, 7, "policy.") == 0) {
+        for (int e = 0; e < NUM_ENCODINGS; e++) {
+            if (key.compare(7, string::npos, gEncodingNames[e]) == 0) {
+                gConfig.policy[e] = val == "block" ? SINK_BLOCK : SINK_DROP;
+                return;
+            }
+        }
+        LPRINTF("DataLogger Plugin: unknown sink ");
+        LPRINTF(key.c_str()); LPRINTF("\n");
+    } else if (key.compare(0, 5, "rate.") == 0) {
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            if (key.compare(5, string::npos, gGroupNames[g]) == 0) {
+                gConfig.rate[g] = (float)atof(val.c_str());
+                return;
+            }
+        }
+        LPRINTF("DataLogger Plugin: unknown channel group ");
+        LPRINTF(key.c_str()); LPRINTF("\n");
+    } else if (key.compare(0, 8, "channel.") == 0) {
+        // channel.<group>.<name>=<dataref>[index]
+        size_t dot = key.find('.', 8);
+        if (dot == string::npos) {
+            LPRINTF("DataLogger Plugin: ignoring config line ");
+            LPRINTF(l.c_str()); LPRINTF("\n");
+            return;
+        }
+        channelsAdd(key.substr(8, dot - 8), key.substr(dot + 1), val);
+    } else if (key.compare(0, 9, "deadband.") == 0) {
+        // a user channel's line can come later
+        gDeadbands.push_back(make_pair(key.substr(9), val));
+    } else {
+        LPRINTF("DataLogger Plugin: unknown config key ");
+        LPRINTF(key.c_str()); LPRINTF("\n");
+    }
+}
+
+/**
+ * Applies the deadband lines, after the last line so they can name a
+ * channel defined further down.
+ */
+void configParseDone(void)
+{
+    for (size_t d = 0; d < gDeadbands.size(); d++) {
+        const string &name = gDeadbands[d].first;
+        const string &val = gDeadbands[d].second;
+        int i = 0;
+        while (i < gChannelCount && name != gChannelDefs[i].name)
+            i++;
+        if (i == gChannelCount) {
+            LPRINTF("DataLogger Plugin: unknown channel deadband.");
+            LPRINTF(name.c_str()); LPRINTF("\n");
+            continue;
+        }
+        float v = (float)fabs(atof(val.c_str()));
+        if (!val.empty() && val.back() == '%') {
+            gConfig.deadRel[i] = v / 100.0f;
+            gConfig.deadAbs[i] = 0.0f;
+        } else {
+            gConfig.deadAbs[i] = v;
+            gConfig.deadRel[i] = 0.0f;
+        }
+    }
+    gDeadbands.clear();
+}
+
+/**
+ * Splits a comma separated list, empty items are skipped.
+ */
+vector<string> configSplit(const string &list)
+{
+    vector<string> items;
+    size_t b = 0;
+    while (b <= list.size()) {
+        size_t e = list.find(',', b);
+        if (e == string::npos)
+            e = list.size();
+        string item = trim(list.substr(b, e - b));
+        if (!item.empty())
+            items.push_back(item);
+        b = e + 1;
+    }
+    return items;
+}
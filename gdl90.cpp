@@ -0,0 +1,209 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <cmath>
+#include <cstring>
+
+#include "./include/gdl90.h"
+
+static uint16_t gCrcTable[256];
+
+static inline uint8_t* put24(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 16);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)v;
+    return p + 3;
+}
+
+static inline uint32_t get24(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static inline long clampRound(double v, long lo, long hi)
+{
+    long r = lround(v);
+    return r < lo ? lo : (r > hi ? hi : r);
+}
+
+/**
+ * Fills the CRC-16-CCITT (0x1021) table, call once before encoding.
+ */
+void gdl90Init(void)
+{
+    for (int i = 0; i < 256; i++) {
+        uint16_t crc = (uint16_t)(i << 8);
+        for (int b = 0; b < 8; b++)
+            crc = (uint16_t)((crc << 1) ^ ((crc & 0x8000) ? 0x1021 : 0));
+        gCrcTable[i] = crc;
+    }
+}
+
+/**
+ *
+ */
+uint16_t gdl90Crc(const uint8_t* p, size_t n)
+{
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; i++)
+        crc = (uint16_t)(gCrcTable[crc >> 8] ^ (crc << 8) ^ p[i]);
+    return crc;
+}
+
+int32_t gdl90Semicircles(double deg)
+{
+    // truncated like the examples in the specification
+    double v = deg * (0x800000 / 180.0);
+    return v < -0x800000 ? -0x800000 : (v > 0x7fffff ? 0x7fffff : (int32_t)v);
+}
+
+uint16_t gdl90Altitude(double ft)
+{
+    return (uint16_t)clampRound((ft + 1000.0) / 25.0, 0, 0xffe);
+}
+
+uint16_t gdl90HorizVelocity(double kt)
+{
+    return (uint16_t)clampRound(kt, 0, 0xffe);
+}
+
+int16_t gdl90VertVelocity(double fpm)
+{
+    // +-32576 fpm is the largest encodable rate
+    return (int16_t)clampRound(fpm / 64.0, -0x1fe, 0x1fe);
+}
+
+uint8_t gdl90Track(double deg)
+{
+    double d = fmod(deg, 360.0);
+    if (d < 0.0)
+        d += 360.0;
+    return (uint8_t)((long)lround(d * (256.0 / 360.0)) & 0xff);
+}
+
+/**
+ *
+ */
+size_t gdl90EncodeHeartbeat(uint8_t* msg, bool gpsValid, uint32_t secsOfDay)
+{
+    msg[0] = GDL90_MSG_HEARTBEAT;
+    msg[1] = (uint8_t)((gpsValid ? 0x80 : 0x00) | 0x01);   // uat initialized
+    msg[2] = (uint8_t)(((secsOfDay >> 16) & 0x01) << 7 | 0x01); // utc ok
+    msg[3] = (uint8_t)secsOfDay;
+    msg[4] = (uint8_t)(secsOfDay >> 8);
+    msg[5] = 0;     // no uplink/basic/long messages received
+    msg[6] = 0;
+    return GDL90_HEARTBEAT_SIZE;
+}
+
+/**
+ *
+ */
+size_t gdl90EncodeReport(uint8_t* msg, uint8_t id, const Gdl90Report &r)
+{
+    uint8_t* p = msg;
+    *p++ = id;
+    *p++ = (uint8_t)((r.status & 0x0f) << 4 | (r.addrType & 0x0f));
+    p = put24(p, r.address);
+    p = put24(p, (uint32_t)r.lat);
+    p = put24(p, (uint32_t)r.lon);
+    *p++ = (uint8_t)(r.alt >> 4);
+    *p++ = (uint8_t)((r.alt & 0x0f) << 4 | (r.misc & 0x0f));
+    *p++ = (uint8_t)((r.nic & 0x0f) << 4 | (r.nacp & 0x0f));
+    *p++ = (uint8_t)(r.hvel >> 4);
+    *p++ = (uint8_t)((r.hvel & 0x0f) << 4 | ((uint16_t)r.vvel >> 8 & 0x0f));
+    *p++ = (uint8_t)r.vvel;
+    *p++ = r.track;
+    *p++ = r.emitter;
+    memcpy(p, r.callsign, 8);
+    p += 8;
+    *p++ = (uint8_t)((r.priority & 0x0f) << 4);
+    return (size_t)(p - msg);
+}
+
+/**
+ *
+ */
+size_t gdl90EncodeGeoAltitude(uint8_t* msg, double ft, uint16_t vfomMeters)
+{
+    int16_t alt = (int16_t)clampRound(ft / 5.0, -0x8000, 0x7fff);
+    msg[0] = GDL90_MSG_GEO_ALTITUDE;
+    msg[1] = (uint8_t)((uint16_t)alt >> 8);
+    msg[2] = (uint8_t)alt;
+    msg[3] = (uint8_t)(vfomMeters >> 8 & 0x7f);  // no vertical warning
+    msg[4] = (uint8_t)vfomMeters;
+    return GDL90_GEO_ALTITUDE_SIZE;
+}
+
+/**
+ * Splits an ownship or traffic message back into its fields.
+ */
+bool gdl90DecodeReport(const uint8_t* msg, size_t n, Gdl90Report &r)
+{
+    if (n != GDL90_REPORT_SIZE ||
+        (msg[0] != GDL90_MSG_OWNSHIP && msg[0] != GDL90_MSG_TRAFFIC))
+        return false;
+
+    const uint8_t* p = msg + 1;
+    r.status = p[0] >> 4;
+    r.addrType = p[0] & 0x0f;
+    r.address = get24(p + 1);
+    // sign extend the 24 bit values
+    r.lat = (int32_t)(get24(p + 4) << 8) >> 8;
+    r.lon = (int32_t)(get24(p + 7) << 8) >> 8;
+    r.alt = (uint16_t)(p[10] << 4 | p[11] >> 4);
+    r.misc = p[11] & 0x0f;
+    r.nic = p[12] >> 4;
+    r.nacp = p[12] & 0x0f;
+    r.hvel = (uint16_t)(p[13] << 4 | p[14] >> 4);
+    r.vvel = (int16_t)((uint16_t)((p[14] & 0x0f) << 12 | p[15] << 4)) >> 4;
+    r.track = p[16];
+    r.emitter = p[17];
+    memcpy(r.callsign, p + 18, 8);
+    r.priority = p[26] >> 4;
+    return true;
+}
+
+/**
+ *
+ */
+size_t gdl90Frame(uint8_t* out, const uint8_t* msg, size_t n)
+{
+    uint16_t crc = gdl90Crc(msg, n);
+    uint8_t* p = out;
+    *p++ = GDL90_FLAG;
+    for (size_t i = 0; i < n + 2; i++) {
+        uint8_t b = i < n ? msg[i] : (uint8_t)(i == n ? crc : crc >> 8);
+        if (b == GDL90_FLAG || b == GDL90_ESCAPE) {
+            *p++ = GDL90_ESCAPE;
+            b ^= 0x20;
+        }
+        *p++ = b;
+    }
+    *p++ = GDL90_FLAG;
+    return (size_t)(p - out);
+}
+
+/**
+ *
+ */
+size_t gdl90Unframe(uint8_t* msg, const uint8_t* in, size_t n)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = in[i];
+        if (b == GDL90_ESCAPE) {
+            if (++i == n)
+                return 0;
+            b = in[i] ^ 0x20;
+        }
+        msg[len++] = b;
+    }
+    if (len < 3)
+        return 0;
+    len -= 2;
+    uint16_t crc = (uint16_t)(msg[len] | msg[len + 1] << 8);
+    return gdl90Crc(msg, len) == crc ? len : 0;
+}
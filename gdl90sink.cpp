@@ -0,0 +1,184 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include "./include/defs.h"
+#include "./include/geo.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/sink.h"
+#include "./include/net.h"
+#include "./include/gdl90.h"
+#include "./include/gdl90sink.h"
+
+using namespace std;
+
+// the usual EFB cadence, samples are steady clock microseconds
+#define GDL90_HEARTBEAT_US (1000000)
+#define GDL90_REPORT_US (200000)
+
+#define GDL90_OWNSHIP_ADDRESS (0xf00000)
+#define GDL90_EMITTER_LIGHT (1)
+#define GDL90_NIC (11)      // < 7.5 m containment
+#define GDL90_NACP (11)     // < 3 m accuracy
+#define GDL90_VFOM_M (10)
+#define GDL90_AIRBORNE_KT (40.0)
+
+/**
+ * Multiplayer planes only publish their position, the velocity
+ * fields of a traffic report are derived from consecutive positions.
+ */
+struct TrafficTrack {
+    double lat;
+    double lon;
+    double alt;
+    float elapsed;
+    double speedKt;
+    double vsFpm;
+    double track;
+    bool valid;
+};
+
+static int64_t gNextHeartbeat;
+static int64_t gNextReport;
+static TrafficTrack gTraffic[MAX_TRAFFIC];
+
+static size_t addReport(uint8_t* out, size_t off, uint8_t id,
+                        uint32_t address, double lat, double lon,
+                        double altFt, double speedKt, double vsFpm,
+                        double track, uint8_t trackType,
+                        const char* callsign);
+static void updateTraffic(TrafficTrack &t, double lat, double lon,
+                          double alt, float elapsed);
+
+/**
+ * Registers a net sink per host, all of them share the datagrams.
+ */
+bool gdl90SinkOpen(const string &hosts, int port)
+{
+    gdl90Init();
+    gNextHeartbeat = 0;
+    gNextReport = 0;
+    memset(gTraffic, 0, sizeof(gTraffic));
+    return netSinkOpen(ENC_GDL90, hosts, port);
+}
+
+/**
+ * Sends a heartbeat once a second and the ownship and traffic reports
+ * five times a second, riding on the position samples. All messages due
+ * at a sample go out in one datagram.
+ */
+void gdl90Encode(const Sample &s, uint64_t changed)
+{
+    if (!(s.groups & GROUP_BIT(GROUP_POSITION)))
+        return;
+
+    // traffic velocities are tracked at the sample rate
+    for (int i = 0; i < s.trafficCount; i++)
+        updateTraffic(gTraffic[i], s.trafficLat[i], s.trafficLon[i],
+                      s.trafficAlt[i], s.elapsed);
+
+    if (s.tick < gNextReport)
+        return;
+    gNextReport += GDL90_REPORT_US;
+    if (gNextReport <= s.tick)
+        gNextReport = s.tick + GDL90_REPORT_US;
+
+    // at most 3 + MAX_TRAFFIC frames, well within a buffer
+    SinkBuffer* b = sinkBufferGet(0);
+    uint8_t* out = (uint8_t*)b->data;
+    uint8_t msg[GDL90_REPORT_SIZE];
+    size_t off = 0;
+    bool gpsValid = s.ch[CH_LAT] != 0.0 || s.ch[CH_LON] != 0.0;
+
+    if (s.tick >= gNextHeartbeat) {
+        gNextHeartbeat = s.tick + GDL90_HEARTBEAT_US;
+        size_t n = gdl90EncodeHeartbeat(msg, gpsValid,
+                                        (uint32_t)(s.wallTime % 86400));
+        off += gdl90Frame(out + off, msg, n);
+    }
+
+    // X-Plane's elevation is geometric, it stands in for the pressure
+    // altitude as well
+    double altFt = s.ch[CH_ALT] / METERS_PER_FOOT;
+    off = addReport(out, off, GDL90_MSG_OWNSHIP, GDL90_OWNSHIP_ADDRESS,
+                    s.ch[CH_LAT], s.ch[CH_LON], altFt,
+                    s.ch[CH_GS] * MPS_TO_KNOTS,
+                    s.ch[CH_VS] / METERS_PER_FOOT * 60.0,
+                    s.ch[CH_HDG], GDL90_TT_TRUE_HEADING, "DATALOG");
+    size_t n = gdl90EncodeGeoAltitude(msg, altFt, GDL90_VFOM_M);
+    off += gdl90Frame(out + off, msg, n);
+
+    for (int i = 0; i < s.trafficCount; i++) {
+        const TrafficTrack &t = gTraffic[i];
+        if (!t.valid)
+            continue;
+        char callsign[16];
+        snprintf(callsign, sizeof(callsign), "AI%02d", i + 1);
+        off = addReport(out, off, GDL90_MSG_TRAFFIC, GDL90_OWNSHIP_ADDRESS + i + 1,
+                        t.lat, t.lon, t.alt / METERS_PER_FOOT, t.speedKt,
+                        t.vsFpm, t.track, GDL90_TT_TRUE_TRACK, callsign);
+    }
+
+    b->len = off;
+    sinkPublish(ENC_GDL90, b);
+}
+
+size_t addReport(uint8_t* out, size_t off, uint8_t id, uint32_t address,
+                 double lat, double lon, double altFt, double speedKt,
+                 double vsFpm, double track, uint8_t trackType,
+                 const char* callsign)
+{
+    Gdl90Report r;
+    memset(&r, 0, sizeof(r));
+    r.address = address;
+    r.lat = gdl90Semicircles(lat);
+    r.lon = gdl90Semicircles(lon);
+    r.alt = gdl90Altitude(altFt);
+    r.misc = trackType | (speedKt > GDL90_AIRBORNE_KT ? GDL90_MISC_AIRBORNE : 0);
+    r.nic = GDL90_NIC;
+    r.nacp = GDL90_NACP;
+    r.hvel = gdl90HorizVelocity(speedKt);
+    r.vvel = gdl90VertVelocity(vsFpm);
+    r.track = gdl90Track(track);
+    r.emitter = GDL90_EMITTER_LIGHT;
+    memset(r.callsign, ' ', sizeof(r.callsign));
+    memcpy(r.callsign, callsign, min(strlen(callsign), sizeof(r.callsign)));
+
+    uint8_t msg[GDL90_REPORT_SIZE];
+    size_t n = gdl90EncodeReport(msg, id, r);
+    return off + gdl90Frame(out + off, msg, n);
+}
+
+void updateTraffic(TrafficTrack &t, double lat, double lon, double alt,
+                   float elapsed)
+{
+    // unused multiplayer slots sit at the origin
+    if (lat == 0.0 && lon == 0.0) {
+        t.valid = false;
+        return;
+    }
+
+    // elapsed sim time doesn't advance while paused, keep the last
+    // velocity until the plane moves again
+    float dt = elapsed - t.elapsed;
+    if (t.valid && dt > 0.0f) {
+        double d = haversine(t.lat, t.lon, lat, lon);
+        t.speedKt = d / dt * MPS_TO_KNOTS;
+        t.vsFpm = (alt - t.alt) / METERS_PER_FOOT / dt * 60.0;
+        if (d > 0.5)
+            t.track = bearing(t.lat, t.lon, lat, lon);
+    } else if (!t.valid) {
+        t.speedKt = t.vsFpm = t.track = 0.0;
+    }
+    t.lat = lat;
+    t.lon = lon;
+    t.alt = alt;
+    t.elapsed = elapsed;
+    t.valid = true;
+}
@@ -0,0 +1,632 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#if LIN
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/sink.h"
+#include "./include/metrics.h"
+#include "./include/httpd.h"
+
+using namespace std;
+
+#define HTTP_EVENT_PREFIX "data: "
+
+// the writer's side: the latest value of every channel sampled so far
+static int64_t gPeriodUs;
+static int64_t gNext;
+static double gLast[MAX_CHANNELS];
+static uint64_t gSeen;
+
+#if LIN
+
+#define HTTP_EVENT_QUEUE (64)       // sink thread to server, power of two
+#define HTTP_CLIENT_QUEUE (32)      // events waiting on a slow client
+#define HTTP_REQUEST_MAX (2048)
+#define HTTP_LISTEN_ID (HTTP_MAX_CLIENTS)
+#define HTTP_WAKE_ID (HTTP_MAX_CLIENTS + 1)
+
+/**
+ * Part of a shared sink buffer queued on a client, holding a reference.
+ */
+struct HttpChunk {
+    SinkBuffer* b;
+    uint32_t off;
+    uint32_t end;
+};
+
+/**
+ * A connection, sent in order: the response header, a static body,
+ * the queued chunks and then the file. Everything but /events closes
+ * once it's sent.
+ */
+struct HttpClient {
+    int fd;                 // -1 when the slot is free
+    bool handled;           // the request was answered
+    bool stream;            // /events
+    size_t inLen;
+    char in[HTTP_REQUEST_MAX];
+    size_t hdrOff;
+    size_t hdrLen;
+    char hdr[512];
+    const char* body;
+    size_t bodyOff;
+    size_t bodyLen;
+    HttpChunk q[HTTP_CLIENT_QUEUE];
+    int qHead;
+    int qCount;
+    int file;
+    off_t fileOff;
+    off_t fileEnd;
+};
+
+static const char gPage[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>DataLogger</title>"
+    "<style>body{font:14px monospace}td{padding:0 1em}</style></head><body>"
+    "<h3>DataLogger <span id=\"s\">connecting</span></h3><table id=\"v\"></table>"
+    "<p><a href=\"/session.gpx\">session.gpx</a> <a href=\"/session.dlb\">session.dlb</a>"
+    " <a href=\"/snapshot\">snapshot</a></p><script>"
+    "var es=new EventSource('/events'),v=document.getElementById('v'),"
+    "s=document.getElementById('s'),rows={};"
+    "es.onopen=function(){s.textContent='live'};"
+    "es.onerror=function(){s.textContent='waiting'};"
+    "es.onmessage=function(e){var d=JSON.parse(e.data);for(var k in d){"
+    "if(!rows[k]){var r=v.insertRow();r.insertCell().textContent=k;"
+    "rows[k]=r.insertCell()}rows[k].textContent=d[k]}};"
+    "</script></body></html>\n";
+
+static const char gNotFound[] = "not found\n";
+static const char gNoData[] = "no samples yet\n";
+static const char gBadRequest[] = "bad request\n";
+
+static HttpClient gClients[HTTP_MAX_CLIENTS];
+static SpscRing<SinkBuffer*, HTTP_EVENT_QUEUE> gEvents;
+static SinkBuffer* gLatest = NULL;  // server thread, the last event
+static char gMetrics[METRICS_MAX_SIZE];  // server thread, scrape scratch
+static mutex gSessionLock;
+static string gGpxPath;
+static string gDlbPath;
+static int gListen = -1;
+static int gEpoll = -1;
+static int gWake = -1;
+static thread gServer;
+static atomic<bool> gServerRun(false);
+
+static void serverLoop(void);
+static void acceptClients(void);
+static void takeEvents(void);
+static void readRequest(HttpClient &c);
+static void handleRequest(HttpClient &c);
+static void respond(HttpClient &c, int status, const char* type, size_t len,
+                    const char* body);
+static void sendFile(HttpClient &c, const string &path, const char* type);
+static void sendMetrics(HttpClient &c);
+static bool enqueue(HttpClient &c, SinkBuffer* b, uint32_t off, uint32_t end);
+static void flushClient(HttpClient &c);
+static void closeClient(HttpClient &c);
+static void httpWrite(Sink* s, SinkBuffer* const* bufs, int n);
+
+/**
+ * Listens on the loopback interface only, nothing leaves the machine.
+ */
+bool httpStart(int port)
+{
+    if (gServerRun.load())
+        return true;
+
+    gListen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (gListen < 0) {
+        LPRINTF("DataLogger Plugin: unable to create the http socket...\n");
+        return false;
+    }
+    int on = 1;
+    setsockopt(gListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(gListen, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(gListen, 16) != 0) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "DataLogger Plugin: unable to listen on http port %d\n", port);
+        LPRINTF(buf);
+        close(gListen);
+        gListen = -1;
+        return false;
+    }
+
+    gEpoll = epoll_create1(EPOLL_CLOEXEC);
+    gWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = HTTP_LISTEN_ID;
+    epoll_ctl(gEpoll, EPOLL_CTL_ADD, gListen, &ev);
+    ev.data.u32 = HTTP_WAKE_ID;
+    epoll_ctl(gEpoll, EPOLL_CTL_ADD, gWake, &ev);
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        gClients[i].fd = -1;
+        gClients[i].file = -1;
+        gClients[i].qCount = 0;
+    }
+
+    gServerRun.store(true);
+    gServer = thread(serverLoop);
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "DataLogger Plugin: live telemetry on http://127.0.0.1:%d/\n", port);
+    LPRINTF(buf);
+    return true;
+}
+
+/**
+ * Stops the server thread and closes every connection.
+ */
+void httpStop(void)
+{
+    if (!gServerRun.load())
+        return;
+    gServerRun.store(false);
+    uint64_t one = 1;
+    if (write(gWake, &one, sizeof(one)) < 0)
+        LPRINTF("DataLogger Plugin: unable to wake the http server...\n");
+    if (gServer.joinable())
+        gServer.join();
+
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        if (gClients[i].fd >= 0)
+            closeClient(gClients[i]);
+    }
+    SinkBuffer** b;
+    while ((b = gEvents.front()) != NULL) {
+        sinkBufferPut(*b);
+        gEvents.pop();
+    }
+    if (gLatest != NULL)
+        sinkBufferPut(gLatest);
+    gLatest = NULL;
+    close(gWake);
+    close(gEpoll);
+    close(gListen);
+    gWake = gEpoll = gListen = -1;
+}
+
+/**
+ *
+ */
+bool httpSinkOpen(const string &gpx, const string &dlb, float rate)
+{
+    {
+        lock_guard<mutex> lock(gSessionLock);
+        gGpxPath = gpx;
+        gDlbPath = dlb;
+    }
+    gPeriodUs = (int64_t)(1.0e6f / (rate > 0.0f ? rate : 1.0f));
+    gNext = 0;
+    gSeen = 0;
+    if (!gServerRun.load())
+        return false;
+    return sinkCreate(ENC_HTTP, gConfig.policy[ENC_HTTP], NULL, httpWrite,
+                      NULL, NULL) != NULL;
+}
+
+/**
+ * Hands the events to the server thread, their references move with
+ * them. The sink is the ring's only producer.
+ */
+void httpWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    for (int i = 0; i < n; i++) {
+        SinkBuffer** slot = gEvents.claim();
+        if (slot == NULL) {
+            s->dropped += 1;
+            continue;
+        }
+        bufs[i]->refs.fetch_add(1, memory_order_relaxed);
+        *slot = bufs[i];
+        gEvents.commit();
+    }
+    uint64_t one = 1;
+    if (write(gWake, &one, sizeof(one)) < 0)
+        return;     // the counter is already non-zero
+}
+
+void serverLoop(void)
+{
+    struct epoll_event evs[16];
+    while (gServerRun.load()) {
+        int n = epoll_wait(gEpoll, evs, 16, 1000);
+        for (int i = 0; i < n; i++) {
+            uint32_t id = evs[i].data.u32;
+            if (id == HTTP_LISTEN_ID) {
+                acceptClients();
+            } else if (id == HTTP_WAKE_ID) {
+                uint64_t v;
+                if (read(gWake, &v, sizeof(v)) > 0)
+                    takeEvents();
+            } else {
+                HttpClient &c = gClients[id];
+                if (c.fd < 0)
+                    continue;
+                if (evs[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeClient(c);
+                    continue;
+                }
+                if (evs[i].events & (EPOLLIN | EPOLLRDHUP))
+                    readRequest(c);
+                if (c.fd >= 0)
+                    flushClient(c);
+            }
+        }
+    }
+}
+
+void acceptClients(void)
+{
+    for (;;) {
+        int fd = accept4(gListen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int i = 0;
+        while (i < HTTP_MAX_CLIENTS && gClients[i].fd >= 0)
+            i++;
+        if (i == HTTP_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        HttpClient &c = gClients[i];
+        c.fd = fd;
+        c.handled = false;
+        c.stream = false;
+        c.inLen = 0;
+        c.hdrOff = c.hdrLen = 0;
+        c.body = NULL;
+        c.bodyOff = c.bodyLen = 0;
+        c.qHead = c.qCount = 0;
+        c.file = -1;
+        c.fileOff = c.fileEnd = 0;
+
+        // edge triggered, the handlers read and write until EAGAIN
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(gEpoll, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/**
+ * The newest event becomes the snapshot and is queued, not copied, on
+ * every stream client. A client whose queue is full misses the event.
+ */
+void takeEvents(void)
+{
+    SinkBuffer** b;
+    bool any = false;
+    while ((b = gEvents.front()) != NULL) {
+        SinkBuffer* ev = *b;
+        gEvents.pop();
+        for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+            HttpClient &c = gClients[i];
+            if (c.fd >= 0 && c.stream)
+                enqueue(c, ev, 0, (uint32_t)ev->len);
+        }
+        if (gLatest != NULL)
+            sinkBufferPut(gLatest);
+        gLatest = ev;
+        any = true;
+    }
+    if (!any)
+        return;
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        HttpClient &c = gClients[i];
+        if (c.fd >= 0 && c.stream && c.qCount > 0)
+            flushClient(c);
+    }
+}
+
+void readRequest(HttpClient &c)
+{
+    for (;;) {
+        char discard[512];
+        char* p = c.handled ? discard : c.in + c.inLen;
+        size_t room = c.handled ? sizeof(discard) : sizeof(c.in) - 1 - c.inLen;
+        if (room == 0) {
+            c.handled = true;
+            respond(c, 400, "text/plain", sizeof(gBadRequest) - 1, gBadRequest);
+            return;
+        }
+        ssize_t r = recv(c.fd, p, room, 0);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            closeClient(c);
+            return;
+        }
+        if (r < 0)
+            return;
+        if (c.handled)
+            continue;
+        c.inLen += (size_t)r;
+        c.in[c.inLen] = '\0';
+        if (strstr(c.in, "\r\n\r\n") != NULL || strstr(c.in, "\n\n") != NULL) {
+            c.handled = true;
+            handleRequest(c);
+        }
+    }
+}
+
+void handleRequest(HttpClient &c)
+{
+    char method[8];
+    char path[256];
+    if (sscanf(c.in, "%7s %255s", method, path) != 2) {
+        respond(c, 400, "text/plain", sizeof(gBadRequest) - 1, gBadRequest);
+        return;
+    }
+    char* q = strchr(path, '?');
+    if (q != NULL)
+        *q = '\0';
+    if (strcmp(method, "GET") != 0) {
+        respond(c, 405, "text/plain", sizeof(gBadRequest) - 1, gBadRequest);
+        return;
+    }
+
+    if (strcmp(path, "/") == 0) {
+        respond(c, 200, "text/html; charset=utf-8", sizeof(gPage) - 1, gPage);
+    } else if (strcmp(path, "/snapshot") == 0) {
+        if (gLatest == NULL) {
+            respond(c, 503, "text/plain", sizeof(gNoData) - 1, gNoData);
+            return;
+        }
+        // the event without its prefix and the blank line
+        uint32_t off = sizeof(HTTP_EVENT_PREFIX) - 1;
+        uint32_t end = (uint32_t)gLatest->len - 2;
+        respond(c, 200, "application/json", end - off, NULL);
+        enqueue(c, gLatest, off, end);
+    } else if (strcmp(path, "/metrics") == 0) {
+        sendMetrics(c);
+    } else if (strcmp(path, "/events") == 0) {
+        c.hdrLen = (size_t)snprintf(c.hdr, sizeof(c.hdr),
+                                    "HTTP/1.1 200 OK\r\n"
+                                    "Content-Type: text/event-stream\r\n"
+                                    "Cache-Control: no-cache\r\n"
+                                    "Access-Control-Allow-Origin: *\r\n"
+                                    "\r\n");
+        c.stream = true;
+        if (gLatest != NULL)
+            enqueue(c, gLatest, 0, (uint32_t)gLatest->len);
+    } else if (strcmp(path, "/session.gpx") == 0) {
+        lock_guard<mutex> lock(gSessionLock);
+        sendFile(c, gGpxPath, "application/gpx+xml");
+    } else if (strcmp(path, "/session.dlb") == 0) {
+        lock_guard<mutex> lock(gSessionLock);
+        sendFile(c, gDlbPath, "application/octet-stream");
+    } else {
+        respond(c, 404, "text/plain", sizeof(gNotFound) - 1, gNotFound);
+    }
+}
+
+/**
+ * Sets the response header and an optional static body, a NULL body
+ * means the caller queues len bytes itself.
+ */
+void respond(HttpClient &c, int status, const char* type, size_t len,
+             const char* body)
+{
+    const char* reason = status == 200 ? "OK" :
+                         status == 404 ? "Not Found" :
+                         status == 405 ? "Method Not Allowed" :
+                         status == 503 ? "Service Unavailable" : "Bad Request";
+    c.hdrLen = (size_t)snprintf(c.hdr, sizeof(c.hdr),
+                                "HTTP/1.1 %d %s\r\n"
+                                "Content-Type: %s\r\n"
+                                "Content-Length: %lu\r\n"
+                                "Cache-Control: no-cache\r\n"
+                                "Access-Control-Allow-Origin: *\r\n"
+                                "Connection: close\r\n"
+                                "\r\n",
+                                status, reason, type, (unsigned long)len);
+    c.hdrOff = 0;
+    if (body != NULL) {
+        c.body = body;
+        c.bodyOff = 0;
+        c.bodyLen = len;
+    }
+}
+
+/**
+ * The file is still being written, it's sent up to its current size.
+ */
+void sendFile(HttpClient &c, const string &path, const char* type)
+{
+    int fd = path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        respond(c, 404, "text/plain", sizeof(gNotFound) - 1, gNotFound);
+        return;
+    }
+    c.file = fd;
+    c.fileOff = 0;
+    c.fileEnd = st.st_size;
+    respond(c, 200, type, (size_t)st.st_size, NULL);
+}
+
+/**
+ * Each scrape gets its own copy of the metrics in pooled buffers, a slow
+ * reader only holds up its own.
+ */
+void sendMetrics(HttpClient &c)
+{
+    size_t len = metricsFormat(gMetrics, sizeof(gMetrics));
+    respond(c, 200, "text/plain; version=0.0.4; charset=utf-8", len, NULL);
+    for (size_t off = 0; off < len; off += SINK_BUFFER_SIZE) {
+        SinkBuffer* b = sinkBufferGet(0);
+        b->len = len - off < SINK_BUFFER_SIZE ? len - off : SINK_BUFFER_SIZE;
+        memcpy(b->data, gMetrics + off, b->len);
+        enqueue(c, b, 0, (uint32_t)b->len);
+        sinkBufferPut(b);
+    }
+}
+
+bool enqueue(HttpClient &c, SinkBuffer* b, uint32_t off, uint32_t end)
+{
+    if (c.qCount == HTTP_CLIENT_QUEUE)
+        return false;
+    b->refs.fetch_add(1, memory_order_relaxed);
+    HttpChunk &k = c.q[(c.qHead + c.qCount) % HTTP_CLIENT_QUEUE];
+    k.b = b;
+    k.off = off;
+    k.end = end;
+    c.qCount += 1;
+    return true;
+}
+
+/**
+ * Sends until the socket is full, the next EPOLLOUT edge resumes.
+ */
+void flushClient(HttpClient &c)
+{
+    for (;;) {
+        const char* p;
+        size_t n;
+        if (c.hdrOff < c.hdrLen) {
+            p = c.hdr + c.hdrOff;
+            n = c.hdrLen - c.hdrOff;
+        } else if (c.bodyOff < c.bodyLen) {
+            p = c.body + c.bodyOff;
+            n = c.bodyLen - c.bodyOff;
+        } else if (c.qCount > 0) {
+            HttpChunk &k = c.q[c.qHead];
+            p = k.b->data + k.off;
+            n = k.end - k.off;
+        } else if (c.file >= 0 && c.fileOff < c.fileEnd) {
+            ssize_t r = sendfile(c.fd, c.file, &c.fileOff, (size_t)(c.fileEnd - c.fileOff));
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            if (r <= 0) {
+                closeClient(c);
+                return;
+            }
+            continue;
+        } else {
+            break;
+        }
+
+        ssize_t r = send(c.fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (r <= 0) {
+            closeClient(c);
+            return;
+        }
+        if (c.hdrOff < c.hdrLen) {
+            c.hdrOff += (size_t)r;
+        } else if (c.bodyOff < c.bodyLen) {
+            c.bodyOff += (size_t)r;
+        } else {
+            HttpChunk &k = c.q[c.qHead];
+            k.off += (uint32_t)r;
+            if (k.off == k.end) {
+                sinkBufferPut(k.b);
+                c.qHead = (c.qHead + 1) % HTTP_CLIENT_QUEUE;
+                c.qCount -= 1;
+            }
+        }
+    }
+    // a stream stays open for the next event, a response is complete
+    if (c.handled && !c.stream && c.hdrLen > 0)
+        closeClient(c);
+}
+
+void closeClient(HttpClient &c)
+{
+    close(c.fd);
+    c.fd = -1;
+    while (c.qCount > 0) {
+        sinkBufferPut(c.q[c.qHead].b);
+        c.qHead = (c.qHead + 1) % HTTP_CLIENT_QUEUE;
+        c.qCount -= 1;
+    }
+    if (c.file >= 0)
+        close(c.file);
+    c.file = -1;
+    c.body = NULL;
+}
+
+#else /* APL || IBM */
+
+bool httpStart(int port)
+{
+    LPRINTF("DataLogger Plugin: the http server isn't supported...\n");
+    return false;
+}
+
+void httpStop(void)
+{
+}
+
+bool httpSinkOpen(const string &gpx, const string &dlb, float rate)
+{
+    return false;
+}
+
+#endif
+
+/**
+ * Formats an event at the configured rate with the latest value of
+ * every channel sampled so far, whether or not it changed.
+ */
+void httpEncode(const Sample &s, uint64_t changed)
+{
+    uint64_t present = channelsInGroups(s.groups);
+    for (int i = 0; i < gChannelCount; i++) {
+        if (present & CHANNEL_BIT(i))
+            gLast[i] = s.ch[i];
+    }
+    gSeen |= present;
+    if (s.tick < gNext)
+        return;
+    gNext += gPeriodUs;
+    if (gNext <= s.tick)
+        gNext = s.tick + gPeriodUs;
+
+    SinkBuffer* b = sinkBufferGet(0);
+    char* p = b->data;
+    char* end = b->data + SINK_BUFFER_SIZE - 3;
+    p += snprintf(p, end - p, HTTP_EVENT_PREFIX "{\"cycle\":%d,\"time\":%lld,\"t\":%.3f",
+                  s.cycle, (long long)s.wallTime, s.elapsed);
+    if (gSeen != 0) {
+        *p++ = ',';
+        p += channelsFormat(p, end - p, gLast, gSeen);
+    }
+    memcpy(p, "}\n\n", 3);
+    b->len = (size_t)(p + 3 - b->data);
+    sinkPublish(ENC_HTTP, b);
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef ARROWIPC_H
+#define ARROWIPC_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+ * Apache Arrow IPC file format writer, metadata version V5, little
+ * endian hosts only.
+ *
+ *      "ARROW1\0\0"
+ *      schema message
+ *      record batch messages
+ *      end of stream marker
+ *      footer, i32 footer length, "ARROW1"
+ *
+ * A message is the 0xffffffff continuation marker, the i32 length of the
+ * flatbuffer metadata, the metadata padded to 8 bytes and the body. In a
+ * record batch body every column has a validity buffer, empty when the
+ * column has no nulls, and a values buffer, each padded to 8 bytes, so
+ * a memory mapped file can be read in place one column at a time.
+ *
+ * The bytes after the 8 byte prefix are a valid Arrow stream up to the
+ * last complete message, a file left without its footer can be read
+ * with a stream reader.
+ */
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_PREFIX_SIZE (8)       // the magic padded to 8
+#define ARROW_CONTINUATION (0xffffffffu)
+
+// column types
+enum {
+    ARROW_F32 = 0
+    ,ARROW_F64
+    ,ARROW_I32
+    ,ARROW_TIMESTAMP_S          // i64 unix seconds, UTC
+};
+
+struct ArrowColumn {
+    const char* name;
+    int type;
+    bool nullable;
+};
+
+/**
+ * A message's location in the file, for the footer.
+ */
+struct ArrowBlock {
+    int64_t offset;             // of the continuation marker
+    int32_t metaLen;            // marker, length and padded metadata
+    int64_t bodyLen;
+};
+
+/**
+ * A body buffer, offsets relative to the start of the body.
+ */
+struct ArrowBuffer {
+    int64_t offset;
+    int64_t length;
+};
+
+static inline int64_t arrowPad(int64_t n)
+{
+    return (n + 7) & ~(int64_t)7;
+}
+
+int arrowWidth(int type);
+
+// Appends the encapsulated schema message.
+void arrowSchemaMessage(std::string &out, const ArrowColumn* cols, int n);
+
+// Lays out a record batch body of rows rows, two buffers per column
+// (validity, values), validity is empty for columns without nulls.
+// Returns the body length.
+int64_t arrowBatchLayout(int64_t rows, const ArrowColumn* cols,
+                         const int64_t* nulls, int n, ArrowBuffer* bufs);
+
+// Appends the encapsulated record batch message for the layout, the
+// caller writes the body after it.
+void arrowBatchMessage(std::string &out, int64_t rows, const int64_t* nulls,
+                       int n, const ArrowBuffer* bufs, int64_t bodyLen);
+
+// Appends the end of stream marker, the footer and the trailing magic.
+void arrowFileEnd(std::string &out, const ArrowColumn* cols, int n,
+                  const std::vector<ArrowBlock> &batches);
+
+#endif /* ARROWIPC_H */
@@ -0,0 +1,29 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef ARROWSINK_H
+#define ARROWSINK_H
+
+#include <string>
+
+#include "./sample.h"
+
+/*
+ * Columnar session log, DataLog-<time>.arrow (arrow=1), an Arrow IPC
+ * file, see arrowipc.h. The columns are time (f64 sim elapsed seconds),
+ * wall (timestamp[s, UTC]), cycle (i32) and one per channel, f64 for
+ * double datarefs and f32 for the rest, null in the rows where the
+ * channel's group wasn't sampled. A record batch is written every
+ * ARROW_BATCH_ROWS rows or ARROW_BATCH_US, the footer when logging
+ * stops.
+ */
+#define ARROW_BATCH_ROWS (2048)
+#define ARROW_BATCH_US (10000000)
+
+// writer thread only; the file is written by a file sink
+bool arrowSinkOpen(const std::string &file);
+void arrowEncode(const Sample &s, uint64_t changed);
+void arrowEncodeFinish(void);
+
+#endif /* ARROWSINK_H */
@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <string>
+#include <stdint.h>
+
+// the format is shared with tools/binlogreader, which can't include the SDK
+struct Sample;
+
+/*
+ * Binary session log, DataLog-<time>.dlb, host (little endian) byte order.
+ *
+ * header:
+ *      char[4]     "DLB1"
+ *      u16         format version
+ *      u16         channel count
+ *      per channel:
+ *          u8      group
+ *          u8      value type, 'f' f32 or 'd' f64
+ *          u8      name length
+ *          char[]  name
+ *          f32     absolute deadband
+ *          f32     relative deadband, fraction of the last value
+ *
+ * record:
+ *      u8[]        channel bitmap, (channel count + 7) / 8 bytes, bit
+ *                  n % 8 of byte n / 8 is set when channel n is present
+ *      u32         wall clock, unix seconds
+ *      u32         sim cycle (frame) number
+ *      f32         sim elapsed time, seconds
+ *      u8          flags, BINLOG_NEW_SEGMENT
+ *      values      the channels in the bitmap, in channel order
+ *
+ * A channel is only present when it moved beyond its deadband since it
+ * was last written, so a reader holding the last value of each channel
+ * is never further off than the band. Records with no changed channels
+ * aren't written, unless they start a track segment. The first record of each block of include/blockindex.h
+ * has every channel written so far, a reader can start at any block.
+ */
+#define BINLOG_MAGIC "DLB1"
+#define BINLOG_VERSION (4)
+#define BINLOG_BITMAP_SIZE(n) (((n) + 7) / 8)
+#define BINLOG_TAG_INDEX (1)        // sink buffer tag of the index entries
+
+// record flags
+#define BINLOG_NEW_SEGMENT (0x01)   // the GPX track breaks its segment here
+
+// writer thread only; the records go to a file sink
+bool binlogOpen(const std::string &file);
+void binlogEncode(const Sample &s, uint64_t changed);
+void binlogEncodeEnd(void);
+void binlogEncodeFinish(void);
+
+#endif /* BINLOG_H */
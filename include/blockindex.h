@@ -0,0 +1,113 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef BLOCKINDEX_H
+#define BLOCKINDEX_H
+
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+/*
+ * Sparse block index, a sidecar written next to every GPX track and
+ * binary log, <data file>.idx, host (little endian) byte order. Layout
+ * shared by the plugin and tools/blockreader.
+ *
+ *      char[4]     "DLX1"
+ *      u16         format version
+ *      u16         entry size
+ *      entries     one IndexEntry per block, in file order
+ *
+ * The data file is cut into blocks of INDEX_BLOCK_RECORDS records or
+ * INDEX_BLOCK_BYTES bytes, whichever comes first. An entry is appended
+ * as soon as its block is on disk, so the index of a session still being
+ * written covers everything but the last block; a reader ignores a
+ * trailing partial entry and scans from the end of the last block for
+ * the rest. The bytes before the first block are the data file's header
+ * (the binary log header or the GPX prolog).
+ *
+ * The first record of a binary log block repeats every channel written
+ * so far, so a block decodes with nothing but the header. The GPX and
+ * binary outputs block by default; under policy drop a lost index
+ * buffer makes the next entry span both blocks with only its own bounds.
+ */
+#define INDEX_MAGIC "DLX1"
+#define INDEX_VERSION (1)
+#define INDEX_HEADER_SIZE (8)
+#define INDEX_BLOCK_RECORDS (1024)
+#define INDEX_BLOCK_BYTES (64 * 1024)
+
+/**
+ * A block's byte range and what it holds. A block without a position
+ * has min > max.
+ */
+struct IndexEntry {
+    uint64_t offset;            // of the block's first byte in the data file
+    uint64_t length;
+    uint32_t count;             // records or track points
+    uint32_t wallFirst;         // unix seconds
+    uint32_t wallLast;
+    float elapsedFirst;         // sim seconds
+    float elapsedLast;
+    int32_t cycleFirst;
+    double minLat;
+    double maxLat;
+    double minLon;
+    double maxLon;
+    double minAlt;
+    double maxAlt;
+};
+
+static inline void blockIndexReset(IndexEntry &e)
+{
+    e.offset = 0;
+    e.length = 0;
+    e.count = 0;
+    e.minLat = e.minLon = e.minAlt = 1e300;
+    e.maxLat = e.maxLon = e.maxAlt = -1e300;
+}
+
+static inline void blockIndexAdd(IndexEntry &e, uint32_t wall, float elapsed,
+                                 int32_t cycle)
+{
+    if (e.count == 0) {
+        e.wallFirst = wall;
+        e.elapsedFirst = elapsed;
+        e.cycleFirst = cycle;
+    }
+    e.wallLast = wall;
+    e.elapsedLast = elapsed;
+    e.count += 1;
+}
+
+static inline void blockIndexPosition(IndexEntry &e, double lat, double lon,
+                                      double alt)
+{
+    if (lat < e.minLat) e.minLat = lat;
+    if (lat > e.maxLat) e.maxLat = lat;
+    if (lon < e.minLon) e.minLon = lon;
+    if (lon > e.maxLon) e.maxLon = lon;
+    if (alt < e.minAlt) e.minAlt = alt;
+    if (alt > e.maxAlt) e.maxAlt = alt;
+}
+
+// length counts the bytes encoded so far on the writer side
+static inline bool blockIndexFull(const IndexEntry &e)
+{
+    return e.count >= INDEX_BLOCK_RECORDS || e.length >= INDEX_BLOCK_BYTES;
+}
+
+static inline bool blockIndexOverlaps(const IndexEntry &e, double south,
+                                      double west, double north, double east)
+{
+    return e.minLat <= north && e.maxLat >= south &&
+           e.minLon <= east && e.maxLon >= west;
+}
+
+// sink threads, appends the entry for the data file's bytes [start, end),
+// creating the index file with its first entry
+void blockIndexWrite(std::ofstream &fd, const std::string &path,
+                     const char* entry, uint64_t start, uint64_t end);
+
+#endif /* BLOCKINDEX_H */
@@ -0,0 +1,151 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "./replace.h"
+#include "./summary.h"
+
+/*
+ * Flight catalog, one file per output directory, DataLog-catalog.dlc,
+ * host (little endian) byte order. The plugin adds its tracks as it
+ * closes them and tools/dl_catalog rescans the directory, summarizing
+ * only the tracks whose size or modification time changed. Layout:
+ *
+ *      char[4]     "DLC1"
+ *      u16         format version
+ *      u16         entry size
+ *      entries     one CatalogEntry per GPX track, sorted by name
+ *
+ * Track names start with their session's date and time, so name order
+ * is time order. It's always replaced through a temporary file, a reader
+ * never sees half of one; it's only a cache of the tracks and their
+ * sidecars, a lost update is put back by the next rescan.
+ */
+#define CATALOG_FILE "DataLog-catalog.dlc"
+#define CATALOG_MAGIC "DLC1"
+#define CATALOG_VERSION (1)
+#define CATALOG_HEADER_SIZE (8)
+#define CATALOG_NAME_SIZE (64)
+
+// entry flags
+#define CATALOG_COMPLETE (0x01)     // the track was closed
+#define CATALOG_TRAFFIC (0x02)      // a multiplayer plane's track
+
+/**
+ *
+ */
+struct CatalogEntry {
+    char name[CATALOG_NAME_SIZE];   // without the directory, NUL terminated
+    uint64_t size;
+    int64_t mtime;                  // unix seconds
+    uint32_t crc;                   // crc32 of the whole file
+    uint32_t flags;
+    SessionSummary summary;
+};
+
+static inline bool catalogLess(const CatalogEntry &a, const CatalogEntry &b)
+{
+    return strcmp(a.name, b.name) < 0;
+}
+
+/**
+ * The file's size and modification time, false if it doesn't exist.
+ */
+static inline bool catalogStat(const std::string &path, uint64_t &size,
+                               int64_t &mtime)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+/**
+ * Reads the catalog, false if there's none or it's from another version,
+ * a trailing partial entry is ignored.
+ */
+static inline bool catalogLoad(const std::string &path,
+                               std::vector<CatalogEntry> &entries)
+{
+    entries.clear();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+    char hdr[CATALOG_HEADER_SIZE];
+    uint16_t version, size;
+    bool ok = fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+              memcmp(hdr, CATALOG_MAGIC, 4) == 0;
+    if (ok) {
+        memcpy(&version, hdr + 4, sizeof(version));
+        memcpy(&size, hdr + 6, sizeof(size));
+        ok = version == CATALOG_VERSION && size == sizeof(CatalogEntry);
+    }
+    CatalogEntry e;
+    while (ok && fread(&e, sizeof(e), 1, f) == 1) {
+        e.name[CATALOG_NAME_SIZE - 1] = '\0';
+        entries.push_back(e);
+    }
+    fclose(f);
+    if (!ok)
+        entries.clear();
+    return ok;
+}
+
+/**
+ *
+ */
+static inline bool catalogSave(const std::string &path,
+                               const std::vector<CatalogEntry> &entries)
+{
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (f == NULL)
+        return false;
+    uint16_t version = CATALOG_VERSION;
+    uint16_t size = (uint16_t)sizeof(CatalogEntry);
+    fwrite(CATALOG_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&size, sizeof(size), 1, f);
+    if (!entries.empty())
+        fwrite(&entries[0], sizeof(CatalogEntry), entries.size(), f);
+    if (fclose(f) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return replaceFile(tmp, path);
+}
+
+/**
+ * Adds the entries to the catalog or replaces the ones of the same name.
+ */
+static inline bool catalogUpdate(const std::string &path,
+                                 const std::vector<CatalogEntry> &update)
+{
+    std::vector<CatalogEntry> entries;
+    catalogLoad(path, entries);
+    for (size_t i = 0; i < update.size(); i++) {
+        std::vector<CatalogEntry>::iterator it =
+            std::lower_bound(entries.begin(), entries.end(), update[i], catalogLess);
+        if (it != entries.end() && strcmp(it->name, update[i].name) == 0)
+            *it = update[i];
+        else
+            entries.insert(it, update[i]);
+    }
+    return catalogSave(path, entries);
+}
+
+#endif /* CATALOG_H */
@@ -0,0 +1,88 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMDataAccess.h"
+
+// channel groups, each sampled at its own rate
+enum {
+    GROUP_POSITION = 0
+    ,GROUP_ENGINE
+    ,GROUP_ENVIRONMENT
+    ,NUM_GROUPS
+};
+
+#define GROUP_BIT(g) (1u << (g))
+
+// channel indices, ordered by group
+enum {
+    CH_LAT = 0
+    ,CH_LON
+    ,CH_ALT
+    ,CH_GS
+    ,CH_HDG
+    ,CH_PITCH
+    ,CH_ROLL
+    ,CH_VS
+    ,CH_IAS
+    ,CH_N1
+    ,CH_RPM
+    ,CH_EGT
+    ,CH_FF
+    ,CH_OILP
+    ,CH_FUEL
+    ,CH_WIND_SPD
+    ,CH_WIND_DIR
+    ,CH_BARO
+    ,CH_OAT
+    ,NUM_CHANNELS
+};
+
+#define MAX_CHANNELS (64)
+#define CHANNEL_BIT(c) ((uint64_t)1 << (c))
+
+/**
+ * A logged dataref. Array datarefs are read at a single index.
+ */
+struct ChannelDef {
+    const char* name;
+    const char* dataref;
+    XPLMDataTypeID type;
+    int index;
+    int group;
+};
+
+struct DeadbandState;
+
+// the built-in channels followed by the ones added from the config file
+extern ChannelDef gChannelDefs[MAX_CHANNELS];
+extern int gChannelCount;
+extern const char* gGroupNames[NUM_GROUPS];
+
+// CHANNEL_BIT of the channels in each group
+extern uint64_t gGroupChannels[NUM_GROUPS];
+
+bool channelsAdd(const std::string &group, const std::string &name,
+                 const std::string &dataref);
+void channelsInit(void);
+void channelsRead(double* ch, uint32_t groups);
+uint64_t channelsInGroups(uint32_t groups);
+uint64_t channelsMoved(const DeadbandState &st, const double* ch,
+                       const float* absBand, const float* relBand);
+char* channelsEncode(char* p, const double* ch, uint64_t changed);
+size_t channelsFormat(char* out, size_t size, const double* ch,
+                      uint64_t present);
+
+// the table driven code of the config file channels, for any channels
+char* channelsEncodeGeneric(char* p, const double* ch, uint64_t changed);
+char* channelsFormatGeneric(char* p, char* end, const double* ch,
+                            uint64_t present);
+
+#endif /* CHANNELS_H */
@@ -0,0 +1,56 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "./channels.h"
+#include "./sink.h"
+
+/**
+ * Options read from the key=value lines that follow the output path
+ * on the first line of DataLogPath.txt.
+ */
+struct Config {
+    bool traffic;               // traffic=1, also log multiplayer/AI planes
+    bool binary;                // binary=1, also write a .dlb channel log
+    bool trace;                 // trace=1, write a -trace.json profile
+    bool shm;                   // shm=1, publish samples in shared memory
+    bool udp;                   // udp=1, stream samples over udp
+    std::string udpHost;        // udp.host=, default loopback, a comma
+                                // separated list sends to every host
+    int udpPort;                // udp.port=
+    int udpMtu;                 // udp.mtu=, max datagram payload
+    bool gdl90;                 // gdl90=1, GDL-90 reports for EFB apps
+    std::string gdl90Host;      // gdl90.host=, default broadcast, or a list
+    int gdl90Port;              // gdl90.port=
+    bool nmea;                  // nmea=1, NMEA 0183 GGA/RMC/VTG output
+    std::string nmeaDevice;     // nmea.device=, serial ports or "pty"
+    int nmeaBaud;               // nmea.baud=
+    float nmeaRate;             // nmea.rate=Hz
+    bool http;                  // http=1, live telemetry on localhost
+    int httpPort;               // http.port=
+    float httpRate;             // http.rate=Hz, event stream rate
+    bool arrow;                 // arrow=1, also write a .arrow columnar log
+    bool sqlite;                // sqlite=1, also insert samples into sqlite
+    std::string sqliteFile;     // sqlite.file=, default in the output dir
+    float rate[NUM_GROUPS];     // rate.<group>=Hz, 0 disables the group
+    float panelMinutes;         // panel.minutes=, sparkline time span
+    int policy[NUM_ENCODINGS];  // policy.<sink>=drop|block, full queue
+    // deadband.<channel>=value for an absolute band, or value% for a
+    // band relative to the last written value
+    float deadAbs[MAX_CHANNELS];
+    float deadRel[MAX_CHANNELS];
+};
+
+extern Config gConfig;
+
+void configParseLine(const std::string &line);
+void configParseDone(void);
+std::vector<std::string> configSplit(const std::string &list);
+
+#endif /* CONFIG_H */
@@ -0,0 +1,59 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * CRC-32 (IEEE 802.3, reflected 0xEDB88320), the one zlib and cksum -o3
+ * compute, eight bytes at a time. Host (little endian) byte order, as
+ * the rest of the plugin's formats.
+ */
+struct Crc32Table {
+    uint32_t t[8][256];
+
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c >> 1) ^ ((c & 1) ? 0xEDB88320u : 0);
+            t[0][i] = c;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+    }
+};
+
+/**
+ * Continues crc, which starts at 0, over n more bytes.
+ */
+static inline uint32_t crc32Update(uint32_t crc, const void* data, size_t n)
+{
+    static const Crc32Table tab;
+    const uint32_t (*t)[256] = tab.t;
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint32_t a, b;
+        memcpy(&a, p, 4);
+        memcpy(&b, p + 4, 4);
+        a ^= crc;
+        crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^
+              t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+              t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^
+              t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+    }
+    for (; n > 0; p++, n--)
+        crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+#endif /* CRC32_H */
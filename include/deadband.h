@@ -0,0 +1,65 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "./channels.h"
+
+// last written value of each channel
+struct DeadbandState {
+    double last[MAX_CHANNELS];
+    uint64_t seen;      // channels written at least once
+};
+
+/**
+ * Bit i is set when channel i moved further from the last written value
+ * than the larger of the absolute band and the relative band (a fraction
+ * of the last value). No data dependent branches, so loops over it
+ * vectorize.
+ */
+static inline uint64_t deadbandMovedOne(const DeadbandState &st,
+                                        const double* ch,
+                                        const float* absBand,
+                                        const float* relBand, int i)
+{
+    double d = fabs(ch[i] - st.last[i]);
+    double rel = relBand[i] * fabs(st.last[i]);
+    double band = absBand[i] > rel ? absBand[i] : rel;
+    return (uint64_t)(d > band) << i;
+}
+
+/**
+ * The moved bits of channels [first, last).
+ */
+static inline uint64_t deadbandMoved(const DeadbandState &st, const double* ch,
+                                     const float* absBand,
+                                     const float* relBand, int first, int last)
+{
+    uint64_t moved = 0;
+    for (int i = first; i < last; i++)
+        moved |= deadbandMovedOne(st, ch, absBand, relBand, i);
+    return moved;
+}
+
+/**
+ * Returns the channels in valid that moved or were never written and
+ * records their values as the last written ones, so the error of a
+ * reader that holds the last value is bounded by the band.
+ */
+static inline uint64_t deadbandCommit(DeadbandState &st, const double* ch,
+                                      uint64_t moved, uint64_t valid, int n)
+{
+    uint64_t changed = (moved | ~st.seen) & valid;
+    st.seen |= changed;
+
+    for (int i = 0; i < n; i++)
+        st.last[i] = ((changed >> i) & 1) ? ch[i] : st.last[i];
+    return changed;
+}
+
+#endif /* DEADBAND_H */
@@ -82,6 +82,7 @@
 #define PROCESSED_EVENT (1)
 
 #define METERS_PER_FOOT (0.3048)
+#define MPS_TO_KNOTS (1.943844)
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,97 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef GDL90_H
+#define GDL90_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * GDL-90 message encoding (gdl90=1), shared by the plugin and
+ * tools/gdl90_listener. See the GDL 90 Data Interface Specification,
+ * 560-1058-00 Rev A.
+ *
+ * frame:
+ *      0x7e, message id, payload, crc lsb, crc msb, 0x7e
+ *
+ * 0x7d and 0x7e between the flags are escaped as 0x7d, byte ^ 0x20. The
+ * CRC-16-CCITT covers the message id and the payload. Multi-byte payload
+ * fields are big endian except the heartbeat time stamp.
+ */
+#define GDL90_FLAG (0x7e)
+#define GDL90_ESCAPE (0x7d)
+
+#define GDL90_MSG_HEARTBEAT (0)
+#define GDL90_MSG_OWNSHIP (10)
+#define GDL90_MSG_GEO_ALTITUDE (11)
+#define GDL90_MSG_TRAFFIC (20)
+
+// message sizes including the id, excluding the crc
+#define GDL90_HEARTBEAT_SIZE (7)
+#define GDL90_REPORT_SIZE (28)
+#define GDL90_GEO_ALTITUDE_SIZE (5)
+
+// two flags plus every byte of the largest message and crc escaped
+#define GDL90_MAX_FRAME (2 + 2 * (GDL90_REPORT_SIZE + 2))
+
+#define GDL90_DEFAULT_PORT (4000)
+
+// misc field of a report
+#define GDL90_MISC_AIRBORNE (0x08)
+#define GDL90_TT_INVALID (0)
+#define GDL90_TT_TRUE_TRACK (1)
+#define GDL90_TT_MAG_HEADING (2)
+#define GDL90_TT_TRUE_HEADING (3)
+
+#define GDL90_ALT_INVALID (0xfff)
+#define GDL90_HVEL_INVALID (0xfff)
+#define GDL90_VVEL_INVALID (0x800)
+
+/**
+ * An ownship or traffic report with every field already quantized to its
+ * wire resolution, encoding it is a plain bit copy.
+ */
+struct Gdl90Report {
+    uint8_t status;         // alert status, 4 bits
+    uint8_t addrType;       // address type, 4 bits
+    uint32_t address;       // 24 bits
+    int32_t lat;            // 24 bit semicircles, 180 / 2^23 degrees
+    int32_t lon;
+    uint16_t alt;           // 12 bits, 25 ft steps offset by -1000 ft
+    uint8_t misc;           // 4 bits
+    uint8_t nic;            // 4 bits
+    uint8_t nacp;           // 4 bits
+    uint16_t hvel;          // 12 bits, knots
+    int16_t vvel;           // 12 bits signed, 64 fpm steps
+    uint8_t track;          // 360 / 256 degrees
+    uint8_t emitter;        // emitter category
+    char callsign[8];       // space padded, not terminated
+    uint8_t priority;       // emergency/priority code, 4 bits
+};
+
+void gdl90Init(void);
+uint16_t gdl90Crc(const uint8_t* p, size_t n);
+
+// physical units to wire fields
+int32_t gdl90Semicircles(double deg);
+uint16_t gdl90Altitude(double ft);
+uint16_t gdl90HorizVelocity(double kt);
+int16_t gdl90VertVelocity(double fpm);
+uint8_t gdl90Track(double deg);
+
+// unframed messages, id first; return the size written
+size_t gdl90EncodeHeartbeat(uint8_t* msg, bool gpsValid, uint32_t secsOfDay);
+size_t gdl90EncodeReport(uint8_t* msg, uint8_t id, const Gdl90Report &r);
+size_t gdl90EncodeGeoAltitude(uint8_t* msg, double ft, uint16_t vfomMeters);
+bool gdl90DecodeReport(const uint8_t* msg, size_t n, Gdl90Report &r);
+
+// adds crc, escapes and flags; out holds GDL90_MAX_FRAME bytes
+size_t gdl90Frame(uint8_t* out, const uint8_t* msg, size_t n);
+
+// the inverse of gdl90Frame for the bytes between two flags, returns the
+// message size without the crc, or 0 if the crc doesn't match
+size_t gdl90Unframe(uint8_t* msg, const uint8_t* in, size_t n);
+
+#endif /* GDL90_H */
@@ -0,0 +1,16 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef GDL90SINK_H
+#define GDL90SINK_H
+
+#include <string>
+
+#include "./sample.h"
+
+// writer thread only; the datagrams go to a net sink per host
+bool gdl90SinkOpen(const std::string &hosts, int port);
+void gdl90Encode(const Sample &s, uint64_t changed);
+
+#endif /* GDL90SINK_H */
@@ -0,0 +1,40 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef GEO_H
+#define GEO_H
+
+#include <math.h>
+
+#define EARTH_RADIUS_M (6371008.8)
+#define DEG_TO_RAD (0.017453292519943295)
+
+/**
+ * Great circle distance between two lat/lon points (degrees), in meters.
+ */
+static inline double haversine(double lat1, double lon1, double lat2, double lon2)
+{
+    double dlat = (lat2 - lat1) * DEG_TO_RAD;
+    double dlon = (lon2 - lon1) * DEG_TO_RAD;
+    double a = sin(dlat / 2.0) * sin(dlat / 2.0) +
+               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) *
+               sin(dlon / 2.0) * sin(dlon / 2.0);
+    return 2.0 * EARTH_RADIUS_M * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+/**
+ * Initial great circle bearing from the first to the second point,
+ * degrees true in [0, 360).
+ */
+static inline double bearing(double lat1, double lon1, double lat2, double lon2)
+{
+    double dlon = (lon2 - lon1) * DEG_TO_RAD;
+    double y = sin(dlon) * cos(lat2 * DEG_TO_RAD);
+    double x = cos(lat1 * DEG_TO_RAD) * sin(lat2 * DEG_TO_RAD) -
+               sin(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) * cos(dlon);
+    double b = atan2(y, x) / DEG_TO_RAD;
+    return b < 0.0 ? b + 360.0 : b;
+}
+
+#endif /* GEO_H */
@@ -0,0 +1,97 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef GPXFORMAT_H
+#define GPXFORMAT_H
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+
+#include "./geo.h"
+
+/*
+ * The GPX text the writer emits, shared with tools/dl_convert so a
+ * converted track is byte for byte the one the plugin writes.
+ */
+#define GPX_SEGMENT_BREAK "</trkseg><trkseg>\n"
+#define GPX_EPILOG "</trkseg></trk>\n</gpx>\n"
+#define GPX_POINT_SIZE (160)
+
+#define TELEPORT_MIN_DIST (500.0)   // meters
+#define TELEPORT_MAX_SPEED (1000.0) // meters per second
+
+/**
+ * Returns the date and Zulu time.
+ *
+ * @return
+ *      if useDash: YYYY-MM-DDTHH-MM-SSZ
+ *      else:       YYYY-MM-DDTHH:MM:SSZ
+ */
+static inline std::string gpxDateTime(time_t now, bool useDash)
+{
+    std::string buf(22,  '\0');
+    struct tm tm;
+    // the tools format times on several threads
+#if defined(_WIN32)
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+    // strftime(buf, sizeof(buf), "%FT%XZ", gmtime(&now));
+    // strftime(buf, sizeof(buf), "%FT%XZ", localtime(&now));
+    if (useDash)
+        strftime((char*)buf.c_str(), buf.length(), "%Y-%m-%dT%H-%M-%SZ", &tm);
+    else
+        strftime((char*)buf.c_str(),  buf.length(), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf.substr(0, 20);
+}
+
+/**
+ *
+ */
+static inline std::string gpxProlog(const std::string &t)
+{
+    std::string s;
+    s += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    s += "<gpx version=\"1.0\">\n";
+    s += "<metadata>\n";
+    s += "<time>" + t + "</time>\n";
+    s += "</metadata>\n";
+    s += "<trk><name>DataLogger plugin</name><trkseg>\n";
+    return s;
+}
+
+/**
+ * Formats a track point into buf, GPX_POINT_SIZE bytes, returns its
+ * length or 0.
+ */
+static inline size_t gpxPoint(char* buf, double lat, double lon, double alt,
+                              const char* t)
+{
+    // <trkpt lat="46.57608333" lon="8.89241667"><ele>2376.640205</ele></trkpt>
+    // %f matches the to_string() formatting used before
+    int n = snprintf(buf, GPX_POINT_SIZE,
+                     "<trkpt lat=\"%f\" lon=\"%f\"><ele>%f</ele><time>%s</time></trkpt>\n",
+                     lat, lon, alt, t);
+    if (n <= 0)
+        return 0;
+    return (size_t)n < GPX_POINT_SIZE - 1 ? (size_t)n : GPX_POINT_SIZE - 1;
+}
+
+/**
+ * An implausible jump for the time passed is a teleport, elapsed sim
+ * time doesn't advance while paused.
+ */
+static inline bool gpxTeleport(double lat0, double lon0, float elapsed0,
+                               double lat, double lon, float elapsed)
+{
+    float dt = elapsed - elapsed0;
+    if (dt < 0.0f)
+        dt = 0.0f;
+    double d = haversine(lat0, lon0, lat, lon);
+    return d > TELEPORT_MIN_DIST + TELEPORT_MAX_SPEED * dt;
+}
+
+#endif /* GPXFORMAT_H */
@@ -0,0 +1,45 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef HTTPD_H
+#define HTTPD_H
+
+#include <string>
+
+#include "./sample.h"
+
+/*
+ * Live telemetry over HTTP on 127.0.0.1 (http=1), Linux only.
+ *
+ *      GET /               a page showing the live values
+ *      GET /snapshot       the latest event as a JSON object
+ *      GET /events         text/event-stream of the decimated samples
+ *      GET /session.gpx    the session files as written so far
+ *      GET /session.dlb
+ *      GET /metrics        the stats in the Prometheus text format
+ *
+ * The server runs on its own epoll thread for the plugin's lifetime. The
+ * writer encodes each event once into a sink buffer, the server queues
+ * that same buffer to every stream client, and /snapshot sends its JSON
+ * part. An event is
+ *
+ *      data: {"cycle":N,"time":unix,"t":elapsed,"<channel>":value,...}
+ *
+ * with every channel sampled so far in the session.
+ */
+#define HTTP_DEFAULT_PORT (49280)
+#define HTTP_MAX_CLIENTS (32)
+
+// plugin start and stop
+bool httpStart(int port);
+void httpStop(void);
+
+// writer start, registers the event sink and names the session files,
+// dlb is empty without a binary log
+bool httpSinkOpen(const std::string &gpx, const std::string &dlb, float rate);
+
+// writer thread only
+void httpEncode(const Sample &s, uint64_t changed);
+
+#endif /* HTTPD_H */
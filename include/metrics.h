@@ -0,0 +1,18 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+
+// worst case exposition size, every flush histogram included
+#define METRICS_MAX_SIZE (16384)
+
+// Formats the stats in the Prometheus text exposition format, version
+// 0.0.4. Reads the counters relaxed, any thread. Returns the length,
+// the output is truncated to size - 1 and always terminated.
+size_t metricsFormat(char* out, size_t size);
+
+#endif /* METRICS_H */
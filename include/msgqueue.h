@@ -0,0 +1,27 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef MSGQUEUE_H
+#define MSGQUEUE_H
+
+/*
+ * Log messages of the writer, sink and server threads. XPLMDebugString
+ * may only be called from the sim thread, so those threads post their
+ * messages to a lock-free queue and the sim thread prints them from the
+ * status callback. A message that doesn't fit is dropped and counted.
+ */
+#define MSG_QUEUE_SIZE (64)     // a power of two
+#define MSG_SIZE (256)          // longer messages are truncated
+
+// printf style, from any thread
+void msgPost(const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 1, 2)))
+#endif
+    ;
+
+// prints the queued messages, sim thread only
+void msgDrain(void);
+
+#endif /* MSGQUEUE_H */
@@ -0,0 +1,15 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+
+// Registers a datagram sink per host in the comma separated list, every
+// buffer of the encoding is sent as one datagram. Returns false if no
+// host could be opened. POSIX only, logs an error elsewhere.
+bool netSinkOpen(int encoding, const std::string &hosts, int port);
+
+#endif /* NET_H */
@@ -0,0 +1,32 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * NMEA 0183 sentence formatting (nmea=1). Sentences are written into the
+ * caller's buffer without allocating, terminated by *hh\r\n, and never
+ * exceed NMEA_MAX_SENTENCE bytes.
+ */
+#define NMEA_MAX_SENTENCE (82)
+
+struct NmeaFix {
+    time_t time;            // unix seconds, UTC
+    double lat;             // degrees
+    double lon;
+    double altM;            // meters MSL
+    double speedKt;         // ground speed
+    double courseDeg;       // track over ground, degrees true
+    bool valid;
+};
+
+size_t nmeaGGA(char* out, const NmeaFix &f);
+size_t nmeaRMC(char* out, const NmeaFix &f);
+size_t nmeaVTG(char* out, const NmeaFix &f);
+
+#endif /* NMEA_H */
@@ -0,0 +1,20 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef NMEASINK_H
+#define NMEASINK_H
+
+#include <string>
+
+#include "./sample.h"
+
+// device "pty" opens a pseudo-terminal and logs its path
+#define NMEA_PTY "pty"
+
+// writer thread only; a sink per device in the comma separated list,
+// POSIX only, the open logs an error elsewhere
+bool nmeaSinkOpen(const std::string &devices, int baud, float rate);
+void nmeaEncode(const Sample &s, uint64_t changed);
+
+#endif /* NMEASINK_H */
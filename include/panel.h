@@ -0,0 +1,25 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef PANEL_H
+#define PANEL_H
+
+// height of the expanded telemetry panel below the status line
+#define PANEL_HEIGHT (120)
+
+// width of the expand/collapse toggle at the right of the status line
+#define PANEL_TOGGLE_WIDTH (14)
+
+/*
+ * Expandable telemetry panel of the status window: logger throughput and
+ * altitude/groundspeed sparklines. All calls are on the sim thread.
+ */
+extern bool gPanelExpanded;
+
+void panelClear(void);
+void panelAddSample(float altFt, float gsKt);
+void panelUpdate(void);
+void panelDraw(int left, int top, int right, int bottom);
+
+#endif /* PANEL_H */
@@ -0,0 +1,110 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stdint.h>
+#include <float.h>
+
+/**
+ * Level-of-detail min/max history of a value. Level k holds the min and
+ * max of consecutive runs of 2^k samples in a ring of S entries, so the
+ * last S * 2^(L-1) samples are available and any time span can be
+ * reduced to a few hundred pixels by touching at most 2 * pixels
+ * entries. S must be a power of two.
+ */
+template <int S, int L>
+class MinMaxPyramid {
+public:
+    MinMaxPyramid() { clear(); }
+
+    void clear(void)
+    {
+        count_ = 0;
+        for (int k = 0; k < L; k++) {
+            acc_[k].lo = FLT_MAX;
+            acc_[k].hi = -FLT_MAX;
+        }
+    }
+
+    uint64_t count(void) const { return count_; }
+
+    // longest span, in samples, query() can cover
+    uint64_t span(void) const { return (uint64_t)S << (L - 1); }
+
+    void add(float v)
+    {
+        count_ += 1;
+        MinMax m = {v, v};
+        level_[0][(count_ - 1) & (S - 1)] = m;
+        for (int k = 1; k < L; k++) {
+            MinMax &a = acc_[k];
+            a.lo = v < a.lo ? v : a.lo;
+            a.hi = v > a.hi ? v : a.hi;
+            if (count_ & (((uint64_t)1 << k) - 1))
+                continue;
+            level_[k][((count_ >> k) - 1) & (S - 1)] = a;
+            a.lo = FLT_MAX;
+            a.hi = -FLT_MAX;
+        }
+    }
+
+    /**
+     * Reduces the last n samples into w buckets, oldest first. Returns
+     * the number of buckets filled, the coarsest complete entries are
+     * used so the work is bounded by 2 * w whatever n is.
+     */
+    int query(uint64_t n, int w, float* lo, float* hi) const
+    {
+        if (n > count_)
+            n = count_;
+        if (n > span())
+            n = span();
+        if (n == 0 || w <= 0)
+            return 0;
+
+        int k = 0;
+        while (k < L - 1 && (n >> k) > (uint64_t)(2 * w))
+            k++;
+        uint64_t end = count_ >> k;         // complete entries at level k
+        uint64_t m = n >> k;
+        if (m == 0)
+            m = 1;
+        if (m > end)
+            m = end;
+        if (m == 0)
+            return 0;
+        if ((uint64_t)w > m)
+            w = (int)m;
+
+        uint64_t first = end - m;
+        for (int b = 0; b < w; b++) {
+            uint64_t i0 = first + m * b / w;
+            uint64_t i1 = first + m * (b + 1) / w;
+            float l = FLT_MAX;
+            float h = -FLT_MAX;
+            for (uint64_t i = i0; i < i1; i++) {
+                const MinMax &e = level_[k][i & (S - 1)];
+                l = e.lo < l ? e.lo : l;
+                h = e.hi > h ? e.hi : h;
+            }
+            lo[b] = l;
+            hi[b] = h;
+        }
+        return w;
+    }
+
+private:
+    struct MinMax {
+        float lo;
+        float hi;
+    };
+
+    MinMax level_[L][S];
+    MinMax acc_[L];     // partial runs, acc_[0] is unused
+    uint64_t count_;
+};
+
+#endif /* PYRAMID_H */
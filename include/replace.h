@@ -0,0 +1,28 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef REPLACE_H
+#define REPLACE_H
+
+#include <string>
+#include <stdio.h>
+
+/**
+ * Moves a finished temporary file over path, so a reader sees either the
+ * old file or the new one. Windows won't rename over an existing file,
+ * there it's removed first and a reader can briefly find none. The
+ * temporary file is removed if it can't be moved.
+ */
+static inline bool replaceFile(const std::string &tmp, const std::string &path)
+{
+    if (rename(tmp.c_str(), path.c_str()) == 0)
+        return true;
+    remove(path.c_str());
+    if (rename(tmp.c_str(), path.c_str()) == 0)
+        return true;
+    remove(tmp.c_str());
+    return false;
+}
+
+#endif /* REPLACE_H */
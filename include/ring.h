@@ -0,0 +1,66 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Lock-free single producer, single consumer ring. N must be a power
+ * of two. The producer fills a slot in place via claim()/commit() so
+ * large records are never copied on the flight loop thread.
+ */
+template <typename T, size_t N>
+class SpscRing {
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    // producer side, returns NULL when the ring is full
+    T* claim(void)
+    {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_.load(std::memory_order_acquire) >= N)
+            return NULL;
+        return &buf_[h & (N - 1)];
+    }
+
+    void commit(void)
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    // consumer side, returns NULL when the ring is empty
+    T* front(void)
+    {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire))
+            return NULL;
+        return &buf_[t & (N - 1)];
+    }
+
+    void pop(void)
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    size_t size(void) const
+    {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity(void) const { return N; }
+
+private:
+    T buf_[N];
+    // keep the indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+#endif /* RING_H */
@@ -0,0 +1,44 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <time.h>
+#include <stdint.h>
+
+#include "./ring.h"
+#include "./channels.h"
+
+// multiplayer/AI planes, the user's plane isn't counted
+#define MAX_TRAFFIC (19)
+
+// sample flags
+#define SAMPLE_NEW_SEGMENT (0x01)
+
+/**
+ * One flight loop sample handed from the sim thread to the writer thread.
+ * Only the channels of the groups in the bitmask are valid.
+ * Traffic is stored struct-of-arrays, one slot per multiplayer plane, so
+ * each field is read across all planes in a single tight loop.
+ */
+struct Sample {
+    uint32_t flags;
+    uint32_t groups;    // GROUP_BIT of the channel groups read
+    time_t wallTime;
+    int cycle;          // XPLMGetCycleNumber, unique per sim frame
+    int64_t tick;       // statsTickUs at capture
+    float elapsed;
+    double ch[MAX_CHANNELS];
+    int trafficCount;
+    double trafficLat[MAX_TRAFFIC];
+    double trafficLon[MAX_TRAFFIC];
+    double trafficAlt[MAX_TRAFFIC];
+};
+
+// ~4 seconds of headroom at 60 fps
+#define SAMPLE_QUEUE_SIZE (256)
+typedef SpscRing<Sample, SAMPLE_QUEUE_SIZE> SampleQueue;
+
+#endif /* SAMPLE_H */
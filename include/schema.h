@@ -0,0 +1,198 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMDataAccess.h"
+
+#include "./channels.h"
+#include "./deadband.h"
+
+/*
+ * Compile-time schema of the built-in channels. Each group is a typelist
+ * of channel descriptors that generates the dataref reader, the deadband
+ * test, the binary encoder and the text formatter for the group. The
+ * recursion unrolls into straight-line code with the channel indices,
+ * XPLM getters and value sizes as constants, no per channel switch or
+ * indirect call is left at run time.
+ *
+ * The lists must match gChannelDefs, a static_assert in channels.cpp
+ * checks them at compile time, which needs C++11 constexpr (Visual Studio
+ * 2015 or later, see make.msvc.bat). Channels added from the config file
+ * go through the generic code in channels.cpp.
+ */
+
+// value types, the binary log stores doubles as f64 and the rest as f32
+struct F64 {};
+struct F32 {};
+struct I32 {};
+template <int Index> struct F32At {};   // one element of a float array
+
+template <typename T> struct ChanType;
+
+template <> struct ChanType<F64> {
+    static const XPLMDataTypeID xplm = xplmType_Double;
+    static const int index = 0;
+    static const int size = 8;
+    static const int decimals = 8;
+    static inline double read(XPLMDataRef r) { return XPLMGetDatad(r); }
+};
+
+template <> struct ChanType<F32> {
+    static const XPLMDataTypeID xplm = xplmType_Float;
+    static const int index = 0;
+    static const int size = 4;
+    static const int decimals = 4;
+    static inline double read(XPLMDataRef r) { return XPLMGetDataf(r); }
+};
+
+template <> struct ChanType<I32> {
+    static const XPLMDataTypeID xplm = xplmType_Int;
+    static const int index = 0;
+    static const int size = 4;
+    static const int decimals = 0;
+    static inline double read(XPLMDataRef r) { return XPLMGetDatai(r); }
+};
+
+template <int Index> struct ChanType<F32At<Index> > {
+    static const XPLMDataTypeID xplm = xplmType_FloatArray;
+    static const int index = Index;
+    static const int size = 4;
+    static const int decimals = 4;
+    static inline double read(XPLMDataRef r)
+    {
+        float v = 0.0f;
+        XPLMGetDatavf(r, &v, Index, 1);
+        return v;
+    }
+};
+
+template <int Size> static inline char* schemaPut(char* p, double v);
+
+template <> inline char* schemaPut<8>(char* p, double v)
+{
+    memcpy(p, &v, 8);
+    return p + 8;
+}
+
+template <> inline char* schemaPut<4>(char* p, double v)
+{
+    float f = (float)v;
+    memcpy(p, &f, 4);
+    return p + 4;
+}
+
+template <int Id, typename Type, int Group>
+struct Chan {
+    enum { id = Id, group = Group };
+    typedef ChanType<Type> type;
+};
+
+template <typename... Cs> struct Schema;
+
+template <> struct Schema<> {
+    static const uint64_t mask = 0;
+    static const int count = 0;
+
+    static inline void read(double*, const XPLMDataRef*) {}
+    static inline uint64_t moved(const DeadbandState &, const double*,
+                                 const float*, const float*) { return 0; }
+    static inline char* encode(char* p, const double*, uint64_t) { return p; }
+    static inline char* format(char* p, char*, const double*, uint64_t) { return p; }
+    static constexpr bool check(const ChannelDef*) { return true; }
+};
+
+template <typename C, typename... Rest>
+struct Schema<C, Rest...> {
+    typedef Schema<Rest...> Next;
+    typedef typename C::type T;
+
+    static const uint64_t mask = CHANNEL_BIT(C::id) | Next::mask;
+    static const int count = 1 + Next::count;
+
+    static inline void read(double* ch, const XPLMDataRef* refs)
+    {
+        ch[C::id] = T::read(refs[C::id]);
+        Next::read(ch, refs);
+    }
+
+    static inline uint64_t moved(const DeadbandState &st, const double* ch,
+                                 const float* absBand, const float* relBand)
+    {
+        return deadbandMovedOne(st, ch, absBand, relBand, C::id) |
+               Next::moved(st, ch, absBand, relBand);
+    }
+
+    // the changed channels in channel order, see binlog.h
+    static inline char* encode(char* p, const double* ch, uint64_t changed)
+    {
+        if (changed & CHANNEL_BIT(C::id))
+            p = schemaPut<T::size>(p, ch[C::id]);
+        return Next::encode(p, ch, changed);
+    }
+
+    // "name":value, per present channel
+    static inline char* format(char* p, char* end, const double* ch,
+                               uint64_t present)
+    {
+        if ((present & CHANNEL_BIT(C::id)) && p < end) {
+            int n = snprintf(p, end - p, "\"%s\":%.*f,", gChannelDefs[C::id].name,
+                             T::decimals, ch[C::id]);
+            p = n > 0 && n < end - p ? p + n : end;
+        }
+        return Next::format(p, end, ch, present);
+    }
+
+    // constexpr, the built-in table is checked at compile time
+    static constexpr bool check(const ChannelDef* defs)
+    {
+        return defs[C::id].type == T::xplm && defs[C::id].index == T::index &&
+               defs[C::id].group == C::group && Next::check(defs);
+    }
+};
+
+template <typename A, typename B> struct SchemaCat;
+template <typename... As, typename... Bs>
+struct SchemaCat<Schema<As...>, Schema<Bs...> > {
+    typedef Schema<As..., Bs...> type;
+};
+
+typedef Schema<
+    Chan<CH_LAT,   F64, GROUP_POSITION>
+    ,Chan<CH_LON,   F64, GROUP_POSITION>
+    ,Chan<CH_ALT,   F64, GROUP_POSITION>
+    ,Chan<CH_GS,    F32, GROUP_POSITION>
+    ,Chan<CH_HDG,   F32, GROUP_POSITION>
+    ,Chan<CH_PITCH, F32, GROUP_POSITION>
+    ,Chan<CH_ROLL,  F32, GROUP_POSITION>
+    ,Chan<CH_VS,    F32, GROUP_POSITION>
+    ,Chan<CH_IAS,   F32, GROUP_POSITION>
+> PositionSchema;
+
+typedef Schema<
+    Chan<CH_N1,    F32At<0>, GROUP_ENGINE>
+    ,Chan<CH_RPM,   F32At<0>, GROUP_ENGINE>
+    ,Chan<CH_EGT,   F32At<0>, GROUP_ENGINE>
+    ,Chan<CH_FF,    F32At<0>, GROUP_ENGINE>
+    ,Chan<CH_OILP,  F32At<0>, GROUP_ENGINE>
+> EngineSchema;
+
+typedef Schema<
+    Chan<CH_FUEL,     F32, GROUP_ENVIRONMENT>
+    ,Chan<CH_WIND_SPD, F32, GROUP_ENVIRONMENT>
+    ,Chan<CH_WIND_DIR, F32, GROUP_ENVIRONMENT>
+    ,Chan<CH_BARO,     F32, GROUP_ENVIRONMENT>
+    ,Chan<CH_OAT,      F32, GROUP_ENVIRONMENT>
+> EnvironmentSchema;
+
+// every built-in channel, in channel order
+typedef SchemaCat<SchemaCat<PositionSchema, EngineSchema>::type,
+                  EnvironmentSchema>::type BuiltinSchema;
+
+#endif /* SCHEMA_H */
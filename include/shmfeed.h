@@ -0,0 +1,59 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SHMFEED_H
+#define SHMFEED_H
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+ * Live sample feed in POSIX shared memory (shm=1), layout shared by the
+ * plugin and tools/shmreader.
+ *
+ * The plugin is the only writer. Every record slot carries its own
+ * sequence number: 2 * n + 1 while record n is being written and 2 * n + 2
+ * once it's complete. A reader copies a slot and accepts it only if the
+ * sequence was 2 * n + 2 both before and after the copy; a larger value
+ * means the writer lapped the reader. head is the number of records
+ * published. Readers never write to the segment.
+ */
+#define SHM_FEED_NAME "/datalogger"
+#define SHM_FEED_MAGIC (0x46534c44)     // "DLSF"
+#define SHM_FEED_VERSION (1)
+#define SHM_FEED_SLOTS (4096)           // power of two
+#define SHM_FEED_MAX_CHANNELS (64)
+
+struct ShmChannel {
+    char name[15];
+    uint8_t group;
+};
+
+struct ShmRecord {
+    std::atomic<uint64_t> seq;
+    uint32_t groups;            // channel groups sampled
+    int32_t cycle;              // sim frame number
+    int64_t wallTime;           // unix seconds
+    float elapsed;              // sim elapsed seconds
+    uint32_t flags;
+    double ch[SHM_FEED_MAX_CHANNELS];
+};
+
+struct ShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t schemaVersion;     // bumped whenever the channel table changes
+    uint32_t channelCount;
+    uint32_t slotCount;
+    uint32_t recordSize;
+    std::atomic<uint64_t> head;
+    ShmChannel channels[SHM_FEED_MAX_CHANNELS];
+};
+
+struct ShmFeed {
+    ShmHeader hdr;
+    ShmRecord slots[SHM_FEED_SLOTS];
+};
+
+#endif /* SHMFEED_H */
@@ -0,0 +1,15 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SHMSINK_H
+#define SHMSINK_H
+
+#include "./sample.h"
+
+// POSIX only, the calls are no-ops elsewhere
+bool shmSinkOpen(void);
+void shmSinkPublish(const Sample &s);
+void shmSinkClose(void);
+
+#endif /* SHMSINK_H */
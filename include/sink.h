@@ -0,0 +1,101 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <atomic>
+#include <thread>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./ring.h"
+
+/*
+ * Output fan-out. The writer thread encodes each block of samples once
+ * per encoding that has subscribers into refcounted, immutable buffers
+ * and hands every buffer to all sinks subscribed to its encoding. Each
+ * sink drains its own queue on its own thread; its policy decides what
+ * happens when the queue is full, so a slow sink never stalls the sim
+ * and, unless it blocks, never stalls the other sinks.
+ */
+#define SINK_BUFFER_SIZE (8192)
+#define SINK_QUEUE_SIZE (256)       // power of two
+#define SINK_BATCH (16)             // buffers handed to a sink per call
+#define MAX_SINKS (16)
+
+enum {
+    ENC_GPX                 // tag is the track, 0 the user's plane
+    ,ENC_BINLOG
+    ,ENC_UDP                // one datagram per buffer
+    ,ENC_GDL90              // one datagram per buffer
+    ,ENC_NMEA
+    ,ENC_HTTP               // one server-sent event per buffer
+    ,ENC_SQLITE
+    ,ENC_ARROW
+    ,NUM_ENCODINGS
+};
+
+enum {
+    SINK_DROP               // a full queue drops the new buffer
+    ,SINK_BLOCK             // the encoder waits for room
+};
+
+struct SinkBuffer {
+    std::atomic<int> refs;
+    uint32_t tag;           // encoding specific
+    size_t len;
+    SinkBuffer* next;       // free list
+    char data[SINK_BUFFER_SIZE];
+};
+
+struct Sink;
+typedef void (*SinkWriteFn)(Sink* s, SinkBuffer* const* bufs, int n);
+typedef void (*SinkFn)(Sink* s);
+
+/**
+ * write and flush run on the sink's thread, flush whenever the queue
+ * runs dry. close runs on the caller of sinkStopAll once the thread
+ * has drained the queue and exited.
+ */
+struct Sink {
+    const char* name;       // the encoding's name
+    int encoding;
+    int policy;
+    void* ctx;
+    SinkWriteFn write;
+    SinkFn flush;
+    SinkFn close;
+    SpscRing<SinkBuffer*, SINK_QUEUE_SIZE> queue;
+    std::thread th;
+    std::atomic<bool> run;
+    uint64_t dropped;       // writer thread only
+};
+
+/**
+ * Appends an encoding's output to buffers, publishing each one as it
+ * fills. Writer thread only.
+ */
+struct SinkStream {
+    int encoding;
+    uint32_t tag;
+    SinkBuffer* cur;
+};
+
+extern const char* gEncodingNames[NUM_ENCODINGS];
+
+Sink* sinkCreate(int encoding, int policy, void* ctx, SinkWriteFn write,
+                 SinkFn flush, SinkFn close);
+void sinkStartAll(void);
+void sinkStopAll(void);
+bool sinkSubscribed(int encoding);
+
+SinkBuffer* sinkBufferGet(uint32_t tag);
+void sinkBufferPut(SinkBuffer* b);
+void sinkPublish(int encoding, SinkBuffer* b);
+
+void sinkAppend(SinkStream &st, const char* p, size_t n);
+void sinkEnd(SinkStream &st);
+
+#endif /* SINK_H */
@@ -0,0 +1,33 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SQLITESINK_H
+#define SQLITESINK_H
+
+#include <string>
+
+#include "./sample.h"
+
+/*
+ * SQLite output (sqlite=1), built in when the SQLite amalgamation is in
+ * sqlite/. One database holds every session:
+ *
+ *      sessions(id, name, started, ended, samples)
+ *      channels(session, idx, name, grp)
+ *      samples(session, time, wall, cycle, <channel>...)
+ *
+ * time is the sim elapsed time and wall the unix time. A channel column
+ * is NULL in the rows where its group wasn't sampled, columns for new
+ * channels are added as they appear. samples is indexed on
+ * (session, time) and on wall.
+ */
+#define SQLITE_DEFAULT_FILE "DataLog.sqlite"
+
+// writer thread only; the rows go to a sink that inserts them in
+// batched transactions
+bool sqliteSinkOpen(const std::string &file, const std::string &session);
+void sqliteEncode(const Sample &s, uint64_t changed);
+void sqliteEncodeEnd(void);
+
+#endif /* SQLITESINK_H */
@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+#include "./sink.h"
+
+// histogram buckets, plus the implicit +Inf one
+#define STATS_BUCKETS (12)
+
+/**
+ * A Prometheus style histogram of integer observations, the buckets
+ * aren't cumulative here, the exposition sums them.
+ */
+struct StatsHistogram {
+    std::atomic<uint64_t> bucket[STATS_BUCKETS + 1];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+};
+
+// bucket upper bounds of the duration histograms, in microseconds, and
+// of the queue depth histogram, in samples
+extern const uint64_t gLatencyBoundsUs[STATS_BUCKETS];
+extern const uint64_t gDepthBounds[STATS_BUCKETS];
+
+/**
+ * Plugin performance counters, published read-only as datalogger/stats/
+ * datarefs. Each counter has a single writer and is read relaxed.
+ */
+struct Stats {
+    std::atomic<uint64_t> captured;     // samples queued by the flight loop
+    std::atomic<uint64_t> written;      // samples handled by the writer
+    std::atomic<uint64_t> dropped;      // samples lost to a full queue
+    std::atomic<uint64_t> bytesWritten; // all files, this session, added
+                                        // by every file sink
+    std::atomic<uint64_t> sinkDropped;  // output buffers lost to full sinks
+    std::atomic<uint64_t> fileSize;     // the main GPX file
+    std::atomic<float> cbLastUs;        // LoggerCallback duration
+    std::atomic<float> cbAvgUs;
+    std::atomic<float> cbMaxUs;
+    std::atomic<float> writerLagMs;     // sample capture to written
+    std::atomic<uint64_t> filesOpened;  // every output file, shared
+    StatsHistogram cbUs;                // LoggerCallback duration
+    StatsHistogram queueDepth;          // at each capture
+    StatsHistogram writerLagUs;
+    StatsHistogram flushUs[NUM_ENCODINGS];  // sink flushes, shared
+};
+
+extern Stats gStats;
+
+void statsRegister(void);
+void statsUnregister(void);
+void statsReset(void);
+void statsCallbackTime(float us);
+
+// monotonic microseconds, safe to call from any thread
+static inline int64_t statsTickUs(void)
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+               steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void statsAdd(std::atomic<uint64_t> &c, uint64_t n)
+{
+    // single writer, a relaxed load and store is enough
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// counters with a writer per sink thread
+static inline void statsAddShared(std::atomic<uint64_t> &c, uint64_t n)
+{
+    c.fetch_add(n, std::memory_order_relaxed);
+}
+
+static inline int statsBucket(const uint64_t* bounds, uint64_t v)
+{
+    int b = 0;
+    while (b < STATS_BUCKETS && v > bounds[b])
+        b++;
+    return b;
+}
+
+static inline void statsObserve(StatsHistogram &h, const uint64_t* bounds,
+                                uint64_t v)
+{
+    statsAdd(h.bucket[statsBucket(bounds, v)], 1);
+    statsAdd(h.sum, v);
+    statsAdd(h.count, 1);
+}
+
+static inline void statsObserveShared(StatsHistogram &h, const uint64_t* bounds,
+                                      uint64_t v)
+{
+    statsAddShared(h.bucket[statsBucket(bounds, v)], 1);
+    statsAddShared(h.sum, v);
+    statsAddShared(h.count, 1);
+}
+
+#endif /* STATS_H */
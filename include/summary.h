@@ -0,0 +1,205 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SUMMARY_H
+#define SUMMARY_H
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "./geo.h"
+#include "./gpxformat.h"
+
+/*
+ * A track's summary, kept up to date point by point by the writer and
+ * written as a small JSON sidecar next to the GPX file, <gpx file>.json,
+ * so listing flights doesn't mean parsing their tracks. The writer
+ * rewrites it with every block index entry and once more when the file
+ * is closed, a session that crashed has a summary at most a block old
+ * with "complete": false. The crc32 (see crc32.h) covers the first
+ * "size" bytes of the track. Shared with the tools, which summarize a
+ * track that has no sidecar the same way.
+ */
+#define SUMMARY_SUFFIX ".json"
+#define SUMMARY_VERSION (1)
+
+/**
+ * Distances in meters, speeds in meters per second. A summary without
+ * points has min > max, maxGs < 0 when no groundspeed was sampled.
+ */
+struct SessionSummary {
+    uint64_t points;
+    uint32_t segments;
+    uint32_t wallFirst;         // unix seconds
+    uint32_t wallLast;
+    float elapsedFirst;         // sim seconds
+    float elapsedLast;
+    double distance;            // along the track, segment breaks excluded
+    double minLat;
+    double maxLat;
+    double minLon;
+    double maxLon;
+    double minAlt;
+    double maxAlt;
+    double maxGs;
+    double lat;                 // the last point
+    double lon;
+};
+
+static inline void summaryReset(SessionSummary &m)
+{
+    m.points = 0;
+    m.segments = 0;
+    m.wallFirst = m.wallLast = 0;
+    m.elapsedFirst = m.elapsedLast = 0.0f;
+    m.distance = 0.0;
+    m.minLat = m.minLon = m.minAlt = 1e300;
+    m.maxLat = m.maxLon = m.maxAlt = -1e300;
+    m.maxGs = -1.0;
+    m.lat = m.lon = 0.0;
+}
+
+/**
+ * Adds a track point, newSegment when it's the first of its segment.
+ */
+static inline void summaryAdd(SessionSummary &m, uint32_t wall, float elapsed,
+                              double lat, double lon, double alt,
+                              bool newSegment)
+{
+    if (m.points == 0) {
+        m.wallFirst = wall;
+        m.elapsedFirst = elapsed;
+        newSegment = true;
+    }
+    if (newSegment)
+        m.segments += 1;
+    else
+        m.distance += haversine(m.lat, m.lon, lat, lon);
+    m.wallLast = wall;
+    m.elapsedLast = elapsed;
+    m.points += 1;
+    m.lat = lat;
+    m.lon = lon;
+    if (lat < m.minLat) m.minLat = lat;
+    if (lat > m.maxLat) m.maxLat = lat;
+    if (lon < m.minLon) m.minLon = lon;
+    if (lon > m.maxLon) m.maxLon = lon;
+    if (alt < m.minAlt) m.minAlt = alt;
+    if (alt > m.maxAlt) m.maxAlt = alt;
+}
+
+static inline void summarySpeed(SessionSummary &m, double gs)
+{
+    if (gs > m.maxGs)
+        m.maxGs = gs;
+}
+
+/**
+ * The sidecar's text, one key per line. file is the track's name without
+ * its directory, size its length in bytes when summarized.
+ */
+static inline std::string summaryJson(const SessionSummary &m,
+                                      const std::string &file, uint64_t size,
+                                      uint32_t crc, bool complete)
+{
+    char buf[1024];
+    bool pos = m.points > 0;
+    std::string first = pos ? gpxDateTime((time_t)m.wallFirst, false) : "";
+    std::string last = pos ? gpxDateTime((time_t)m.wallLast, false) : "";
+    int n = snprintf(buf, sizeof(buf),
+        "{\n"
+        "\"version\":%d,\n"
+        "\"file\":\"%s\",\n"
+        "\"size\":%llu,\n"
+        "\"crc32\":%u,\n"
+        "\"complete\":%s,\n"
+        "\"start\":\"%s\",\n"
+        "\"end\":\"%s\",\n"
+        "\"startTime\":%u,\n"
+        "\"endTime\":%u,\n"
+        "\"duration\":%u,\n"
+        "\"simDuration\":%.3f,\n"
+        "\"points\":%llu,\n"
+        "\"segments\":%u,\n"
+        "\"distance\":%.1f,\n",
+        SUMMARY_VERSION, file.c_str(), (unsigned long long)size, crc,
+        complete ? "true" : "false", first.c_str(), last.c_str(),
+        m.wallFirst, m.wallLast, m.wallLast - m.wallFirst,
+        pos ? (double)(m.elapsedLast - m.elapsedFirst) : 0.0,
+        (unsigned long long)m.points, m.segments, m.distance);
+    std::string s(buf, n > 0 ? (size_t)n : 0);
+    if (pos) {
+        n = snprintf(buf, sizeof(buf),
+            "\"south\":%.8f,\n"
+            "\"west\":%.8f,\n"
+            "\"north\":%.8f,\n"
+            "\"east\":%.8f,\n"
+            "\"minAlt\":%.1f,\n"
+            "\"maxAlt\":%.1f,\n",
+            m.minLat, m.minLon, m.maxLat, m.maxLon, m.minAlt, m.maxAlt);
+        s.append(buf, n > 0 ? (size_t)n : 0);
+    }
+    if (m.maxGs >= 0.0) {
+        n = snprintf(buf, sizeof(buf), "\"maxGroundspeed\":%.2f,\n", m.maxGs);
+        s.append(buf, n > 0 ? (size_t)n : 0);
+    }
+    // no trailing comma on the last key
+    s.erase(s.size() - 2, 1);
+    s += "}\n";
+    return s;
+}
+
+/**
+ * Reads back a sidecar written by summaryJson, false if it isn't one.
+ * The sim times come back as a span starting at 0 and the last point
+ * isn't kept.
+ */
+static inline bool summaryParse(const std::string &json, SessionSummary &m,
+                                uint64_t &size, uint32_t &crc, bool &complete)
+{
+    summaryReset(m);
+    size = 0;
+    crc = 0;
+    complete = false;
+    int version = 0;
+    // each "key": is followed by its value, a string value is skipped
+    // as a key that has no ':'
+    size_t p = 0;
+    while ((p = json.find('"', p)) != std::string::npos) {
+        size_t q = json.find('"', p + 1);
+        if (q == std::string::npos || q + 1 >= json.size())
+            break;
+        if (json[q + 1] != ':') {
+            p = q + 1;
+            continue;
+        }
+        std::string key = json.substr(p + 1, q - p - 1);
+        const char* v = json.c_str() + q + 2;
+        double d = strtod(v, NULL);
+        if (key == "version") version = (int)d;
+        else if (key == "size") size = strtoull(v, NULL, 10);
+        else if (key == "crc32") crc = (uint32_t)strtoul(v, NULL, 10);
+        else if (key == "complete") complete = strncmp(v, "true", 4) == 0;
+        else if (key == "startTime") m.wallFirst = (uint32_t)strtoul(v, NULL, 10);
+        else if (key == "endTime") m.wallLast = (uint32_t)strtoul(v, NULL, 10);
+        else if (key == "simDuration") m.elapsedLast = (float)d;
+        else if (key == "points") m.points = strtoull(v, NULL, 10);
+        else if (key == "segments") m.segments = (uint32_t)strtoul(v, NULL, 10);
+        else if (key == "distance") m.distance = d;
+        else if (key == "south") m.minLat = d;
+        else if (key == "west") m.minLon = d;
+        else if (key == "north") m.maxLat = d;
+        else if (key == "east") m.maxLon = d;
+        else if (key == "minAlt") m.minAlt = d;
+        else if (key == "maxAlt") m.maxAlt = d;
+        else if (key == "maxGroundspeed") m.maxGs = d;
+        p = q + 1;
+    }
+    return version == SUMMARY_VERSION;
+}
+
+#endif /* SUMMARY_H */
@@ -0,0 +1,55 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+#include "./stats.h"
+
+/*
+ * Opt-in self profiling (trace=1). While a logging session runs each
+ * traced scope is recorded as a complete event in a per-thread buffer,
+ * a ring of its most recent events. The buffers are dumped as a Chrome
+ * trace-event .json file when the session stops, loadable in
+ * chrome://tracing or Perfetto.
+ *
+ * Pass -DNTRACE to compile the trace points out entirely.
+ */
+
+extern std::atomic<bool> gTracing;
+
+void traceStart(void);
+void traceStop(const std::string &file);
+void traceRecord(const char* name, int64_t ts, int64_t dur);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(name), start_(-1)
+    {
+        if (gTracing.load(std::memory_order_relaxed))
+            start_ = statsTickUs();
+    }
+
+    ~TraceScope()
+    {
+        if (start_ >= 0)
+            traceRecord(name_, start_, statsTickUs() - start_);
+    }
+
+private:
+    const char* name_;
+    int64_t start_;
+};
+
+#ifdef NTRACE
+    #define TRACE_SCOPE(name)
+#else
+    #define TRACE_SCOPE(name)           TraceScope trace_scope__(name)
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,39 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef UDPFEED_H
+#define UDPFEED_H
+
+#include <stdint.h>
+
+/*
+ * UDP telemetry datagrams (udp=1), host (little endian) byte order.
+ *
+ * datagram:
+ *      u32     UDP_FEED_MAGIC
+ *      u16     UDP_FEED_VERSION
+ *      u16     record count
+ *      u32     datagram sequence number, +1 per datagram, a gap means loss
+ *      records
+ *
+ * record:
+ *      u16     record size in bytes, including this field
+ *      u64     channel bitmap, bit n set when channel n is present
+ *      i32     sim cycle (frame) number
+ *      u32     wall clock, unix seconds
+ *      f32     sim elapsed time, seconds
+ *      f64[]   the channels in the bitmap, in channel order
+ *
+ * Samples are packed into a datagram until the next one wouldn't fit
+ * the configured payload size.
+ */
+#define UDP_FEED_MAGIC (0x44554c44)     // "DLUD"
+#define UDP_FEED_VERSION (1)
+#define UDP_FEED_HEADER_SIZE (12)
+#define UDP_FEED_RECORD_HEADER_SIZE (22)
+#define UDP_FEED_DEFAULT_PORT (49200)
+#define UDP_FEED_DEFAULT_MTU (1472)     // 1500 byte ethernet minus IP/UDP
+#define UDP_FEED_MAX_PAYLOAD (8192)
+
+#endif /* UDPFEED_H */
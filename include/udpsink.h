@@ -0,0 +1,17 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef UDPSINK_H
+#define UDPSINK_H
+
+#include <string>
+
+#include "./sample.h"
+
+// writer thread only; the datagrams go to a net sink per host
+bool udpSinkOpen(const std::string &hosts, int port, int mtu);
+void udpEncode(const Sample &s, uint64_t changed);
+void udpEncodeEnd(void);
+
+#endif /* UDPSINK_H */
@@ -0,0 +1,18 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <string>
+
+#include "./sample.h"
+
+// filled by the flight loop, drained by the writer thread
+extern SampleQueue gSampleQueue;
+
+bool writerStart(std::string &dir);
+void writerStop(void);
+
+#endif /* WRITER_H */
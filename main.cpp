@@ -33,6 +33,7 @@
 #include <atomic>
 #include <cstring>
 #include <algorithm>
+#include <cfloat>
 
 #include "./SDK/CHeaders/XPLM/XPLMPlugin.h"
 #include "./SDK/CHeaders/XPLM/XPLMProcessing.h"
@@ -40,10 +41,21 @@
 #include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
 #include "./SDK/CHeaders/XPLM/XPLMDisplay.h"
 #include "./SDK/CHeaders/XPLM/XPLMGraphics.h"
+#include "./SDK/CHeaders/XPLM/XPLMPlanes.h"
 
 // #include "readerwriterqueue.h"
 #include "./include/defs.h"
+#include "./include/msgqueue.h"
 #include "./include/main.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/writer.h"
+#include "./include/stats.h"
+#include "./include/trace.h"
+#include "./include/panel.h"
+#include "./include/shmsink.h"
+#include "./include/httpd.h"
 
 
 using namespace std;
@@ -54,12 +66,9 @@ static bool error_bit_set(ifstream* f);
 static bool dir_exists(const string &dir);
 static void enableLogging(void);
 static void disableLogging(void);
-static bool openLogFile(void);
-static void closeLogFile(void);
-static const string currentDateTime(bool useDash);
-static void writeFileProlog(const string &t);
-static void writeFileEpilog(void);
-static void writeData(double lat, double lon, double alt, const string &t);
+static void updateTrafficCount(void);
+static char* statusLine(void);
+static void setWindowGeometry(void);
 static void DrawWindowCallback(XPLMWindowID inWindowID, void* inRefcon);
 static void HandleKeyCallback(XPLMWindowID inWindowID, char inKey,
                               XPLMKeyFlags inFlags, char inVirtualKey,
@@ -69,6 +78,7 @@ static int HandleMouseCallback(XPLMWindowID inWindowID, int x, int y,
 static float LoggerCallback(float inElapsedSinceLastCall,
                             float inElapsedTimeSinceLastFlightLoop,
                             int inCounter, void* inRefcon);
+static float loggerSample(void);
 static float StatusCheckCallback(float inElapsedSinceLastCall,
                                  float inElapsedTimeSinceLastFlightLoop,
                                  int inCounter, void* inRefcon);
@@ -94,8 +104,10 @@ static XPLMWindowID gDataLogWindow = NULL;
 static atomic<bool> gPluginEnabled(false);
 // static atomic<int> gPlaneLoaded(0);
 
-// time interval > 0.0 (no callback) > flight loop frame rate
-static atomic<float> gFlCbInterval(0.100f); // 10Hz update rate?
+// next sample deadline per channel group, in sim elapsed seconds
+static float gGroupDue[NUM_GROUPS];
+// sim frame of the last sample
+static int gLastCycle = -1;
 
 #define WINDOW_WIDTH (220)
 #define WINDOW_HEIGHT (15)
@@ -111,9 +123,12 @@ enum {
 };
 
 XPLMDataRef gs_dref = NULL;
-XPLMDataRef lat_dref = NULL;
-XPLMDataRef lon_dref = NULL;
-XPLMDataRef alt_dref = NULL;
+
+// multiplayer planes, indexed from 0 for X-Plane's plane 1
+XPLMDataRef traffic_lat_dref[MAX_TRAFFIC];
+XPLMDataRef traffic_lon_dref[MAX_TRAFFIC];
+XPLMDataRef traffic_alt_dref[MAX_TRAFFIC];
+static atomic<int> gTrafficCount(0);
 
 static const string gLogFileName = "DataLogPath.txt";
 static string gLogFilePath = "";
@@ -123,7 +138,7 @@ static atomic<bool> gFileOpenErr(false);
 static atomic<bool> gFlashUI(false);
 static atomic<bool> gFlashUIMsgOn(false);
 static atomic<int> gLogStatIndCnt(1);
-static ofstream gFd;
+static atomic<bool> gNewSegment(false);
 
 XPLMDataRef panel_visible_win_t_dataref;
 
@@ -158,6 +173,12 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc)
                 gLogFilePath = path;
             // LPRINTF(path.c_str()); LPRINTF("\n");
             // LPRINTF(gLogFilePath.c_str()); LPRINTF("\n");
+
+            // the remaining lines are key=value options
+            string line;
+            while (getline(pathFile, line))
+                configParseLine(line);
+            configParseDone();
         } else {
             LPRINTF("DataLogger Plugin: getline failed... \n");
         }
@@ -165,9 +186,18 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc)
     }
 
     gs_dref = XPLMFindDataRef("sim/flightmodel/position/groundspeed");
-    lat_dref = XPLMFindDataRef("sim/flightmodel/position/latitude");
-    lon_dref = XPLMFindDataRef("sim/flightmodel/position/longitude");
-    alt_dref = XPLMFindDataRef("sim/flightmodel/position/elevation");
+    channelsInit();
+    statsRegister();
+    if (gConfig.shm)
+        shmSinkOpen();
+    if (gConfig.http)
+        httpStart(gConfig.httpPort);
+    for (int i = 0; i < MAX_TRAFFIC; i++) {
+        string plane = "sim/multiplayer/position/plane" + to_string(i + 1);
+        traffic_lat_dref[i] = XPLMFindDataRef((plane + "_lat").c_str());
+        traffic_lon_dref[i] = XPLMFindDataRef((plane + "_lon").c_str());
+        traffic_alt_dref[i] = XPLMFindDataRef((plane + "_el").c_str());
+    }
     XPLMRegisterFlightLoopCallback(StatusCheckCallback, 5.0, NULL);
     panel_visible_win_t_dataref = XPLMFindDataRef("sim/graphics/view/panel_visible_win_t");
     int top = (int)XPLMGetDataf(panel_visible_win_t_dataref);
@@ -228,120 +258,6 @@ bool dir_exists(const string &dir)
     return false;
 }
 
-/**
- *
- */
-bool openLogFile(void)
-{
-    if (gFd.is_open())
-        closeLogFile();
-
-    string t = currentDateTime(true);
-    string f = string("DataLog-") +  t + string(".gpx");
-    string file = gLogFilePath + f;
-
-    // LPRINTF(file.c_str()); LPRINTF("\n");
-
-    gFd.open(file, ofstream::app); // creates the file if it doesn't exist
-    if (!gFd.is_open()) {
-        LPRINTF("DataLogger Plugin: unable to open the output file ");
-        LPRINTF(file.c_str()); LPRINTF("\n");
-        LPRINTF("DataLogger Plugin: trying to open the base file...\n");
-        gFd.open(f, ofstream::app);
-        if (!gFd.is_open()) {
-            LPRINTF("DataLogger Plugin: couldn't open the base file either...\n");
-            return false;
-        } else {
-            gLogFilePath = "";
-        }
-    }
-    writeFileProlog(t);
-    return true;
-}
-
-/**
- *
- */
-void closeLogFile(void)
-{
-    if (gFd.is_open()) {
-        writeFileEpilog();
-        gFd.close();
-    }
-}
-
-/**
- *
- */
-void writeFileProlog(const string &t)
-{
-    gFd << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-    gFd << "<gpx version=\"1.0\">\n";
-    gFd << "<metadata>\n";
-    gFd << "<time>" << t << "</time>\n";
-    gFd << "</metadata>\n";
-    gFd << "<trk><name>DataLogger plugin</name><trkseg>\n";
-}
-
-/**
- *
- */
-void writeFileEpilog(void)
-{
-    gFd << "</trkseg></trk>\n";
-    gFd << "</gpx>\n";
-}
-
-/**
- *
- */
-void writeData(double lat, double lon, double alt, const string &t)
-{
-    static double lat_ = 0.0;
-    static double lon_ = 0.0;
-    static double alt_ = 0.0;
-
-    if (lat == lat_ && lon == lon_ && alt == alt_)
-        return;
-
-    lat_ = lat;
-    lon_ = lon;
-    alt_ = alt;
-
-    // <trkpt lat="46.57608333" lon="8.89241667"><ele>2376.640205</ele></trkpt>
-    gFd << "<trkpt lat=\""
-        << to_string(lat)
-        << "\" lon=\""
-        << to_string(lon)
-        << "\"><ele>"
-        << to_string(alt)
-        // << to_string(static_cast<int>(alt))
-        // << to_string(static_cast<int>(alt/METERS_PER_FOOT))
-        << "</ele><time>"
-        << t
-        << "</time></trkpt>\n";
-}
-
-/**
- * Returns the current date and Zulu time.
- *
- * @return
- *      if useDash: YYYY-MM-DDTHH-MM-SSZ
- *      else:       YYYY-MM-DDTHH:MM:SSZ
- */
-const string currentDateTime(bool useDash)
-{
-    time_t now = time(0);
-    string buf(22,  '\0');
-    // strftime(buf, sizeof(buf), "%FT%XZ", gmtime(&now));
-    // strftime(buf, sizeof(buf), "%FT%XZ", localtime(&now));
-    if (useDash)
-        strftime((char*)buf.c_str(), buf.length(), "%Y-%m-%dT%H-%M-%SZ", gmtime(&now));
-    else
-        strftime((char*)buf.c_str(),  buf.length(), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
-    return buf.substr(0, 20);
-}
-
 /**
  *
  */
@@ -353,9 +269,13 @@ float StatusCheckCallback(float inElapsedSinceLastCall,
                           float inElapsedTimeSinceLastFlightLoop, int inCounter,
                           void* inRefcon)
 {
+    TRACE_SCOPE("StatusCheckCallback");
     static int cnt = 0;
     static bool doGrndCheck = true;
 
+    // the writer and sink threads' messages
+    msgDrain();
+
     if (!gPluginEnabled.load()) {
         // LPRINTF("DataLogger Plugin: StatusCheckCallback...\n");
         return 10.0;
@@ -393,6 +313,7 @@ float StatusCheckCallback(float inElapsedSinceLastCall,
         gLogStatIndCnt.store(1);
         return cb_after;
     } else {
+        panelUpdate();
         gLogStatIndCnt.fetch_add(1);
         if (gLogStatIndCnt.load() > LOGSTAT_IND_THRESH)
             gLogStatIndCnt.store(1);
@@ -410,22 +331,113 @@ float LoggerCallback(float inElapsedSinceLastCall,
                      float inElapsedTimeSinceLastFlightLoop,
                      int inCounter, void* inRefcon)
 {
+    TRACE_SCOPE("LoggerCallback");
     if (!gPluginEnabled.load() || !gLogging.load()) {
         return 0.0;  // disable the callback
     }
+
+    int64_t start = statsTickUs();
+    float cb_after = loggerSample();
+    statsCallbackTime((float)(statsTickUs() - start));
+    return cb_after;
+}
+
+/**
+ * The single sampling callback for all channel groups. Each wake reads
+ * only the groups that are due and asks to be called back at the
+ * earliest of the group deadlines.
+ */
+#define MIN_CB_INTERVAL (0.001f)
+float loggerSample(void)
+{
+    // a second call within the same frame would read the same state
+    int cycle = XPLMGetCycleNumber();
+    if (cycle == gLastCycle)
+        return -1.0;  // next frame
+
+    float now = XPLMGetElapsedTime();
+    uint32_t due = 0;
+    float next = FLT_MAX;
+    for (int g = 0; g < NUM_GROUPS; g++) {
+        if (gConfig.rate[g] <= 0.0f)
+            continue;
+        if (now >= gGroupDue[g]) {
+            due |= GROUP_BIT(g);
+            // don't try to catch up after a stall
+            gGroupDue[g] = max(gGroupDue[g] + 1.0f / gConfig.rate[g], now);
+        }
+        next = min(next, gGroupDue[g]);
+    }
+    if (next == FLT_MAX)
+        return 0.0;  // every group is disabled
+    float cb_after = max(next - now, MIN_CB_INTERVAL);
+    if (due == 0)
+        return cb_after;
+    gLastCycle = cycle;
+
     // LPRINTF("DataLogger Plugin: LoggerCallback writing data...\n");
-    writeData(XPLMGetDataf(lat_dref),
-                XPLMGetDataf(lon_dref),
-                XPLMGetDataf(alt_dref),
-                currentDateTime(false));
-    return gFlCbInterval.load();
+    Sample* s = gSampleQueue.claim();
+    if (s == NULL) {
+        // the writer is behind, drop the sample rather than block the sim
+        statsAdd(gStats.dropped, 1);
+        return cb_after;
+    }
+    // a segment break waits for a position sample, the tracks see no other
+    s->flags = (due & GROUP_BIT(GROUP_POSITION)) && gNewSegment.exchange(false) ?
+               SAMPLE_NEW_SEGMENT : 0;
+    s->groups = due;
+    s->wallTime = time(0);
+    s->cycle = cycle;
+    s->tick = statsTickUs();
+    s->elapsed = now;
+    channelsRead(s->ch, due);
+    if (due & GROUP_BIT(GROUP_POSITION))
+        panelAddSample((float)(s->ch[CH_ALT] / METERS_PER_FOOT),
+                       (float)(s->ch[CH_GS] * MPS_TO_KNOTS));
+
+    // one pass per field across all planes
+    int n = 0;
+    if ((gConfig.traffic || gConfig.gdl90) && (due & GROUP_BIT(GROUP_POSITION)))
+        n = gTrafficCount.load();
+    s->trafficCount = n;
+    for (int i = 0; i < n; i++)
+        s->trafficLat[i] = XPLMGetDatad(traffic_lat_dref[i]);
+    for (int i = 0; i < n; i++)
+        s->trafficLon[i] = XPLMGetDatad(traffic_lon_dref[i]);
+    for (int i = 0; i < n; i++)
+        s->trafficAlt[i] = XPLMGetDatad(traffic_alt_dref[i]);
+    shmSinkPublish(*s);
+    gSampleQueue.commit();
+    statsAdd(gStats.captured, 1);
+    statsObserve(gStats.queueDepth, gDepthBounds, gSampleQueue.size());
+    return cb_after;
+}
+
+/**
+ * Caches the number of active multiplayer planes, the user's plane
+ * isn't counted.
+ */
+void updateTrafficCount(void)
+{
+    int total;
+    int active;
+    XPLMPluginID controller;
+    XPLMCountAircraft(&total, &active, &controller);
+    gTrafficCount.store(max(0, min(active - 1, MAX_TRAFFIC)));
 }
 
 /**
  *
  */
 void enableLogging(void){
-    if (openLogFile()) {
+    statsReset();
+    panelClear();
+    if (writerStart(gLogFilePath)) {
+        updateTrafficCount();
+        gNewSegment.store(false);
+        for (int g = 0; g < NUM_GROUPS; g++)
+            gGroupDue[g] = 0.0f;
+        gLastCycle = -1;
         gLogging.store(true);
         XPLMRegisterFlightLoopCallback(LoggerCallback, -1.0, NULL);
     } else {
@@ -440,7 +452,8 @@ void disableLogging(void)
 {
     gLogging.store(false);
     XPLMUnregisterFlightLoopCallback(LoggerCallback, NULL);
-    closeLogFile();
+    writerStop();
+    msgDrain();
 }
 
 /**
@@ -451,8 +464,12 @@ PLUGIN_API void XPluginStop(void)
     gPluginEnabled.store(false);
     gLogging.store(false);
     XPLMUnregisterFlightLoopCallback(LoggerCallback, NULL);
-    closeLogFile();
+    writerStop();
     XPLMUnregisterFlightLoopCallback(StatusCheckCallback, NULL);
+    statsUnregister();
+    shmSinkClose();
+    httpStop();
+    msgDrain();
     LPRINTF("DataLogger Plugin: XPluginStop\n");
 }
 
@@ -487,24 +504,35 @@ PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFrom, long inMsg, void* inP
         case XPLM_MSG_PLANE_LOADED:
             // gPlaneLoaded.store();
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_PLANE_LOADED\n");
+            // only a user plane reload breaks the track
+            if (reinterpret_cast<size_t>(inParam) == 0 && gLogging.load())
+                gNewSegment.store(true);
+            else
+                updateTrafficCount();
             break;
         case XPLM_MSG_AIRPORT_LOADED:
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_AIRPORT_LOADED\n");
+            if (gLogging.load())
+                gNewSegment.store(true);
             break;
         case XPLM_MSG_SCENERY_LOADED:
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_SCENERY_LOADED\n");
             break;
         case XPLM_MSG_AIRPLANE_COUNT_CHANGED:
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_AIRPLANE_COUNT_CHANGED\n");
+            updateTrafficCount();
             break;
         case XPLM_MSG_PLANE_CRASHED:
             // XXX: system state and procedure, what's difference between
             // an unloaded and crashed plane?
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_PLANE_CRASHED\n");
+            if (gLogging.load())
+                gNewSegment.store(true);
             break;
         case XPLM_MSG_PLANE_UNLOADED:
             // gPlaneLoaded.store();
             // LPRINTF("DataLogger Plugin: XPluginReceiveMessage XPLM_MSG_PLANE_UNLOADED\n");
+            updateTrafficCount();
             break;
         default:
             // unknown, anything to do?
@@ -513,12 +541,48 @@ PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFrom, long inMsg, void* inP
     } // if (inFrom == XPLM_PLUGIN_XPLANE)
 }
 
+/**
+ * Returns the status window text. It only changes about once a second
+ * while the window is drawn every frame, so the text is kept in a static
+ * buffer and rebuilt only when the state it's made from changes.
+ */
+#define STATUS_LINE_SIZE (64)
+char* statusLine(void)
+{
+    static char line[STATUS_LINE_SIZE];
+    static int version = -1;
+
+    bool logging = gLogging.load();
+    bool fileErr = gFileOpenErr.load();
+    bool flash = gFlashUI.load();
+    bool flashOn = gFlashUIMsgOn.load();
+    int cnt = min(gLogStatIndCnt.load(), STATUS_LINE_SIZE - 32);
+    int v = logging | (fileErr << 1) | (flash << 2) | (flashOn << 3) | (cnt << 4);
+    if (v == version)
+        return line;
+    version = v;
+
+    if (logging) {
+        int n = snprintf(line, sizeof(line), "Data Logger :: Enabled ");
+        memset(line + n, '.', cnt);
+        line[n + cnt] = '\0';
+    } else if (fileErr) {
+        strcpy(line, "Data Logger :: Error Opening File.");
+    } else if (flash && !flashOn) {
+        strcpy(line, "Data Logger ::");
+    } else {
+        strcpy(line, "Data Logger :: Click To Enable...");
+    }
+    return line;
+}
+
 /**
  *
  */
 #define FILEERR_OFF_THRESH (120)
 void DrawWindowCallback(XPLMWindowID inWindowID, void* inRefcon)
 {
+    TRACE_SCOPE("DrawWindowCallback");
     // RGB: White [1.0, 1.0, 1.0], Lime Green [0.0, 1.0, 0.0]
     static float datalogger_color[] = {0.0, 1.0, 0.0};
     static int errCnt = 0;
@@ -535,37 +599,29 @@ void DrawWindowCallback(XPLMWindowID inWindowID, void* inRefcon)
     XPLMGetWindowGeometry(inWindowID, &left, &top, &right, &bottom);
     XPLMDrawTranslucentDarkBox(left, top, right, bottom);
 
-    string str1;
     switch (reinterpret_cast<size_t>(inRefcon)) {
     case DATALOGGER_WINDOW:
-        if (gLogging.load()) {
-            str1 = "Data Logger :: Enabled " + string(gLogStatIndCnt.load(), '.');
-        } else {
-            if (gFileOpenErr.load()) {
-                errCnt += 1;
-                str1 = "Data Logger :: Error Opening File.";
-                if (errCnt >= FILEERR_OFF_THRESH) {
-                    errCnt = 0;
-                    gFileOpenErr.store(false);
-                }
-            } else {
-                if (gFlashUI.load()) {
-                    if (gFlashUIMsgOn.load()) {
-                        str1 = "Data Logger :: Click To Enable...";
-                    } else {
-                        str1 = "Data Logger ::";
-                    }
-                } else {
-                    str1 = "Data Logger :: Click To Enable...";
-                }
+        if (!gLogging.load() && gFileOpenErr.load()) {
+            errCnt += 1;
+            if (errCnt >= FILEERR_OFF_THRESH) {
+                errCnt = 0;
+                gFileOpenErr.store(false);
             }
         }
         XPLMDrawString(datalogger_color,
                        left+4,
                        top-10,
-                       (char*)str1.c_str(),
+                       statusLine(),
+                       NULL,
+                       xplmFont_Basic);
+        XPLMDrawString(datalogger_color,
+                       right-PANEL_TOGGLE_WIDTH+4,
+                       top-10,
+                       (char*)(gPanelExpanded ? "-" : "+"),
                        NULL,
                        xplmFont_Basic);
+        if (gPanelExpanded)
+            panelDraw(left, top-WINDOW_HEIGHT, right, bottom);
         break;
     default:
         break;
@@ -582,6 +638,19 @@ void HandleKeyCallback(XPLMWindowID inWindowID, char inKey, XPLMKeyFlags inFlags
         return;
 }
 
+/**
+ *
+ */
+void setWindowGeometry(void)
+{
+    int height = WINDOW_HEIGHT + (gPanelExpanded ? PANEL_HEIGHT : 0);
+    XPLMSetWindowGeometry(gDataLogWindow,
+                          gLogWinPosX,
+                          gLogWinPosY,
+                          gLogWinPosX+WINDOW_WIDTH,
+                          gLogWinPosY-height);
+}
+
 /*
  *
  *
@@ -612,20 +681,25 @@ int HandleMouseCallback(XPLMWindowID inWindowID, int x, int y,
         // and whether or not the window is being dragged
         gLogWinPosX += (x - gLastMouseX);
         gLogWinPosY += (y - gLastMouseY);
-        XPLMSetWindowGeometry(gDataLogWindow,
-                              gLogWinPosX,
-                              gLogWinPosY,
-                              gLogWinPosX+WINDOW_WIDTH,
-                              gLogWinPosY-WINDOW_HEIGHT);
+        setWindowGeometry();
         gLastMouseX = x;
         gLastMouseY = y;
         break;
     case xplm_MouseUp:
+        // the +/- at the right of the status line expands the panel
+        if (MouseDownX == x && MouseDownY == y &&
+            x >= gLogWinPosX+WINDOW_WIDTH-PANEL_TOGGLE_WIDTH &&
+            y >= gLogWinPosY-WINDOW_HEIGHT) {
+            gPanelExpanded = !gPanelExpanded;
+            setWindowGeometry();
+            break;
+        }
         // Ignore mouse-clicks for a short time
         // when there was a previous open file error.
         if (gFileOpenErr.load())
             break;
-        if (MouseDownX == x || MouseDownY == y) {
+        // only the status line toggles logging, the panel body drags
+        if ((MouseDownX == x || MouseDownY == y) && y >= gLogWinPosY-WINDOW_HEIGHT) {
             if (gLogging.load())
                 disableLogging();
             else
@@ -25,35 +25,40 @@ echo ----------------------------------------------------
 echo -
 echo -
 
-:: Visual Studio 2013
-:vc-set-2013
-if not defined VS120COMNTOOLS  goto vc-set-2012
-if not exist "%VS120COMNTOOLS%\..\..\vc\vcvarsall.bat" goto vc-set-2012
+:: C++11 alignas, thread_local and constexpr need Visual Studio 2015 or later
+
+:: Visual Studio 2017 and later, found with vswhere
+:vc-set-vswhere
+set VSWHERE="%ProgramFiles(x86)%\Microsoft Visual Studio\Installer\vswhere.exe"
+if not exist %VSWHERE% goto vc-set-2015
+set VS_DIR=
+for /f "usebackq delims=" %%i in (`%VSWHERE% -latest -products * -requires Microsoft.VisualStudio.Component.VC.Tools.x86.x64 -property installationPath`) do set VS_DIR=%%i
+if not defined VS_DIR goto vc-set-2015
+if not exist "%VS_DIR%\VC\Auxiliary\Build\vcvarsall.bat" goto vc-set-2015
 echo -
-echo - Visual C++ 2013 found.
+echo - Visual C++ found in %VS_DIR%.
 echo -
-call "%VS120COMNTOOLS%\..\..\vc\vcvarsall.bat" %vs_toolset%
+call "%VS_DIR%\VC\Auxiliary\Build\vcvarsall.bat" %vs_toolset%
 goto STARTCOMPILING
 
-:: Visual Studio 2012
-:vc-set-2012
-if not defined VS110COMNTOOLS  goto vc-set-notfound
-if not exist "%VS110COMNTOOLS%\..\..\vc\vcvarsall.bat" vc-set-notfound
+:: Visual Studio 2015
+:vc-set-2015
+if not defined VS140COMNTOOLS  goto vc-set-notfound
+if not exist "%VS140COMNTOOLS%\..\..\vc\vcvarsall.bat" goto vc-set-notfound
 echo -
-echo - Visual C++ 2011 found.
+echo - Visual C++ 2015 found.
 echo -
-call "%VS110COMNTOOLS%\..\..\vc\vcvarsall.bat" %vs_toolset%
+call "%VS140COMNTOOLS%\..\..\vc\vcvarsall.bat" %vs_toolset%
 goto STARTCOMPILING
 
 :vc-set-notfound
 echo -
-echo - No Visual C++ found, please set the enviroment variable
-echo -
-echo - VCToolkitInstallDir  or  VS71COMNTOOLS or VS80COMNTOOLS
+echo - No Visual C++ 2015 or later found, install Visual Studio 2015 or
+echo - later with the C++ tools, or set the enviroment variable
 echo -
-echo - to your Visual Studio folder which contains vsvars32.bat.
+echo - VS140COMNTOOLS
 echo -
-echo - Or call the vsvars32.bat.
+echo - to your Visual Studio 2015 Common7\Tools folder.
 echo -
 
 goto ERROR
@@ -67,19 +72,24 @@ set CL_OPTS=/c /GS /W3 /Gy /Zc:wchar_t /Zi /Gm- /O2 /Ob1 /fp:precise /GF /WX- /Z
 :: /D TOGGLE_TEST_FEATURE
 set CL_DEFS=/D "VERSION=%GIT_VER%" /D "NDEBUG" /D "WIN32" /D "_MBCS"  /D "XPLM200" /D "XPLM210" /D "_USRDLL" /D "_WINDLL" /D "APL=0" /D "IBM=1" /D "LIN=0" /D "WIN32" /D "_WINDOWS" /D "LOGPRINTF" /D "SIMDATA_EXPORTS" /D "_CRT_SECURE_NO_WARNINGS" /D "_VC80_UPGRADE=0x0600"
 
-set CL_FILES="main_win.cpp" /TP "main.cpp"
+set CL_FILES="main_win.cpp" /TP "main.cpp" "writer.cpp" "config.cpp" "channels.cpp" "binlog.cpp" "stats.cpp" "trace.cpp" "panel.cpp" "shmsink.cpp" "sink.cpp" "udpsink.cpp" "net.cpp" "gdl90.cpp" "gdl90sink.cpp" "nmea.cpp" "nmeasink.cpp" "httpd.cpp" "metrics.cpp" "sqlitesink.cpp" "arrowipc.cpp" "arrowsink.cpp" "blockindex.cpp" "msgqueue.cpp"
 
 :: /MACHINE:X86 /MACHINE:X64  /MANIFEST:NO
 set LINK_OPTS=/MACHINE:%ARCH% /OUT:win.xpl /INCREMENTAL:NO /NOLOGO /DLL /NXCOMPAT /DYNAMICBASE /SUBSYSTEM:CONSOLE /MANIFESTUAC:"level='asInvoker' uiAccess='false'" /LIBPATH:"SDK\Libraries\Win" /TLBID:1
 
 :: "XPLM_64.lib" "XPLM.lib"
 :: "user32.lib" "Opengl32.lib" "odbc32.lib" "odbccp32.lib" "kernel32.lib" "gdi32.lib" "winspool.lib" "comdlg32.lib" "advapi32.lib" "shell32.lib" "ole32.lib" "oleaut32.lib" "uuid.lib"
-set LINK_LIBS=%XPLM_LIB%
-set LINK_OBJS="main.obj" "main_win.obj"
+set LINK_LIBS=%XPLM_LIB% "Opengl32.lib"
+set LINK_OBJS="main.obj" "writer.obj" "config.obj" "channels.obj" "binlog.obj" "stats.obj" "trace.obj" "panel.obj" "shmsink.obj" "sink.obj" "udpsink.obj" "net.obj" "gdl90.obj" "gdl90sink.obj" "nmea.obj" "nmeasink.obj" "httpd.obj" "metrics.obj" "sqlitesink.obj" "arrowipc.obj" "arrowsink.obj" "blockindex.obj" "msgqueue.obj" "main_win.obj"
+
+:: the SQLite amalgamation, when it's in sqlite\
+if exist sqlite\sqlite3.c set CL_DEFS=%CL_DEFS% /D "WITH_SQLITE=1"
+if exist sqlite\sqlite3.c set LINK_OBJS=%LINK_OBJS% "sqlite3.obj"
 
 @ECHO ON
 
 cl.exe  %CL_OPTS% %CL_DEFS% %CL_FILES%
+if exist sqlite\sqlite3.c cl.exe  %CL_OPTS% /D "NDEBUG" /D "SQLITE_THREADSAFE=1" /D "SQLITE_OMIT_LOAD_EXTENSION" /D "SQLITE_OMIT_DEPRECATED" /D "SQLITE_DEFAULT_MEMSTATUS=0" /D "SQLITE_DQS=0" /TC "sqlite\sqlite3.c"
 link.exe  %LINK_OPTS% %LINK_LIBS% %LINK_OBJS%
 
 @ECHO OFF
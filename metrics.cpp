@@ -0,0 +1,142 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdarg>
+
+#include "./include/defs.h"
+#include "./include/sample.h"
+#include "./include/sink.h"
+#include "./include/stats.h"
+#include "./include/writer.h"
+#include "./include/metrics.h"
+
+using namespace std;
+
+/**
+ * Bounded appends, a full buffer silently truncates.
+ */
+struct MetricsOut {
+    char* p;
+    char* end;
+};
+
+static void put(MetricsOut &o, const char* fmt, ...);
+static void counter(MetricsOut &o, const char* name, const char* help,
+                    const atomic<uint64_t> &c);
+static void gauge(MetricsOut &o, const char* name, const char* help,
+                  double v);
+static void histogram(MetricsOut &o, const char* name, const char* help,
+                      const char* label, const StatsHistogram &h,
+                      const uint64_t* bounds, double scale);
+
+/**
+ *
+ */
+size_t metricsFormat(char* out, size_t size)
+{
+    if (size == 0)
+        return 0;
+    MetricsOut o = {out, out + size - 1};
+    *out = '\0';
+
+    counter(o, "datalogger_samples_captured_total",
+            "Samples queued by the flight loop.", gStats.captured);
+    counter(o, "datalogger_samples_written_total",
+            "Samples handled by the writer thread.", gStats.written);
+    counter(o, "datalogger_samples_dropped_total",
+            "Samples lost to a full sample queue.", gStats.dropped);
+    counter(o, "datalogger_sink_dropped_total",
+            "Output buffers lost to full sink queues.", gStats.sinkDropped);
+    counter(o, "datalogger_bytes_written_total",
+            "Bytes written to all output files.", gStats.bytesWritten);
+    counter(o, "datalogger_files_opened_total",
+            "Output files opened, a new set per logging session.", gStats.filesOpened);
+    gauge(o, "datalogger_file_size_bytes",
+          "Size of the current GPX file.",
+          (double)gStats.fileSize.load(memory_order_relaxed));
+    gauge(o, "datalogger_queue_depth",
+          "Samples waiting for the writer thread.",
+          (double)gSampleQueue.size());
+
+    histogram(o, "datalogger_callback_duration_seconds",
+              "Flight loop callback duration.", NULL, gStats.cbUs,
+              gLatencyBoundsUs, 1.0e-6);
+    histogram(o, "datalogger_writer_latency_seconds",
+              "Sample capture to written by the writer thread.", NULL,
+              gStats.writerLagUs, gLatencyBoundsUs, 1.0e-6);
+    histogram(o, "datalogger_queue_depth_samples",
+              "Sample queue depth at each capture.", NULL,
+              gStats.queueDepth, gDepthBounds, 1.0);
+
+    // one series per output that has flushed
+    put(o, "# HELP datalogger_flush_duration_seconds Output flush to the OS duration.\n"
+           "# TYPE datalogger_flush_duration_seconds histogram\n");
+    for (int e = 0; e < NUM_ENCODINGS; e++) {
+        if (gStats.flushUs[e].count.load(memory_order_relaxed) > 0)
+            histogram(o, "datalogger_flush_duration_seconds", NULL,
+                      gEncodingNames[e], gStats.flushUs[e], gLatencyBoundsUs,
+                      1.0e-6);
+    }
+    return (size_t)(o.p - out);
+}
+
+void put(MetricsOut &o, const char* fmt, ...)
+{
+    if (o.p >= o.end)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o.p, o.end - o.p + 1, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        o.p = n < o.end - o.p ? o.p + n : o.end;
+}
+
+void counter(MetricsOut &o, const char* name, const char* help,
+             const atomic<uint64_t> &c)
+{
+    put(o, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name,
+        name, (unsigned long long)c.load(memory_order_relaxed));
+}
+
+void gauge(MetricsOut &o, const char* name, const char* help, double v)
+{
+    put(o, "# HELP %s %s\n# TYPE %s gauge\n%s %.15g\n", name, help, name,
+        name, v);
+}
+
+/**
+ * A NULL help skips the HELP and TYPE lines, a label adds sink="label"
+ * to every series. The count is the sum of the buckets read, so the
+ * series stay consistent while they're updated.
+ */
+void histogram(MetricsOut &o, const char* name, const char* help,
+               const char* label, const StatsHistogram &h,
+               const uint64_t* bounds, double scale)
+{
+    char sink[48] = "";
+    char sep[48] = "";
+    if (label != NULL) {
+        snprintf(sink, sizeof(sink), "{sink=\"%s\"}", label);
+        snprintf(sep, sizeof(sep), "sink=\"%s\",", label);
+    }
+    if (help != NULL)
+        put(o, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+
+    uint64_t total = 0;
+    for (int b = 0; b <= STATS_BUCKETS; b++) {
+        total += h.bucket[b].load(memory_order_relaxed);
+        if (b < STATS_BUCKETS)
+            put(o, "%s_bucket{%sle=\"%g\"} %llu\n", name, sep,
+                bounds[b] * scale, (unsigned long long)total);
+        else
+            put(o, "%s_bucket{%sle=\"+Inf\"} %llu\n", name, sep,
+                (unsigned long long)total);
+    }
+    put(o, "%s_sum%s %.9g\n%s_count%s %llu\n", name, sink,
+        h.sum.load(memory_order_relaxed) * scale, name, sink,
+        (unsigned long long)total);
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdarg>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/msgqueue.h"
+
+using namespace std;
+
+/**
+ * A bounded multi-producer queue slot. Slot i is free for the position
+ * i + seq and filled for it once seq is one more, so the queue starts
+ * out zeroed.
+ */
+struct MsgSlot {
+    atomic<size_t> seq;
+    char text[MSG_SIZE];
+};
+
+static MsgSlot gSlots[MSG_QUEUE_SIZE];
+alignas(64) static atomic<size_t> gHead(0);
+alignas(64) static size_t gTail = 0;
+static atomic<uint64_t> gDropped(0);
+
+/**
+ * Claims the next free slot, or drops the message when the sim thread
+ * is a whole queue behind.
+ */
+void msgPost(const char* fmt, ...)
+{
+    size_t pos = gHead.load(memory_order_relaxed);
+    MsgSlot* slot;
+    for (;;) {
+        size_t i = pos & (MSG_QUEUE_SIZE - 1);
+        slot = &gSlots[i];
+        size_t at = slot->seq.load(memory_order_acquire) + i;
+        if (at == pos) {
+            if (gHead.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                break;
+        } else if (at < pos) {
+            gDropped.fetch_add(1, memory_order_relaxed);
+            return;
+        } else {
+            pos = gHead.load(memory_order_relaxed);
+        }
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(slot->text, sizeof(slot->text), fmt, ap);
+    va_end(ap);
+    slot->seq.store(pos - (pos & (MSG_QUEUE_SIZE - 1)) + 1, memory_order_release);
+}
+
+/**
+ * Stops at a slot that's claimed but not filled yet, it's printed next
+ * time.
+ */
+void msgDrain(void)
+{
+    for (;;) {
+        size_t lap = gTail - (gTail & (MSG_QUEUE_SIZE - 1));
+        MsgSlot &slot = gSlots[gTail & (MSG_QUEUE_SIZE - 1)];
+        if (slot.seq.load(memory_order_acquire) != lap + 1)
+            break;
+        LPRINTF(slot.text);
+        slot.seq.store(lap + MSG_QUEUE_SIZE, memory_order_release);
+        gTail += 1;
+    }
+    uint64_t dropped = gDropped.exchange(0, memory_order_relaxed);
+    if (dropped > 0) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "DataLogger Plugin: %llu log messages dropped\n",
+                 (unsigned long long)dropped);
+        LPRINTF(buf);
+    }
+}
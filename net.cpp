@@ -0,0 +1,143 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#if APL || LIN
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/sink.h"
+#include "./include/net.h"
+
+using namespace std;
+
+#if APL || LIN
+
+struct NetSink {
+    int sock;
+    struct sockaddr_in dest;
+};
+
+static int udpOpen(const string &host, int port, struct sockaddr_in* dest);
+static void netWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void netClose(Sink* s);
+
+/**
+ *
+ */
+bool netSinkOpen(int encoding, const string &hosts, int port)
+{
+    int opened = 0;
+    vector<string> list = configSplit(hosts);
+    for (size_t i = 0; i < list.size(); i++) {
+        NetSink* ns = new NetSink;
+        ns->sock = udpOpen(list[i], port, &ns->dest);
+        if (ns->sock < 0 ||
+            sinkCreate(encoding, gConfig.policy[encoding], ns, netWrite,
+                       NULL, netClose) == NULL) {
+            if (ns->sock >= 0)
+                close(ns->sock);
+            delete ns;
+            continue;
+        }
+        opened += 1;
+    }
+    return opened > 0;
+}
+
+/**
+ * A full socket buffer drops datagrams rather than stall the sink.
+ */
+int udpOpen(const string &host, int port, struct sockaddr_in* dest)
+{
+    memset(dest, 0, sizeof(*dest));
+    dest->sin_family = AF_INET;
+    dest->sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host.c_str(), &dest->sin_addr) != 1) {
+        struct addrinfo hints;
+        struct addrinfo* res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (getaddrinfo(host.c_str(), NULL, &hints, &res) != 0 || res == NULL) {
+            LPRINTF("DataLogger Plugin: unable to resolve the udp host ");
+            LPRINTF(host.c_str()); LPRINTF("\n");
+            return -1;
+        }
+        dest->sin_addr = ((struct sockaddr_in*)res->ai_addr)->sin_addr;
+        freeaddrinfo(res);
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        LPRINTF("DataLogger Plugin: unable to create the udp socket...\n");
+        return -1;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    // EFB feeds are usually sent to the subnet broadcast address
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    return sock;
+}
+
+/**
+ * One datagram per buffer, a batch goes to the kernel in one call.
+ */
+void netWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    NetSink* ns = (NetSink*)s->ctx;
+#if LIN
+    struct mmsghdr msgs[SINK_BATCH];
+    struct iovec iov[SINK_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < n; i++) {
+        iov[i].iov_base = bufs[i]->data;
+        iov[i].iov_len = bufs[i]->len;
+        msgs[i].msg_hdr.msg_name = &ns->dest;
+        msgs[i].msg_hdr.msg_namelen = sizeof(ns->dest);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    // whatever the kernel doesn't take is dropped, the udp feed's
+    // receiver sees the gap in the sequence numbers
+    sendmmsg(ns->sock, msgs, n, MSG_DONTWAIT);
+#else
+    for (int i = 0; i < n; i++) {
+        sendto(ns->sock, bufs[i]->data, bufs[i]->len, 0,
+               (struct sockaddr*)&ns->dest, sizeof(ns->dest));
+    }
+#endif
+}
+
+void netClose(Sink* s)
+{
+    NetSink* ns = (NetSink*)s->ctx;
+    close(ns->sock);
+    delete ns;
+}
+
+#else /* IBM */
+
+bool netSinkOpen(int encoding, const string &hosts, int port)
+{
+    LPRINTF("DataLogger Plugin: the ");
+    LPRINTF(gEncodingNames[encoding]);
+    LPRINTF(" output isn't supported...\n");
+    return false;
+}
+
+#endif
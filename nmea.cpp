@@ -0,0 +1,170 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <cmath>
+#include <cstring>
+#include <time.h>
+
+#include "./include/nmea.h"
+
+#define KT_TO_KMH (1.852)
+
+static const char gHex[] = "0123456789ABCDEF";
+
+// powers of ten for the fixed point fields
+static const long long gPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+static inline char* putStr(char* p, const char* s)
+{
+    while (*s)
+        *p++ = *s++;
+    return p;
+}
+
+/**
+ * Writes v zero padded to at least width digits.
+ */
+static char* putUint(char* p, unsigned long long v, int width)
+{
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n < width)
+        tmp[n++] = '0';
+    while (n > 0)
+        *p++ = tmp[--n];
+    return p;
+}
+
+/**
+ * Writes |v| rounded to dec decimals, the integer part zero padded to
+ * width digits.
+ */
+static char* putFixed(char* p, double v, int width, int dec)
+{
+    long long scaled = llround(fabs(v) * gPow10[dec]);
+    p = putUint(p, (unsigned long long)(scaled / gPow10[dec]), width);
+    *p++ = '.';
+    return putUint(p, (unsigned long long)(scaled % gPow10[dec]), dec);
+}
+
+/**
+ * ddmm.mmmm,N or dddmm.mmmm,E, rounding carries into the degrees.
+ */
+static char* putAngle(char* p, double deg, int degWidth, char pos, char neg)
+{
+    long long t = llround(fabs(deg) * 60.0 * 10000.0);
+    p = putUint(p, (unsigned long long)(t / 600000), degWidth);
+    p = putUint(p, (unsigned long long)(t % 600000 / 10000), 2);
+    *p++ = '.';
+    p = putUint(p, (unsigned long long)(t % 10000), 4);
+    *p++ = ',';
+    *p++ = deg < 0.0 ? neg : pos;
+    return p;
+}
+
+static char* putTime(char* p, const struct tm &tm)
+{
+    p = putUint(p, tm.tm_hour, 2);
+    p = putUint(p, tm.tm_min, 2);
+    p = putUint(p, tm.tm_sec, 2);
+    return putStr(p, ".00");
+}
+
+static inline double wrap360(double d)
+{
+    d = fmod(d, 360.0);
+    return d < 0.0 ? d + 360.0 : d;
+}
+
+static inline void utc(time_t t, struct tm &tm)
+{
+#if IBM
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+}
+
+/**
+ * Appends *hh\r\n, the checksum is the xor of everything between
+ * the $ and the *.
+ */
+static size_t finish(char* out, char* p)
+{
+    unsigned char sum = 0;
+    for (const char* c = out + 1; c < p; c++)
+        sum ^= (unsigned char)*c;
+    *p++ = '*';
+    *p++ = gHex[sum >> 4];
+    *p++ = gHex[sum & 0x0f];
+    *p++ = '\r';
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+/**
+ * $GPGGA,hhmmss.ss,ddmm.mmmm,N,dddmm.mmmm,E,q,nn,h.h,a.a,M,,M,,*hh
+ */
+size_t nmeaGGA(char* out, const NmeaFix &f)
+{
+    struct tm tm;
+    utc(f.time, tm);
+    char* p = putStr(out, "$GPGGA,");
+    p = putTime(p, tm);
+    *p++ = ',';
+    p = putAngle(p, f.lat, 2, 'N', 'S');
+    *p++ = ',';
+    p = putAngle(p, f.lon, 3, 'E', 'W');
+    // a simulated fix is always a good one
+    p = putStr(p, f.valid ? ",1,12,0.9," : ",0,00,99.9,");
+    if (f.altM < 0.0)
+        *p++ = '-';
+    p = putFixed(p, f.altM, 1, 1);
+    p = putStr(p, ",M,,M,,");
+    return finish(out, p);
+}
+
+/**
+ * $GPRMC,hhmmss.ss,A,ddmm.mmmm,N,dddmm.mmmm,E,s.s,t.t,ddmmyy,,,A*hh
+ */
+size_t nmeaRMC(char* out, const NmeaFix &f)
+{
+    struct tm tm;
+    utc(f.time, tm);
+    char* p = putStr(out, "$GPRMC,");
+    p = putTime(p, tm);
+    p = putStr(p, f.valid ? ",A," : ",V,");
+    p = putAngle(p, f.lat, 2, 'N', 'S');
+    *p++ = ',';
+    p = putAngle(p, f.lon, 3, 'E', 'W');
+    *p++ = ',';
+    p = putFixed(p, f.speedKt, 1, 1);
+    *p++ = ',';
+    p = putFixed(p, wrap360(f.courseDeg), 1, 1);
+    *p++ = ',';
+    p = putUint(p, tm.tm_mday, 2);
+    p = putUint(p, tm.tm_mon + 1, 2);
+    p = putUint(p, tm.tm_year % 100, 2);
+    p = putStr(p, f.valid ? ",,,A" : ",,,N");
+    return finish(out, p);
+}
+
+/**
+ * $GPVTG,t.t,T,,M,s.s,N,k.k,K,A*hh
+ */
+size_t nmeaVTG(char* out, const NmeaFix &f)
+{
+    char* p = putStr(out, "$GPVTG,");
+    p = putFixed(p, wrap360(f.courseDeg), 1, 1);
+    p = putStr(p, ",T,,M,");
+    p = putFixed(p, f.speedKt, 1, 1);
+    p = putStr(p, ",N,");
+    p = putFixed(p, f.speedKt * KT_TO_KMH, 1, 1);
+    p = putStr(p, f.valid ? ",K,A" : ",K,N");
+    return finish(out, p);
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#if APL || LIN
+#include <sys/types.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/geo.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/sink.h"
+#include "./include/nmea.h"
+#include "./include/nmeasink.h"
+
+using namespace std;
+
+// below this the position deltas are noise, the heading stands in
+#define NMEA_MIN_TRACK_DIST (1.0)   // meters
+
+static int64_t gPeriodUs;
+static int64_t gNext;
+static double gLastLat;
+static double gLastLon;
+static bool gHaveLast;
+
+#if APL || LIN
+
+static int openDevice(const string &device, int baud);
+static void nmeaWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void nmeaClose(Sink* s);
+static speed_t baudFlag(int baud);
+
+/**
+ * Registers a sink per device, all of them share the sentences.
+ */
+bool nmeaSinkOpen(const string &devices, int baud, float rate)
+{
+    gPeriodUs = (int64_t)(1.0e6f / (rate > 0.0f ? rate : 1.0f));
+    gNext = 0;
+    gHaveLast = false;
+
+    int opened = 0;
+    vector<string> list = configSplit(devices);
+    for (size_t i = 0; i < list.size(); i++) {
+        int fd = openDevice(list[i], baud);
+        if (fd < 0)
+            continue;
+        if (sinkCreate(ENC_NMEA, gConfig.policy[ENC_NMEA], (void*)(intptr_t)fd,
+                       nmeaWrite, NULL, nmeaClose) == NULL) {
+            close(fd);
+            continue;
+        }
+        opened += 1;
+    }
+    return opened > 0;
+}
+
+/**
+ * Opens the serial device, or a pseudo-terminal whose slave end any
+ * NMEA client can open in place of a real port.
+ */
+int openDevice(const string &device, int baud)
+{
+    int fd;
+    if (device == NMEA_PTY) {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+            LPRINTF("DataLogger Plugin: unable to open a pseudo-terminal...\n");
+            if (fd >= 0)
+                close(fd);
+            return -1;
+        }
+        LPRINTF("DataLogger Plugin: nmea sentences on ");
+        LPRINTF(ptsname(fd)); LPRINTF("\n");
+    } else {
+        fd = open(device.c_str(), O_WRONLY | O_NOCTTY);
+        if (fd < 0) {
+            LPRINTF("DataLogger Plugin: unable to open the nmea device ");
+            LPRINTF(device.c_str()); LPRINTF("\n");
+            return -1;
+        }
+    }
+    // a reader that falls behind loses sentences, the sink never waits
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetospeed(&tio, baudFlag(baud));
+        cfsetispeed(&tio, baudFlag(baud));
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+void nmeaWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    int fd = (int)(intptr_t)s->ctx;
+    for (int i = 0; i < n; i++) {
+        if (write(fd, bufs[i]->data, bufs[i]->len) < 0) {
+            // EAGAIN, nobody is reading or the port is slower than the rate
+        }
+    }
+}
+
+void nmeaClose(Sink* s)
+{
+    close((int)(intptr_t)s->ctx);
+}
+
+speed_t baudFlag(int baud)
+{
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    default: return B4800;  // the NMEA 0183 standard rate
+    }
+}
+
+#else /* IBM */
+
+bool nmeaSinkOpen(const string &devices, int baud, float rate)
+{
+    LPRINTF("DataLogger Plugin: the nmea output isn't supported...\n");
+    return false;
+}
+
+#endif
+
+/**
+ * Encodes GGA, RMC and VTG at the configured rate from the position
+ * samples the GPX track is written from.
+ */
+void nmeaEncode(const Sample &s, uint64_t changed)
+{
+    if (!(s.groups & GROUP_BIT(GROUP_POSITION)) || s.tick < gNext)
+        return;
+    gNext += gPeriodUs;
+    if (gNext <= s.tick)
+        gNext = s.tick + gPeriodUs;
+
+    NmeaFix f;
+    f.time = s.wallTime;
+    f.lat = s.ch[CH_LAT];
+    f.lon = s.ch[CH_LON];
+    f.altM = s.ch[CH_ALT];
+    f.speedKt = s.ch[CH_GS] * MPS_TO_KNOTS;
+    f.courseDeg = s.ch[CH_HDG];
+    f.valid = f.lat != 0.0 || f.lon != 0.0;
+
+    // the track over ground differs from the heading by the drift angle
+    if (gHaveLast && haversine(gLastLat, gLastLon, f.lat, f.lon) > NMEA_MIN_TRACK_DIST)
+        f.courseDeg = bearing(gLastLat, gLastLon, f.lat, f.lon);
+    gLastLat = f.lat;
+    gLastLon = f.lon;
+    gHaveLast = true;
+
+    SinkBuffer* b = sinkBufferGet(0);
+    size_t n = nmeaGGA(b->data, f);
+    n += nmeaRMC(b->data + n, f);
+    n += nmeaVTG(b->data + n, f);
+    b->len = n;
+    sinkPublish(ENC_NMEA, b);
+}
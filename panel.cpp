@@ -0,0 +1,159 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifdef _WIN32 /* this is set for 64 bit as well */
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#endif
+
+#ifdef _APPLE_
+ #pragma clang diagnostic ignored "-Wall"
+ #include <gl.h>
+#else
+ #include <GL/gl.h>
+#endif
+
+#include <cstdio>
+#include <algorithm>
+
+#include "./SDK/CHeaders/XPLM/XPLMDisplay.h"
+#include "./SDK/CHeaders/XPLM/XPLMGraphics.h"
+#include "./SDK/CHeaders/XPLM/XPLMProcessing.h"
+
+#include "./include/defs.h"
+#include "./include/config.h"
+#include "./include/stats.h"
+#include "./include/writer.h"
+#include "./include/pyramid.h"
+#include "./include/panel.h"
+
+using namespace std;
+
+static void drawSparkline(const MinMaxPyramid<1024, 12> &h, int left,
+                          int top, int right, int bottom, const char* label);
+
+#define SPARK_HEIGHT (28)
+#define SPARK_MAX_WIDTH (512)
+
+bool gPanelExpanded = false;
+
+// 1024 samples in full detail, ~58 hours at 10 Hz at the top level
+static MinMaxPyramid<1024, 12> gAltHistory;
+static MinMaxPyramid<1024, 12> gGsHistory;
+
+static char gRateLine[64];
+static char gQueueLine[64];
+static char gAltLabel[32];
+static char gGsLabel[32];
+
+/**
+ *
+ */
+void panelClear(void)
+{
+    gAltHistory.clear();
+    gGsHistory.clear();
+    gRateLine[0] = gQueueLine[0] = gAltLabel[0] = gGsLabel[0] = '\0';
+}
+
+/**
+ *
+ */
+void panelAddSample(float altFt, float gsKt)
+{
+    gAltHistory.add(altFt);
+    gGsHistory.add(gsKt);
+}
+
+/**
+ * Refreshes the panel text from the stats counters, called about once
+ * a second so the draw path only copies static buffers.
+ */
+void panelUpdate(void)
+{
+    static float lastTime = 0.0f;
+    static uint64_t lastCaptured = 0;
+    static uint64_t lastBytes = 0;
+
+    float now = XPLMGetElapsedTime();
+    uint64_t captured = gStats.captured.load(memory_order_relaxed);
+    uint64_t bytes = gStats.bytesWritten.load(memory_order_relaxed);
+    float dt = now - lastTime;
+    if (dt > 0.0f && captured >= lastCaptured && bytes >= lastBytes) {
+        snprintf(gRateLine, sizeof(gRateLine), "%.1f samples/s  %.3f MB/s",
+                 (captured - lastCaptured) / dt,
+                 (bytes - lastBytes) / dt / 1.0e6);
+    }
+    lastTime = now;
+    lastCaptured = captured;
+    lastBytes = bytes;
+
+    snprintf(gQueueLine, sizeof(gQueueLine), "queue %d  drops %llu",
+             (int)gSampleQueue.size(),
+             (unsigned long long)gStats.dropped.load(memory_order_relaxed));
+
+    if (gAltHistory.count() > 0) {
+        float alt = 0.0f;
+        float gs = 0.0f;
+        // a one sample query is the newest sample
+        gAltHistory.query(1, 1, &alt, &alt);
+        gGsHistory.query(1, 1, &gs, &gs);
+        snprintf(gAltLabel, sizeof(gAltLabel), "ALT %.0f ft", alt);
+        snprintf(gGsLabel, sizeof(gGsLabel), "GS %.0f kt", gs);
+    }
+}
+
+/**
+ * Draws the throughput lines and the sparklines for the last
+ * panel.minutes of the flight.
+ */
+void panelDraw(int left, int top, int right, int bottom)
+{
+    static float color[] = {0.0, 1.0, 0.0};
+
+    XPLMDrawString(color, left+4, top-10, gRateLine, NULL, xplmFont_Basic);
+    XPLMDrawString(color, left+4, top-22, gQueueLine, NULL, xplmFont_Basic);
+
+    int y = top - 28;
+    drawSparkline(gAltHistory, left+4, y, right-4, y-SPARK_HEIGHT, gAltLabel);
+    y -= SPARK_HEIGHT + 12;
+    drawSparkline(gGsHistory, left+4, y, right-4, y-SPARK_HEIGHT, gGsLabel);
+}
+
+/**
+ * One vertical min..max line per pixel column, the pyramid keeps the
+ * work proportional to the width however long the flight is.
+ */
+void drawSparkline(const MinMaxPyramid<1024, 12> &h, int left, int top,
+                   int right, int bottom, const char* label)
+{
+    static float color[] = {0.0, 1.0, 0.0};
+    static float lo[SPARK_MAX_WIDTH];
+    static float hi[SPARK_MAX_WIDTH];
+
+    XPLMDrawString(color, left, top-10, (char*)label, NULL, xplmFont_Basic);
+    top -= 12;
+
+    float rate = gConfig.rate[GROUP_POSITION];
+    uint64_t n = (uint64_t)(gConfig.panelMinutes * 60.0f * rate);
+    int w = min(right - left, SPARK_MAX_WIDTH);
+    w = h.query(n, w, lo, hi);
+    if (w <= 0)
+        return;
+
+    float vmin = *min_element(lo, lo + w);
+    float vmax = *max_element(hi, hi + w);
+    float scale = vmax > vmin ? (top - bottom) / (vmax - vmin) : 0.0f;
+
+    XPLMSetGraphicsState(0, 0, 0, 0, 1, 0, 0);
+    glColor3f(0.0f, 1.0f, 0.0f);
+    glBegin(GL_LINES);
+    for (int x = 0; x < w; x++) {
+        float y0 = bottom + (lo[x] - vmin) * scale;
+        float y1 = bottom + (hi[x] - vmin) * scale + 1.0f;
+        glVertex2f((float)(left + x), y0);
+        glVertex2f((float)(left + x), y1);
+    }
+    glEnd();
+}
@@ -0,0 +1,136 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#if APL || LIN
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/shmfeed.h"
+#include "./include/shmsink.h"
+
+using namespace std;
+
+static ShmFeed* gFeed = NULL;
+static uint64_t gFeedHead = 0;
+
+/**
+ * FNV-1a over the channel names and groups, changes whenever the
+ * channel table does.
+ */
+static uint32_t schemaVersion(void)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < gChannelCount; i++) {
+        for (const char* p = gChannelDefs[i].name; *p; p++)
+            h = (h ^ (uint8_t)*p) * 16777619u;
+        h = (h ^ (uint8_t)gChannelDefs[i].group) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Creates the shared memory segment, readers attach with shm_open on
+ * SHM_FEED_NAME.
+ */
+bool shmSinkOpen(void)
+{
+#if APL || LIN
+    if (gFeed != NULL)
+        return true;
+
+    int fd = shm_open(SHM_FEED_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        LPRINTF("DataLogger Plugin: shm_open failed...\n");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(ShmFeed)) != 0) {
+        LPRINTF("DataLogger Plugin: shared memory ftruncate failed...\n");
+        close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, sizeof(ShmFeed), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LPRINTF("DataLogger Plugin: shared memory mmap failed...\n");
+        return false;
+    }
+
+    gFeed = static_cast<ShmFeed*>(p);
+    ShmHeader &hdr = gFeed->hdr;
+    // invalidate the header while it's rewritten, a restarted plugin
+    // begins a new record sequence
+    hdr.magic = 0;
+    atomic_thread_fence(memory_order_release);
+    hdr.version = SHM_FEED_VERSION;
+    hdr.schemaVersion = schemaVersion();
+    hdr.channelCount = (uint32_t)gChannelCount;
+    hdr.slotCount = SHM_FEED_SLOTS;
+    hdr.recordSize = sizeof(ShmRecord);
+    memset(hdr.channels, 0, sizeof(hdr.channels));
+    for (int i = 0; i < gChannelCount; i++) {
+        strncpy(hdr.channels[i].name, gChannelDefs[i].name,
+                sizeof(hdr.channels[i].name) - 1);
+        hdr.channels[i].group = (uint8_t)gChannelDefs[i].group;
+    }
+    for (int i = 0; i < SHM_FEED_SLOTS; i++)
+        gFeed->slots[i].seq.store(0, memory_order_relaxed);
+    gFeedHead = 0;
+    hdr.head.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    hdr.magic = SHM_FEED_MAGIC;
+    return true;
+#else
+    LPRINTF("DataLogger Plugin: the shared memory feed isn't supported...\n");
+    return false;
+#endif
+}
+
+/**
+ * Sim thread, one fixed size copy of the channel block per record.
+ */
+void shmSinkPublish(const Sample &s)
+{
+    if (gFeed == NULL)
+        return;
+
+    uint64_t n = gFeedHead;
+    ShmRecord &r = gFeed->slots[n & (SHM_FEED_SLOTS - 1)];
+    r.seq.store(2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    r.groups = s.groups;
+    r.cycle = s.cycle;
+    r.wallTime = s.wallTime;
+    r.elapsed = s.elapsed;
+    r.flags = s.flags;
+    memcpy(r.ch, s.ch, gChannelCount * sizeof(double));
+    r.seq.store(2 * n + 2, memory_order_release);
+    gFeedHead = n + 1;
+    gFeed->hdr.head.store(n + 1, memory_order_release);
+}
+
+/**
+ *
+ */
+void shmSinkClose(void)
+{
+#if APL || LIN
+    if (gFeed == NULL)
+        return;
+    gFeed->hdr.magic = 0;
+    munmap(gFeed, sizeof(ShmFeed));
+    shm_unlink(SHM_FEED_NAME);
+    gFeed = NULL;
+#endif
+}
@@ -0,0 +1,267 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/stats.h"
+#include "./include/trace.h"
+#include "./include/sink.h"
+
+using namespace std;
+
+#define SINK_IDLE_MS (10)
+#define SINK_POOL_MAX (128)         // free buffers kept, 1 MB
+
+// the sinks' names in the log and their policy.<name>= config keys
+const char* gEncodingNames[NUM_ENCODINGS] = {
+    "gpx"
+    ,"binary"
+    ,"udp"
+    ,"gdl90"
+    ,"nmea"
+    ,"http"
+    ,"sqlite"
+    ,"arrow"
+};
+
+// static storage keeps the rings' cache line alignment, new wouldn't
+// before C++17
+static Sink gSinks[MAX_SINKS];
+static int gSinkCount = 0;
+static int gSubscribers[NUM_ENCODINGS];
+
+// buffers are recycled across sessions, only a burst allocates and
+// what a burst leaves beyond SINK_POOL_MAX is freed
+static mutex gPoolLock;
+static SinkBuffer* gPool = NULL;
+static int gPoolSize = 0;
+
+static void sinkLoop(Sink* s);
+static bool sinkPush(Sink* s, SinkBuffer* b);
+
+/**
+ * Registers a sink, writer start only, before sinkStartAll.
+ */
+Sink* sinkCreate(int encoding, int policy, void* ctx, SinkWriteFn write,
+                 SinkFn flush, SinkFn close)
+{
+    if (gSinkCount == MAX_SINKS) {
+        LPRINTF("DataLogger Plugin: too many output sinks, ignoring ");
+        LPRINTF(gEncodingNames[encoding]); LPRINTF("\n");
+        return NULL;
+    }
+    Sink* s = &gSinks[gSinkCount++];
+    s->name = gEncodingNames[encoding];
+    s->encoding = encoding;
+    s->policy = policy;
+    s->ctx = ctx;
+    s->write = write;
+    s->flush = flush;
+    s->close = close;
+    s->run.store(false);
+    s->dropped = 0;
+    gSubscribers[encoding] += 1;
+    return s;
+}
+
+/**
+ *
+ */
+void sinkStartAll(void)
+{
+    for (int i = 0; i < gSinkCount; i++) {
+        gSinks[i].run.store(true);
+        gSinks[i].th = thread(sinkLoop, &gSinks[i]);
+    }
+}
+
+/**
+ * Lets every sink drain its queue, then closes them. The
+ * writer thread must have stopped publishing.
+ */
+void sinkStopAll(void)
+{
+    for (int i = 0; i < gSinkCount; i++)
+        gSinks[i].run.store(false);
+    for (int i = 0; i < gSinkCount; i++) {
+        Sink* s = &gSinks[i];
+        if (s->th.joinable())
+            s->th.join();
+        if (s->close != NULL)
+            s->close(s);
+        if (s->dropped > 0) {
+            char buf[96];
+            snprintf(buf, sizeof(buf), "DataLogger Plugin: the %s sink dropped %llu buffers\n",
+                     s->name, (unsigned long long)s->dropped);
+            LPRINTF(buf);
+        }
+    }
+    gSinkCount = 0;
+    memset(gSubscribers, 0, sizeof(gSubscribers));
+}
+
+/**
+ * Encoders skip the work when nobody listens.
+ */
+bool sinkSubscribed(int encoding)
+{
+    return gSubscribers[encoding] > 0;
+}
+
+/**
+ * Returns an empty buffer holding one reference.
+ */
+SinkBuffer* sinkBufferGet(uint32_t tag)
+{
+    SinkBuffer* b;
+    {
+        lock_guard<mutex> lock(gPoolLock);
+        b = gPool;
+        if (b != NULL) {
+            gPool = b->next;
+            gPoolSize -= 1;
+        }
+    }
+    if (b == NULL)
+        b = new SinkBuffer;
+    b->refs.store(1, memory_order_relaxed);
+    b->tag = tag;
+    b->len = 0;
+    b->next = NULL;
+    return b;
+}
+
+/**
+ * Drops a reference, the last one returns the buffer to the pool.
+ */
+void sinkBufferPut(SinkBuffer* b)
+{
+    if (b->refs.fetch_sub(1, memory_order_acq_rel) != 1)
+        return;
+    {
+        lock_guard<mutex> lock(gPoolLock);
+        if (gPoolSize < SINK_POOL_MAX) {
+            b->next = gPool;
+            gPool = b;
+            gPoolSize += 1;
+            return;
+        }
+    }
+    delete b;
+}
+
+/**
+ * Hands a finished buffer to every sink of the encoding and drops the
+ * caller's reference. The buffer must not be modified afterwards.
+ */
+void sinkPublish(int encoding, SinkBuffer* b)
+{
+    if (b->len > 0) {
+        for (int i = 0; i < gSinkCount; i++) {
+            Sink* s = &gSinks[i];
+            if (s->encoding != encoding)
+                continue;
+            b->refs.fetch_add(1, memory_order_relaxed);
+            if (!sinkPush(s, b)) {
+                b->refs.fetch_sub(1, memory_order_relaxed);
+                s->dropped += 1;
+                statsAdd(gStats.sinkDropped, 1);
+            }
+        }
+    }
+    sinkBufferPut(b);
+}
+
+/**
+ * An append that fits a buffer is never split across two, so record
+ * encodings can parse buffers on their own. Larger ones fill as many
+ * buffers as they need.
+ */
+void sinkAppend(SinkStream &st, const char* p, size_t n)
+{
+    if (st.cur != NULL && st.cur->len + n > SINK_BUFFER_SIZE && n <= SINK_BUFFER_SIZE)
+        sinkEnd(st);
+    for (;;) {
+        if (st.cur == NULL)
+            st.cur = sinkBufferGet(st.tag);
+        size_t k = min(n, SINK_BUFFER_SIZE - st.cur->len);
+        memcpy(st.cur->data + st.cur->len, p, k);
+        st.cur->len += k;
+        p += k;
+        n -= k;
+        if (n == 0)
+            break;
+        sinkEnd(st);
+    }
+}
+
+/**
+ * Publishes the partly filled buffer, called at the end of each block.
+ */
+void sinkEnd(SinkStream &st)
+{
+    if (st.cur == NULL)
+        return;
+    sinkPublish(st.encoding, st.cur);
+    st.cur = NULL;
+}
+
+bool sinkPush(Sink* s, SinkBuffer* b)
+{
+    SinkBuffer** slot;
+    while ((slot = s->queue.claim()) == NULL) {
+        if (s->policy == SINK_DROP)
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    *slot = b;
+    s->queue.commit();
+    return true;
+}
+
+void sinkLoop(Sink* s)
+{
+    SinkBuffer* batch[SINK_BATCH];
+    bool dirty = false;
+    for (;;) {
+        // read the flag first so the queue is drained once more on stop
+        bool run = s->run.load();
+        SinkBuffer** b;
+        int n = 0;
+        while (n < SINK_BATCH && (b = s->queue.front()) != NULL) {
+            batch[n++] = *b;
+            s->queue.pop();
+        }
+        if (n > 0) {
+            {
+                TRACE_SCOPE("sink.write");
+                s->write(s, batch, n);
+            }
+            for (int i = 0; i < n; i++)
+                sinkBufferPut(batch[i]);
+            dirty = true;
+            continue;
+        }
+        if (dirty && s->flush != NULL) {
+            TRACE_SCOPE("sink.flush");
+            int64_t start = statsTickUs();
+            s->flush(s);
+            statsObserveShared(gStats.flushUs[s->encoding], gLatencyBoundsUs,
+                               (uint64_t)(statsTickUs() - start));
+        }
+        dirty = false;
+        if (!run)
+            break;
+        this_thread::sleep_for(chrono::milliseconds(SINK_IDLE_MS));
+    }
+}
@@ -0,0 +1,352 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#if WITH_SQLITE
+#include "./sqlite/sqlite3.h"
+#endif
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/msgqueue.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/stats.h"
+#include "./include/sink.h"
+#include "./include/sqlitesink.h"
+
+using namespace std;
+
+/*
+ * Rows are handed to the sink as records, host byte order:
+ *
+ *      u16     record size
+ *      u64     present channel bitmap
+ *      i64     wall clock, unix seconds
+ *      i32     sim cycle
+ *      f32     sim elapsed time
+ *      f64[]   the present channels, in channel order
+ */
+#define SQLITE_RECORD_HEADER_SIZE (2 + 8 + 8 + 4 + 4)
+
+static SinkStream gStream = {ENC_SQLITE, 0, NULL};
+
+template <typename T>
+static inline char* put(char* p, T v)
+{
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+template <typename T>
+static inline const char* get(const char* p, T &v)
+{
+    memcpy(&v, p, sizeof(v));
+    return p + sizeof(v);
+}
+
+#if WITH_SQLITE
+
+#define SQLITE_BATCH_ROWS (4096)        // rows per transaction
+#define SQLITE_COMMIT_US (1000000)      // or sooner when the feed is slow
+#define SQLITE_PAGE_SIZE (8192)
+
+/**
+ * Owned by the sink's thread once it's started.
+ */
+struct SqliteDb {
+    sqlite3* db;
+    sqlite3_stmt* insert;
+    int64_t session;
+    int64_t samples;
+    int channels;           // bound columns, gChannelCount at open
+    int rows;               // in the open transaction
+    int64_t txnStart;
+    bool failed;
+};
+
+static SqliteDb gDb;
+
+static bool exec(sqlite3* db, const char* sql);
+static bool prepareSchema(SqliteDb &d, const string &session);
+static void commit(SqliteDb &d);
+static void sqliteWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void sqliteFlush(Sink* s);
+static void sqliteClose(Sink* s);
+
+/**
+ * Opens or creates the database, starts a session row and registers the
+ * sink.
+ */
+bool sqliteSinkOpen(const string &file, const string &session)
+{
+    memset(&gDb, 0, sizeof(gDb));
+    if (sqlite3_open_v2(file.c_str(), &gDb.db, SQLITE_OPEN_READWRITE |
+                        SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        LPRINTF("DataLogger Plugin: unable to open the sqlite database ");
+        LPRINTF(file.c_str()); LPRINTF("\n");
+        sqlite3_close(gDb.db);
+        gDb.db = NULL;
+        return false;
+    }
+    statsAddShared(gStats.filesOpened, 1);
+
+    // the page size only takes on a new database, before WAL is set
+    char pragmas[160];
+    snprintf(pragmas, sizeof(pragmas),
+             "PRAGMA page_size=%d; PRAGMA journal_mode=WAL;"
+             " PRAGMA synchronous=NORMAL; PRAGMA temp_store=MEMORY;",
+             SQLITE_PAGE_SIZE);
+    if (!exec(gDb.db, pragmas) || !prepareSchema(gDb, session)) {
+        sqliteClose(NULL);
+        return false;
+    }
+
+    gStream.cur = NULL;
+    if (sinkCreate(ENC_SQLITE, gConfig.policy[ENC_SQLITE], &gDb, sqliteWrite,
+                   sqliteFlush, sqliteClose) == NULL) {
+        sqliteClose(NULL);
+        return false;
+    }
+    return true;
+}
+
+bool exec(sqlite3* db, const char* sql)
+{
+    char* err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) == SQLITE_OK)
+        return true;
+    msgPost("DataLogger Plugin: sqlite error %s\n", err != NULL ? err : sqlite3_errmsg(db));
+    sqlite3_free(err);
+    return false;
+}
+
+/**
+ * Creates the tables, adds a column for every channel the samples table
+ * doesn't have yet, records the session and its channels and prepares
+ * the insert.
+ */
+bool prepareSchema(SqliteDb &d, const string &session)
+{
+    if (!exec(d.db,
+              "CREATE TABLE IF NOT EXISTS sessions(id INTEGER PRIMARY KEY,"
+              " name TEXT, started INTEGER, ended INTEGER, samples INTEGER);"
+              "CREATE TABLE IF NOT EXISTS channels(session INTEGER NOT NULL,"
+              " idx INTEGER NOT NULL, name TEXT, grp TEXT,"
+              " PRIMARY KEY(session, idx));"
+              "CREATE TABLE IF NOT EXISTS samples(session INTEGER NOT NULL,"
+              " time REAL NOT NULL, wall INTEGER NOT NULL, cycle INTEGER);"
+              "CREATE INDEX IF NOT EXISTS samples_session_time ON samples(session, time);"
+              "CREATE INDEX IF NOT EXISTS samples_wall ON samples(wall);"))
+        return false;
+
+    string have;
+    sqlite3_stmt* st = NULL;
+    if (sqlite3_prepare_v2(d.db, "PRAGMA table_info(samples)", -1, &st, NULL) == SQLITE_OK) {
+        while (sqlite3_step(st) == SQLITE_ROW)
+            have += string("|") + (const char*)sqlite3_column_text(st, 1) + "|";
+    }
+    sqlite3_finalize(st);
+
+    string sql = "BEGIN;";
+    for (int i = 0; i < gChannelCount; i++) {
+        if (have.find(string("|") + gChannelDefs[i].name + "|") == string::npos)
+            sql += string("ALTER TABLE samples ADD COLUMN \"") + gChannelDefs[i].name + "\" REAL;";
+    }
+    sql += "COMMIT;";
+    if (!exec(d.db, sql.c_str()))
+        return false;
+
+    st = NULL;
+    if (sqlite3_prepare_v2(d.db, "INSERT INTO sessions(name, started, samples) VALUES(?, ?, 0)",
+                           -1, &st, NULL) != SQLITE_OK)
+        return false;
+    sqlite3_bind_text(st, 1, session.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(st, 2, (sqlite3_int64)time(0));
+    bool ok = sqlite3_step(st) == SQLITE_DONE;
+    sqlite3_finalize(st);
+    if (!ok)
+        return false;
+    d.session = sqlite3_last_insert_rowid(d.db);
+
+    st = NULL;
+    if (sqlite3_prepare_v2(d.db, "INSERT INTO channels VALUES(?, ?, ?, ?)", -1, &st, NULL) != SQLITE_OK)
+        return false;
+    exec(d.db, "BEGIN");
+    for (int i = 0; i < gChannelCount; i++) {
+        sqlite3_bind_int64(st, 1, d.session);
+        sqlite3_bind_int(st, 2, i);
+        sqlite3_bind_text(st, 3, gChannelDefs[i].name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(st, 4, gGroupNames[gChannelDefs[i].group], -1, SQLITE_STATIC);
+        sqlite3_step(st);
+        sqlite3_reset(st);
+    }
+    sqlite3_finalize(st);
+    exec(d.db, "COMMIT");
+
+    sql = "INSERT INTO samples(session, time, wall, cycle";
+    string values = "?, ?, ?, ?";
+    for (int i = 0; i < gChannelCount; i++) {
+        sql += string(", \"") + gChannelDefs[i].name + "\"";
+        values += ", ?";
+    }
+    sql += ") VALUES(" + values + ")";
+    if (sqlite3_prepare_v3(d.db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                           &d.insert, NULL) != SQLITE_OK) {
+        msgPost("DataLogger Plugin: sqlite error %s\n", sqlite3_errmsg(d.db));
+        return false;
+    }
+    d.channels = gChannelCount;
+    return true;
+}
+
+/**
+ * Inserts the rows, a transaction spans many buffers and is committed
+ * every SQLITE_BATCH_ROWS rows or by the flush. The batches are made here
+ * rather than on the writer thread, which already hands the rows over a
+ * buffer at a time: the transactions come out the same, and a commit's
+ * WAL sync only holds up this sink's thread instead of every output.
+ */
+void sqliteWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    SqliteDb &d = *(SqliteDb*)s->ctx;
+    if (d.failed)
+        return;
+    for (int b = 0; b < n; b++) {
+        const char* p = bufs[b]->data;
+        const char* end = p + bufs[b]->len;
+        while (p + SQLITE_RECORD_HEADER_SIZE <= end) {
+            uint16_t size;
+            uint64_t present;
+            int64_t wall;
+            int32_t cycle;
+            float elapsed;
+            const char* rec = p;
+            p = get(p, size);
+            if (size < SQLITE_RECORD_HEADER_SIZE || rec + size > end)
+                break;
+            p = get(p, present);
+            p = get(p, wall);
+            p = get(p, cycle);
+            p = get(p, elapsed);
+
+            if (d.rows == 0) {
+                if (!exec(d.db, "BEGIN")) {
+                    d.failed = true;
+                    return;
+                }
+                d.txnStart = statsTickUs();
+            }
+            sqlite3_bind_int64(d.insert, 1, d.session);
+            sqlite3_bind_double(d.insert, 2, elapsed);
+            sqlite3_bind_int64(d.insert, 3, wall);
+            sqlite3_bind_int(d.insert, 4, cycle);
+            for (int i = 0; i < d.channels; i++) {
+                if (present & CHANNEL_BIT(i)) {
+                    double v;
+                    p = get(p, v);
+                    sqlite3_bind_double(d.insert, 5 + i, v);
+                } else {
+                    sqlite3_bind_null(d.insert, 5 + i);
+                }
+            }
+            if (sqlite3_step(d.insert) != SQLITE_DONE) {
+                msgPost("DataLogger Plugin: sqlite error %s\n", sqlite3_errmsg(d.db));
+                d.failed = true;
+                return;
+            }
+            sqlite3_reset(d.insert);
+            d.rows += 1;
+            d.samples += 1;
+            if (d.rows == SQLITE_BATCH_ROWS)
+                commit(d);
+            p = rec + size;
+        }
+    }
+}
+
+void sqliteFlush(Sink* s)
+{
+    SqliteDb &d = *(SqliteDb*)s->ctx;
+    if (d.rows > 0 && statsTickUs() - d.txnStart >= SQLITE_COMMIT_US)
+        commit(d);
+}
+
+void commit(SqliteDb &d)
+{
+    if (!exec(d.db, "COMMIT"))
+        d.failed = true;
+    d.rows = 0;
+}
+
+/**
+ * Commits the last rows and closes the session.
+ */
+void sqliteClose(Sink* s)
+{
+    SqliteDb &d = gDb;
+    if (d.db == NULL)
+        return;
+    if (d.rows > 0)
+        commit(d);
+    if (d.session > 0) {
+        sqlite3_stmt* st = NULL;
+        if (sqlite3_prepare_v2(d.db, "UPDATE sessions SET ended = ?, samples = ? WHERE id = ?",
+                               -1, &st, NULL) == SQLITE_OK) {
+            sqlite3_bind_int64(st, 1, (sqlite3_int64)time(0));
+            sqlite3_bind_int64(st, 2, d.samples);
+            sqlite3_bind_int64(st, 3, d.session);
+            sqlite3_step(st);
+        }
+        sqlite3_finalize(st);
+    }
+    sqlite3_finalize(d.insert);
+    sqlite3_close(d.db);
+    d.db = NULL;
+    d.insert = NULL;
+}
+
+#else /* !WITH_SQLITE */
+
+bool sqliteSinkOpen(const string &file, const string &session)
+{
+    LPRINTF("DataLogger Plugin: the sqlite output isn't built in, see sqlite/README.md...\n");
+    return false;
+}
+
+#endif
+
+/**
+ * Packs the channels of the sampled groups into a row record.
+ */
+void sqliteEncode(const Sample &s, uint64_t changed)
+{
+    char buf[SQLITE_RECORD_HEADER_SIZE + MAX_CHANNELS * sizeof(double)];
+    uint64_t present = channelsInGroups(s.groups);
+    char* p = buf + sizeof(uint16_t);
+    p = put<uint64_t>(p, present);
+    p = put<int64_t>(p, (int64_t)s.wallTime);
+    p = put<int32_t>(p, s.cycle);
+    p = put<float>(p, s.elapsed);
+    for (int i = 0; i < gChannelCount; i++) {
+        if (present & CHANNEL_BIT(i))
+            p = put<double>(p, s.ch[i]);
+    }
+    put<uint16_t>(buf, (uint16_t)(p - buf));
+    sinkAppend(gStream, buf, p - buf);
+}
+
+/**
+ *
+ */
+void sqliteEncodeEnd(void)
+{
+    sinkEnd(gStream);
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <atomic>
+#include <stddef.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMDataAccess.h"
+
+#include "./include/stats.h"
+#include "./include/writer.h"
+
+using namespace std;
+
+Stats gStats;
+
+const uint64_t gLatencyBoundsUs[STATS_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+const uint64_t gDepthBounds[STATS_BUCKETS] = {
+    0, 1, 2, 4, 8, 16, 32, 64, 96, 128, 192, 255
+};
+
+static int getCounter(void* inRefcon);
+static double getCounterd(void* inRefcon);
+static float getFloat(void* inRefcon);
+static int getQueueDepth(void* inRefcon);
+static void resetHistogram(StatsHistogram &h);
+
+enum {
+    STAT_INT = 0
+    ,STAT_DOUBLE
+    ,STAT_FLOAT
+    ,STAT_QUEUE
+};
+
+static const struct {
+    const char* name;
+    int kind;
+    void* refcon;
+} gStatDefs[] = {
+    {"datalogger/stats/samples_captured",    STAT_INT,    &gStats.captured}
+    ,{"datalogger/stats/samples_written",    STAT_INT,    &gStats.written}
+    ,{"datalogger/stats/samples_dropped",    STAT_INT,    &gStats.dropped}
+    ,{"datalogger/stats/queue_depth",        STAT_QUEUE,  NULL}
+    ,{"datalogger/stats/bytes_written",      STAT_DOUBLE, &gStats.bytesWritten}
+    ,{"datalogger/stats/sink_dropped",       STAT_INT,    &gStats.sinkDropped}
+    ,{"datalogger/stats/file_size",          STAT_DOUBLE, &gStats.fileSize}
+    ,{"datalogger/stats/callback_last_us",   STAT_FLOAT,  &gStats.cbLastUs}
+    ,{"datalogger/stats/callback_avg_us",    STAT_FLOAT,  &gStats.cbAvgUs}
+    ,{"datalogger/stats/callback_max_us",    STAT_FLOAT,  &gStats.cbMaxUs}
+    ,{"datalogger/stats/writer_lag_ms",      STAT_FLOAT,  &gStats.writerLagMs}
+};
+
+#define NUM_STATS (sizeof(gStatDefs) / sizeof(gStatDefs[0]))
+static XPLMDataRef gStatRefs[NUM_STATS];
+
+/**
+ *
+ */
+void statsRegister(void)
+{
+    statsReset();
+    for (size_t i = 0; i < NUM_STATS; i++) {
+        void* ref = gStatDefs[i].refcon;
+        switch (gStatDefs[i].kind) {
+        case STAT_INT:
+        case STAT_QUEUE:
+            gStatRefs[i] = XPLMRegisterDataAccessor(gStatDefs[i].name,
+                    xplmType_Int, 0,
+                    gStatDefs[i].kind == STAT_INT ? getCounter : getQueueDepth,
+                    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                    NULL, NULL, ref, NULL);
+            break;
+        case STAT_DOUBLE:
+            gStatRefs[i] = XPLMRegisterDataAccessor(gStatDefs[i].name,
+                    xplmType_Double, 0, NULL, NULL, NULL, NULL,
+                    getCounterd, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                    ref, NULL);
+            break;
+        case STAT_FLOAT:
+            gStatRefs[i] = XPLMRegisterDataAccessor(gStatDefs[i].name,
+                    xplmType_Float, 0, NULL, NULL, getFloat, NULL, NULL, NULL,
+                    NULL, NULL, NULL, NULL, NULL, NULL, ref, NULL);
+            break;
+        }
+    }
+}
+
+/**
+ *
+ */
+void statsUnregister(void)
+{
+    for (size_t i = 0; i < NUM_STATS; i++) {
+        if (gStatRefs[i] != NULL)
+            XPLMUnregisterDataAccessor(gStatRefs[i]);
+        gStatRefs[i] = NULL;
+    }
+}
+
+/**
+ * Clears the per-session counters.
+ */
+void statsReset(void)
+{
+    gStats.captured.store(0);
+    gStats.written.store(0);
+    gStats.dropped.store(0);
+    gStats.bytesWritten.store(0);
+    gStats.sinkDropped.store(0);
+    gStats.fileSize.store(0);
+    gStats.cbLastUs.store(0.0f);
+    gStats.cbAvgUs.store(0.0f);
+    gStats.cbMaxUs.store(0.0f);
+    gStats.writerLagMs.store(0.0f);
+    gStats.filesOpened.store(0);
+    resetHistogram(gStats.cbUs);
+    resetHistogram(gStats.queueDepth);
+    resetHistogram(gStats.writerLagUs);
+    for (int e = 0; e < NUM_ENCODINGS; e++)
+        resetHistogram(gStats.flushUs[e]);
+}
+
+/**
+ * Flight loop thread only.
+ */
+#define CB_AVG_WEIGHT (0.01f)
+void statsCallbackTime(float us)
+{
+    gStats.cbLastUs.store(us, memory_order_relaxed);
+    float avg = gStats.cbAvgUs.load(memory_order_relaxed);
+    gStats.cbAvgUs.store(avg + (us - avg) * CB_AVG_WEIGHT, memory_order_relaxed);
+    if (us > gStats.cbMaxUs.load(memory_order_relaxed))
+        gStats.cbMaxUs.store(us, memory_order_relaxed);
+    statsObserve(gStats.cbUs, gLatencyBoundsUs, (uint64_t)us);
+}
+
+int getCounter(void* inRefcon)
+{
+    return (int)static_cast<atomic<uint64_t>*>(inRefcon)->load(memory_order_relaxed);
+}
+
+double getCounterd(void* inRefcon)
+{
+    return (double)static_cast<atomic<uint64_t>*>(inRefcon)->load(memory_order_relaxed);
+}
+
+float getFloat(void* inRefcon)
+{
+    return static_cast<atomic<float>*>(inRefcon)->load(memory_order_relaxed);
+}
+
+int getQueueDepth(void* inRefcon)
+{
+    return (int)gSampleQueue.size();
+}
+
+void resetHistogram(StatsHistogram &h)
+{
+    for (int b = 0; b <= STATS_BUCKETS; b++)
+        h.bucket[b].store(0);
+    h.count.store(0);
+    h.sum.store(0);
+}
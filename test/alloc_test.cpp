@@ -0,0 +1,111 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Runs the plugin against stubbed XPLM calls (test/xplmstub.h) and checks
+// that a sim frame doesn't allocate once logging is under way. The plugin
+// is started in a temporary directory, logging is enabled with a click on
+// its window and the flight loops and the window's draw callback are then
+// called once per frame with the position moving. The operator new calls
+// on the sim thread are counted over the frames after the warm-up, the
+// writer and sink threads may allocate.
+//
+//  $ make check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+
+#include "./test/testutil.h"
+
+using namespace std;
+
+#define WARMUP_FRAMES (10 * FRAME_RATE)
+#define TEST_FRAMES (60 * FRAME_RATE)
+
+static atomic<long> gAllocs(0);
+static thread_local bool tCounted = false;
+
+static void* counted(size_t n)
+{
+    if (tCounted)
+        gAllocs.fetch_add(1);
+    void* p = malloc(n == 0 ? 1 : n);
+    if (p == NULL)
+        throw bad_alloc();
+    return p;
+}
+
+void* operator new(size_t n)
+{
+    return counted(n);
+}
+
+void* operator new[](size_t n)
+{
+    return counted(n);
+}
+
+void* operator new(size_t n, const nothrow_t &) noexcept
+{
+    if (tCounted)
+        gAllocs.fetch_add(1);
+    return malloc(n == 0 ? 1 : n);
+}
+
+void* operator new[](size_t n, const nothrow_t &) noexcept
+{
+    if (tCounted)
+        gAllocs.fetch_add(1);
+    return malloc(n == 0 ? 1 : n);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/dl_alloc_test.XXXXXX";
+    if (!testStart(dir, ""))
+        return 1;
+    testClick(false);   // start logging
+    testClick(true);    // expand the panel
+    if (!gPanelExpanded) {
+        fprintf(stderr, "alloc_test: the panel didn't expand\n");
+        return 1;
+    }
+
+    for (int i = 0; i < WARMUP_FRAMES; i++)
+        testFrame();
+    tCounted = true;
+    for (int i = 0; i < TEST_FRAMES; i++)
+        testFrame();
+    tCounted = false;
+    long allocs = gAllocs.load();
+
+    testClick(false);   // stop logging
+    XPluginDisable();
+    XPluginStop();
+    testRemoveDir(dir);
+
+    printf("alloc_test: %ld allocations in %d frames\n", allocs, TEST_FRAMES);
+    return allocs == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Logs a session with the binary log on against stubbed XPLM calls
+// (test/xplmstub.h), with an airport load halfway that breaks the track
+// segment without moving the plane, then converts the binary log with
+// tools/dl_convert and checks that the GPX track it makes is the one the
+// plugin wrote live.
+//
+//  $ make check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include "./SDK/CHeaders/XPLM/XPLMPlugin.h"
+
+#include "./test/testutil.h"
+
+using namespace std;
+
+#define SESSION_FRAMES (20 * FRAME_RATE)
+#define LIVE_SEGMENTS (2)
+
+static string readFile(const string &path)
+{
+    ifstream f(path, ifstream::binary);
+    stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+/**
+ * The session's main track, DataLog-<time>.gpx.
+ */
+static string findTrack(const string &dir)
+{
+    string name;
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+        return name;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        string n = de->d_name;
+        if (n.compare(0, 8, "DataLog-") == 0 && n.size() > 4 &&
+            n.compare(n.size() - 4, 4, ".gpx") == 0)
+            name = n;
+    }
+    closedir(d);
+    return name;
+}
+
+static int count(const string &s, const char* what)
+{
+    int n = 0;
+    for (size_t p = s.find(what); p != string::npos; p = s.find(what, p + 1))
+        n += 1;
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: convert_test <dl_convert>\n");
+        return 2;
+    }
+    char* convert = realpath(argv[1], NULL);
+    if (convert == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/dl_convert_test.XXXXXX";
+    if (!testStart(dir, "binary=1\n"))
+        return 1;
+    testClick(false);   // start logging
+    for (int i = 0; i < SESSION_FRAMES / 2; i++)
+        testFrame();
+    XPluginReceiveMessage(XPLM_PLUGIN_XPLANE, XPLM_MSG_AIRPORT_LOADED, NULL);
+    for (int i = 0; i < SESSION_FRAMES / 2; i++)
+        testFrame();
+    testClick(false);   // stop logging
+    XPluginDisable();
+    XPluginStop();
+
+    char out[] = "/tmp/dl_convert_out.XXXXXX";
+    if (mkdtemp(out) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    string cmd = string(convert) + " -j 1 " + dir + " " + out + " > /dev/null";
+    free(convert);
+    int failed = 0;
+    string name = findTrack(dir);
+    if (name.empty()) {
+        fprintf(stderr, "convert_test: no GPX track was written\n");
+        failed = 1;
+    } else if (system(cmd.c_str()) != 0) {
+        fprintf(stderr, "convert_test: %s failed\n", cmd.c_str());
+        failed = 1;
+    } else {
+        string live = readFile(string(dir) + "/" + name);
+        string converted = readFile(string(out) + "/" + name);
+        int segments = count(live, "<trkseg>");
+        if (segments != LIVE_SEGMENTS) {
+            fprintf(stderr, "convert_test: the live track has %d segments, not %d\n",
+                    segments, LIVE_SEGMENTS);
+            failed = 1;
+        } else if (converted != live) {
+            fprintf(stderr, "convert_test: %s converted from the binary log differs"
+                            " from the live track\n", name.c_str());
+            failed = 1;
+        } else {
+            printf("convert_test: %s, %d points in %d segments, converted identically\n",
+                   name.c_str(), count(live, "<trkpt "), segments);
+        }
+    }
+    testRemoveDir(out);
+    testRemoveDir(dir);
+    return failed;
+}
@@ -0,0 +1,251 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Times tools/gpxreader against reference readers on the same track:
+// a line at a time with sscanf, and with $ make bench WITH_EXPAT=1 the
+// expat XML parser. The track is made in memory from a fixed seed with
+// the plugin's own formatting (include/gpxformat.h), so every run reads
+// the same bytes, and each reader's points are checked against
+// gpxParse's. MB/s of GPX text, best of ROUNDS.
+//
+//  $ make bench [WITH_EXPAT=1]
+//
+// make clean first when switching WITH_EXPAT.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <chrono>
+#include <algorithm>
+#include <string>
+
+#if WITH_EXPAT
+#include <expat.h>
+#endif
+
+#include "./include/gpxformat.h"
+#include "./tools/gpxreader.h"
+
+using namespace std;
+
+#define POINTS (400000)
+#define SEGMENT_POINTS (25000)
+#define ROUNDS (5)
+#define START_TIME (1700000000)
+
+static string gTrack;
+
+static double since(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+/**
+ * A random walk at 10 points a second, with a segment break every
+ * SEGMENT_POINTS points, as the writer lays it out.
+ */
+static void makeTrack(void)
+{
+    srand(1);
+    double lat = 46.5, lon = 8.9, alt = 2000.0;
+    char buf[GPX_POINT_SIZE];
+    gTrack = gpxProlog(gpxDateTime(START_TIME, true));
+    for (int i = 0; i < POINTS; i++) {
+        if (i > 0 && i % SEGMENT_POINTS == 0)
+            gTrack += GPX_SEGMENT_BREAK;
+        lat += (rand() % 2001 - 1000) * 1e-7;
+        lon += (rand() % 2001 - 1000) * 1e-7;
+        alt += (rand() % 2001 - 1000) * 1e-3;
+        string t = gpxDateTime(START_TIME + i / 10, false);
+        gTrack.append(buf, gpxPoint(buf, lat, lon, alt, t.c_str()));
+    }
+    gTrack += GPX_EPILOG;
+}
+
+static int64_t unixTime(int y, int mo, int d, int h, int mi, int s)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = y - 1900;
+    tm.tm_mon = mo - 1;
+    tm.tm_mday = d;
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_sec = s;
+    return (int64_t)timegm(&tm);
+}
+
+static void addSegment(GpxPoints &pts)
+{
+    uint32_t first = (uint32_t)pts.lat.size();
+    if (pts.segments.empty() || pts.segments.back() != first)
+        pts.segments.push_back(first);
+}
+
+/**
+ * What a quick tool would do, sscanf a line at a time. The
+ * line is copied out, glibc's sscanf takes the length of its input.
+ */
+static void readSscanf(const string &s, GpxPoints &pts)
+{
+    char line[GPX_POINT_SIZE];
+    const char* p = s.c_str();
+    const char* end = p + s.size();
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (nl == NULL)
+            nl = end;
+        size_t n = min((size_t)(nl - p), sizeof(line) - 1);
+        memcpy(line, p, n);
+        line[n] = '\0';
+        double lat, lon, ele;
+        int y, mo, d, h, mi, sec;
+        if (strncmp(line, "<trkpt ", 7) == 0 &&
+            sscanf(line, "<trkpt lat=\"%lf\" lon=\"%lf\"><ele>%lf</ele><time>%d-%d-%dT%d:%d:%dZ",
+                   &lat, &lon, &ele, &y, &mo, &d, &h, &mi, &sec) == 9) {
+            pts.lat.push_back(lat);
+            pts.lon.push_back(lon);
+            pts.ele.push_back(ele);
+            pts.time.push_back(unixTime(y, mo, d, h, mi, sec));
+        } else if (strstr(line, "<trkseg>") != NULL) {
+            addSegment(pts);
+        }
+        p = nl + 1;
+    }
+}
+
+#if WITH_EXPAT
+
+/**
+ * The text of the element being read, ele or time.
+ */
+struct ExpatState {
+    GpxPoints* pts;
+    string text;
+    bool inText;
+};
+
+static void XMLCALL expatStart(void* ud, const XML_Char* name, const XML_Char** attrs)
+{
+    ExpatState &st = *(ExpatState*)ud;
+    if (strcmp(name, "trkpt") == 0) {
+        double lat = 0.0, lon = 0.0;
+        for (int i = 0; attrs[i] != NULL; i += 2) {
+            if (strcmp(attrs[i], "lat") == 0)
+                lat = strtod(attrs[i + 1], NULL);
+            else if (strcmp(attrs[i], "lon") == 0)
+                lon = strtod(attrs[i + 1], NULL);
+        }
+        st.pts->lat.push_back(lat);
+        st.pts->lon.push_back(lon);
+        st.pts->ele.push_back(0.0);
+        st.pts->time.push_back(0);
+    } else if (strcmp(name, "trkseg") == 0) {
+        addSegment(*st.pts);
+    } else if (strcmp(name, "ele") == 0 || strcmp(name, "time") == 0) {
+        st.text.clear();
+        st.inText = true;
+    }
+}
+
+static void XMLCALL expatEnd(void* ud, const XML_Char* name)
+{
+    ExpatState &st = *(ExpatState*)ud;
+    if (!st.inText)
+        return;
+    st.inText = false;
+    GpxPoints &pts = *st.pts;
+    if (pts.lat.empty())
+        return;                 // the metadata time
+    if (strcmp(name, "ele") == 0) {
+        pts.ele.back() = strtod(st.text.c_str(), NULL);
+    } else {
+        int y, mo, d, h, mi, sec;
+        if (sscanf(st.text.c_str(), "%d-%d-%dT%d:%d:%dZ", &y, &mo, &d, &h, &mi, &sec) == 6)
+            pts.time.back() = unixTime(y, mo, d, h, mi, sec);
+    }
+}
+
+static void XMLCALL expatText(void* ud, const XML_Char* s, int len)
+{
+    ExpatState &st = *(ExpatState*)ud;
+    if (st.inText)
+        st.text.append(s, len);
+}
+
+static void readExpat(const string &s, GpxPoints &pts)
+{
+    ExpatState st;
+    st.pts = &pts;
+    st.inText = false;
+    XML_Parser p = XML_ParserCreate(NULL);
+    XML_SetUserData(p, &st);
+    XML_SetElementHandler(p, expatStart, expatEnd);
+    XML_SetCharacterDataHandler(p, expatText);
+    if (XML_Parse(p, s.data(), (int)s.size(), 1) == XML_STATUS_ERROR)
+        fprintf(stderr, "expat: %s at line %lu\n", XML_ErrorString(XML_GetErrorCode(p)),
+                (unsigned long)XML_GetCurrentLineNumber(p));
+    XML_ParserFree(p);
+}
+
+#endif /* WITH_EXPAT */
+
+static void readGpxParse(const string &s, GpxPoints &pts)
+{
+    gpxParse(s.data(), s.size(), pts);
+}
+
+/**
+ * The same points and segments as gpxParse, to its precision.
+ */
+static bool samePoints(const GpxPoints &a, const GpxPoints &b)
+{
+    if (a.lat.size() != b.lat.size() || a.segments != b.segments || a.time != b.time)
+        return false;
+    for (size_t k = 0; k < a.lat.size(); k++) {
+        if (fabs(a.lat[k] - b.lat[k]) > 1e-9 || fabs(a.lon[k] - b.lon[k]) > 1e-9 ||
+            fabs(a.ele[k] - b.ele[k]) > 1e-9)
+            return false;
+    }
+    return true;
+}
+
+static double bench(const char* what, void (*read)(const string &, GpxPoints &),
+                    const GpxPoints* ref, GpxPoints &pts)
+{
+    double best = 0.0;
+    for (int r = 0; r < ROUNDS; r++) {
+        gpxClear(pts);
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        read(gTrack, pts);
+        double secs = since(t0);
+        if (r == 0 || secs < best)
+            best = secs;
+    }
+    printf("%-10s %8.1f MB/s  %7.1f ms  %zu points%s\n", what, gTrack.size() / best / 1e6,
+           best * 1e3, pts.lat.size(),
+           ref != NULL && !samePoints(*ref, pts) ? "  the points differ" : "");
+    return best;
+}
+
+int main(void)
+{
+    makeTrack();
+    printf("%d points, %d segments, %.1f MB, best of %d\n", POINTS,
+           (POINTS + SEGMENT_POINTS - 1) / SEGMENT_POINTS, gTrack.size() / 1e6, ROUNDS);
+
+    GpxPoints ref, pts;
+    double fast = bench("gpxParse", readGpxParse, NULL, ref);
+    double slow = bench("sscanf", readSscanf, &ref, pts);
+    printf("gpxParse is %.1fx sscanf\n", slow / fast);
+#if WITH_EXPAT
+    slow = bench("expat", readExpat, &ref, pts);
+    printf("gpxParse is %.1fx expat\n", slow / fast);
+#else
+    printf("expat isn't built in, see make bench WITH_EXPAT=1\n");
+#endif
+    return 0;
+}
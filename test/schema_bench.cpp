@@ -0,0 +1,144 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Times the compile-time schema of the built-in channels (include/schema.h)
+// against the table driven code the config file channels go through, on
+// the same samples: the deadband test, the binary encoder and the text
+// formatter, ns per record of all NUM_CHANNELS channels.
+//
+//  $ make bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "./include/channels.h"
+#include "./include/deadband.h"
+#include "./include/schema.h"
+
+using namespace std;
+
+#define SAMPLES (1024)
+#define ROUNDS (2000)
+
+static double gSamples[SAMPLES][MAX_CHANNELS];
+static float gAbsBand[MAX_CHANNELS];
+static float gRelBand[MAX_CHANNELS];
+static DeadbandState gState;
+static volatile uint64_t gSink;
+
+static double since(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+static void report(const char* what, double schema, double generic)
+{
+    double n = (double)SAMPLES * ROUNDS;
+    printf("%-8s schema %7.1f ns   table %7.1f ns   %.2fx\n", what,
+           schema / n * 1e9, generic / n * 1e9, generic / schema);
+}
+
+/**
+ * A random walk per channel, about half of the steps leave the band.
+ */
+static void makeSamples(void)
+{
+    srand(1);
+    for (int i = 0; i < NUM_CHANNELS; i++) {
+        gAbsBand[i] = 0.5f;
+        gRelBand[i] = 0.001f;
+        gState.last[i] = 100.0;
+    }
+    gState.seen = CHANNEL_BIT(NUM_CHANNELS) - 1;
+    for (int s = 0; s < SAMPLES; s++) {
+        for (int i = 0; i < NUM_CHANNELS; i++) {
+            double prev = s > 0 ? gSamples[s - 1][i] : 100.0;
+            gSamples[s][i] = prev + (rand() % 2001 - 1000) / 1000.0;
+        }
+    }
+}
+
+static void benchMoved(void)
+{
+    uint64_t acc = 0;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            acc += BuiltinSchema::moved(gState, gSamples[s], gAbsBand, gRelBand);
+    double schema = since(t0);
+
+    uint64_t check = 0;
+    t0 = chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            check += deadbandMoved(gState, gSamples[s], gAbsBand, gRelBand, 0, NUM_CHANNELS);
+    double generic = since(t0);
+
+    if (acc != check)
+        printf("moved: the results differ\n");
+    gSink = acc;
+    report("moved", schema, generic);
+}
+
+static void benchEncode(void)
+{
+    char a[MAX_CHANNELS * 8];
+    char b[MAX_CHANNELS * 8];
+    const uint64_t all = CHANNEL_BIT(NUM_CHANNELS) - 1;
+    uint64_t acc = 0;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            acc += BuiltinSchema::encode(a, gSamples[s], all - (uint64_t)(s & 1)) - a;
+    double schema = since(t0);
+
+    uint64_t check = 0;
+    t0 = chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            check += channelsEncodeGeneric(b, gSamples[s], all - (uint64_t)(s & 1)) - b;
+    double generic = since(t0);
+
+    size_t n = BuiltinSchema::encode(a, gSamples[0], all) - a;
+    if (acc != check || channelsEncodeGeneric(b, gSamples[0], all) - b != (ptrdiff_t)n ||
+        memcmp(a, b, n) != 0)
+        printf("encode: the results differ\n");
+    gSink = acc;
+    report("encode", schema, generic);
+}
+
+static void benchFormat(void)
+{
+    char buf[2048];
+    char* end = buf + sizeof(buf) - 1;
+    const uint64_t all = CHANNEL_BIT(NUM_CHANNELS) - 1;
+    const int rounds = ROUNDS / 20;
+    uint64_t acc = 0;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            acc += BuiltinSchema::format(buf, end, gSamples[s], all) - buf;
+    double schema = since(t0);
+
+    t0 = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (int s = 0; s < SAMPLES; s++)
+            acc += channelsFormatGeneric(buf, end, gSamples[s], all) - buf;
+    double generic = since(t0);
+
+    gSink = acc;
+    report("format", schema * 20, generic * 20);
+}
+
+int main(void)
+{
+    makeSamples();
+    printf("%d channels, %d samples x %d rounds\n", NUM_CHANNELS, SAMPLES, ROUNDS);
+    benchMoved();
+    benchEncode();
+    benchFormat();
+    return 0;
+}
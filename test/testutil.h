@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "./SDK/CHeaders/XPLM/XPLMDefs.h"
+
+#include "./include/panel.h"
+#include "./test/xplmstub.h"
+
+/*
+ * Drives the plugin for the test programs: a session in a temporary
+ * directory, clicks on its window and sim frames.
+ */
+#define FRAME_RATE (60)
+
+PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc);
+PLUGIN_API void XPluginStop(void);
+PLUGIN_API int XPluginEnable(void);
+PLUGIN_API void XPluginDisable(void);
+PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFrom, long inMsg, void* inParam);
+
+/**
+ * Makes dir, a mkdtemp template, the working and output directory with
+ * the DataLogPath.txt settings lines and starts the plugin there.
+ */
+static inline bool testStart(char* dir, const char* settings)
+{
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return false;
+    }
+    FILE* f = fopen("DataLogPath.txt", "w");
+    if (f == NULL) {
+        perror("DataLogPath.txt");
+        return false;
+    }
+    fprintf(f, "%s\n%s", dir, settings);
+    fclose(f);
+
+    char name[256], sig[256], desc[256];
+    XPluginStart(name, sig, desc);
+    XPluginEnable();
+    if (gStubDraw == NULL || gStubMouse == NULL) {
+        fprintf(stderr, "the plugin didn't create its window\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * A click on the status line, or on the panel toggle at its right.
+ */
+static inline void testClick(bool toggle)
+{
+    int left, top, right, bottom;
+    XPLMGetWindowGeometry(gStubWindow, &left, &top, &right, &bottom);
+    int x = toggle ? right - PANEL_TOGGLE_WIDTH / 2 : left + 4;
+    gStubMouse(gStubWindow, x, top, xplm_MouseDown, gStubWindowRefcon);
+    gStubMouse(gStubWindow, x, top, xplm_MouseUp, gStubWindowRefcon);
+}
+
+/**
+ * One sim frame, the flight loops are called every frame whatever they
+ * asked for.
+ */
+static inline void testFrame(void)
+{
+    gStubCycle += 1;
+    gStubElapsed += 1.0f / FRAME_RATE;
+    gStubValue += 0.00002;
+    for (int i = 0; i < STUB_MAX_FLIGHT_LOOPS; i++) {
+        StubFlightLoop l = gStubFlightLoops[i];
+        if (l.fn != NULL)
+            l.fn(1.0f / FRAME_RATE, 1.0f / FRAME_RATE, gStubCycle, l.refcon);
+    }
+    gStubDraw(gStubWindow, gStubWindowRefcon);
+}
+
+/**
+ * Removes a directory of files.
+ */
+static inline void testRemoveDir(const std::string &dir)
+{
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+        return;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") != 0 && strcmp(de->d_name, "..") != 0)
+            remove((dir + "/" + de->d_name).c_str());
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+#endif /* TESTUTIL_H */
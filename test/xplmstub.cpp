@@ -0,0 +1,189 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Stand-ins for the XPLM and GL calls of the plugin, for the test and
+// bench programs that link its objects outside the simulator. Datarefs
+// read back as gStubValue, the window and flight loop callbacks are kept
+// for the program to call and debug strings go to stderr.
+
+#include <stdio.h>
+#include <GL/gl.h>
+
+#include "./SDK/CHeaders/XPLM/XPLMDataAccess.h"
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+#include "./SDK/CHeaders/XPLM/XPLMGraphics.h"
+#include "./SDK/CHeaders/XPLM/XPLMPlanes.h"
+
+#include "./test/xplmstub.h"
+
+double gStubValue = 1.0;
+int gStubCycle = 0;
+float gStubElapsed = 0.0f;
+XPLMWindowID gStubWindow = NULL;
+XPLMDrawWindow_f gStubDraw = NULL;
+XPLMHandleMouseClick_f gStubMouse = NULL;
+void* gStubWindowRefcon = NULL;
+StubFlightLoop gStubFlightLoops[STUB_MAX_FLIGHT_LOOPS];
+
+// the one window
+static int gWindow[4];
+
+extern "C" {
+
+XPLMDataRef XPLMFindDataRef(const char*)
+{
+    return (XPLMDataRef)1;
+}
+
+XPLMDataTypeID XPLMGetDataRefTypes(XPLMDataRef)
+{
+    return xplmType_Float | xplmType_FloatArray;
+}
+
+double XPLMGetDatad(XPLMDataRef)
+{
+    return gStubValue;
+}
+
+float XPLMGetDataf(XPLMDataRef)
+{
+    return (float)gStubValue;
+}
+
+int XPLMGetDatai(XPLMDataRef)
+{
+    return (int)gStubValue;
+}
+
+int XPLMGetDatavf(XPLMDataRef, float* out, int, int max)
+{
+    for (int i = 0; out != NULL && i < max; i++)
+        out[i] = (float)gStubValue;
+    return max;
+}
+
+int XPLMGetDatavi(XPLMDataRef, int* out, int, int max)
+{
+    for (int i = 0; out != NULL && i < max; i++)
+        out[i] = (int)gStubValue;
+    return max;
+}
+
+XPLMDataRef XPLMRegisterDataAccessor(const char*, XPLMDataTypeID, int,
+                                     XPLMGetDatai_f, XPLMSetDatai_f,
+                                     XPLMGetDataf_f, XPLMSetDataf_f,
+                                     XPLMGetDatad_f, XPLMSetDatad_f,
+                                     XPLMGetDatavi_f, XPLMSetDatavi_f,
+                                     XPLMGetDatavf_f, XPLMSetDatavf_f,
+                                     XPLMGetDatab_f, XPLMSetDatab_f,
+                                     void*, void*)
+{
+    return (XPLMDataRef)1;
+}
+
+void XPLMUnregisterDataAccessor(XPLMDataRef)
+{
+}
+
+void XPLMDebugString(const char* s)
+{
+    fputs(s, stderr);
+}
+
+int XPLMGetCycleNumber(void)
+{
+    return gStubCycle;
+}
+
+float XPLMGetElapsedTime(void)
+{
+    return gStubElapsed;
+}
+
+void XPLMRegisterFlightLoopCallback(XPLMFlightLoop_f fn, float, void* refcon)
+{
+    for (int i = 0; i < STUB_MAX_FLIGHT_LOOPS; i++) {
+        if (gStubFlightLoops[i].fn == NULL) {
+            gStubFlightLoops[i].fn = fn;
+            gStubFlightLoops[i].refcon = refcon;
+            return;
+        }
+    }
+}
+
+void XPLMUnregisterFlightLoopCallback(XPLMFlightLoop_f fn, void* refcon)
+{
+    for (int i = 0; i < STUB_MAX_FLIGHT_LOOPS; i++) {
+        if (gStubFlightLoops[i].fn == fn && gStubFlightLoops[i].refcon == refcon)
+            gStubFlightLoops[i].fn = NULL;
+    }
+}
+
+void XPLMCountAircraft(int* total, int* active, XPLMPluginID* controller)
+{
+    *total = 1;
+    *active = 1;
+    *controller = 0;
+}
+
+XPLMWindowID XPLMCreateWindow(int left, int top, int right, int bottom, int,
+                              XPLMDrawWindow_f draw, XPLMHandleKey_f,
+                              XPLMHandleMouseClick_f mouse, void* refcon)
+{
+    gWindow[0] = left;
+    gWindow[1] = top;
+    gWindow[2] = right;
+    gWindow[3] = bottom;
+    gStubDraw = draw;
+    gStubMouse = mouse;
+    gStubWindowRefcon = refcon;
+    gStubWindow = (XPLMWindowID)gWindow;
+    return gStubWindow;
+}
+
+void XPLMGetWindowGeometry(XPLMWindowID, int* left, int* top, int* right, int* bottom)
+{
+    *left = gWindow[0];
+    *top = gWindow[1];
+    *right = gWindow[2];
+    *bottom = gWindow[3];
+}
+
+void XPLMSetWindowGeometry(XPLMWindowID, int left, int top, int right, int bottom)
+{
+    gWindow[0] = left;
+    gWindow[1] = top;
+    gWindow[2] = right;
+    gWindow[3] = bottom;
+}
+
+void XPLMSetGraphicsState(int, int, int, int, int, int, int)
+{
+}
+
+void XPLMDrawTranslucentDarkBox(int, int, int, int)
+{
+}
+
+void XPLMDrawString(float*, int, int, char*, int*, XPLMFontID)
+{
+}
+
+void glBegin(GLenum)
+{
+}
+
+void glEnd(void)
+{
+}
+
+void glColor3f(GLfloat, GLfloat, GLfloat)
+{
+}
+
+void glVertex2f(GLfloat, GLfloat)
+{
+}
+
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef XPLMSTUB_H
+#define XPLMSTUB_H
+
+#include "./SDK/CHeaders/XPLM/XPLMDisplay.h"
+#include "./SDK/CHeaders/XPLM/XPLMProcessing.h"
+
+#define STUB_MAX_FLIGHT_LOOPS (8)
+
+/**
+ * A registered flight loop callback.
+ */
+struct StubFlightLoop {
+    XPLMFlightLoop_f fn;
+    void* refcon;
+};
+
+// the value every stubbed dataref reads
+extern double gStubValue;
+
+// what XPLMGetCycleNumber and XPLMGetElapsedTime return
+extern int gStubCycle;
+extern float gStubElapsed;
+
+// the last window created and its callbacks
+extern XPLMWindowID gStubWindow;
+extern XPLMDrawWindow_f gStubDraw;
+extern XPLMHandleMouseClick_f gStubMouse;
+extern void* gStubWindowRefcon;
+
+// the flight loops registered now, unregistered slots are NULL
+extern StubFlightLoop gStubFlightLoops[STUB_MAX_FLIGHT_LOOPS];
+
+#endif /* XPLMSTUB_H */
@@ -0,0 +1,339 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "../include/replace.h"
+#include "./areaindex.h"
+
+using namespace std;
+
+#define KEY_LEVEL_SHIFT (48)
+
+/**
+ * The cell column and row of a point on a level, clamped to the world.
+ */
+static inline uint32_t column(double lon, int level)
+{
+    double c = (lon + 180.0) / 360.0 * (double)(1u << level);
+    if (c < 0.0)
+        return 0;
+    if (c >= (double)(1u << level))
+        return (1u << level) - 1;
+    return (uint32_t)c;
+}
+
+static inline uint32_t row(double lat, int level)
+{
+    double r = (lat + 90.0) / 180.0 * (double)(1u << level);
+    if (r < 0.0)
+        return 0;
+    if (r >= (double)(1u << level))
+        return (1u << level) - 1;
+    return (uint32_t)r;
+}
+
+static inline uint64_t spread(uint32_t v)
+{
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+}
+
+static inline uint64_t cellKey(int level, uint32_t x, uint32_t y)
+{
+    return ((uint64_t)level << KEY_LEVEL_SHIFT) | spread(x) | (spread(y) << 1);
+}
+
+/**
+ * The box's cells on a level, as column and row ranges.
+ */
+struct CellRange {
+    uint32_t x0;
+    uint32_t x1;
+    uint32_t y0;
+    uint32_t y1;
+};
+
+static CellRange cellRange(double south, double west, double north,
+                           double east, int level)
+{
+    CellRange c;
+    c.x0 = column(west, level);
+    c.x1 = column(east, level);
+    c.y0 = row(south, level);
+    c.y1 = row(north, level);
+    return c;
+}
+
+static bool spanLess(const AreaSpan &a, const AreaSpan &b)
+{
+    return a.key != b.key ? a.key < b.key : a.block < b.block;
+}
+
+static bool cellLess(const AreaCell &a, const AreaCell &b)
+{
+    return a.key < b.key;
+}
+
+static bool runLess(const AreaRun &a, const AreaRun &b)
+{
+    return a.file != b.file ? a.file < b.file : a.block < b.block;
+}
+
+/**
+ * Each block goes in the deepest level where it spans at most 2 x 2
+ * cells, then a cell's adjacent blocks are merged into one span.
+ */
+void areaIndexSpans(const vector<IndexEntry> &blocks, vector<AreaSpan> &spans)
+{
+    spans.clear();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const IndexEntry &e = blocks[b];
+        if (e.minLat > e.maxLat)
+            continue;           // no position
+        int level = AREA_MAX_LEVEL;
+        CellRange c = cellRange(e.minLat, e.minLon, e.maxLat, e.maxLon, level);
+        while (level > 0 && (c.x1 - c.x0 > 1 || c.y1 - c.y0 > 1)) {
+            level -= 1;
+            c.x0 >>= 1;
+            c.x1 >>= 1;
+            c.y0 >>= 1;
+            c.y1 >>= 1;
+        }
+        for (uint32_t y = c.y0; y <= c.y1; y++) {
+            for (uint32_t x = c.x0; x <= c.x1; x++) {
+                AreaSpan s;
+                s.key = cellKey(level, x, y);
+                s.block = (uint32_t)b;
+                s.count = 1;
+                spans.push_back(s);
+            }
+        }
+    }
+    sort(spans.begin(), spans.end(), spanLess);
+
+    size_t n = 0;
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (n > 0 && spans[n - 1].key == spans[i].key &&
+            spans[n - 1].block + spans[n - 1].count == spans[i].block) {
+            spans[n - 1].count += 1;
+            continue;
+        }
+        spans[n++] = spans[i];
+    }
+    spans.resize(n);
+}
+
+/**
+ *
+ */
+bool areaIndexOpen(AreaIndex &a, const string &path)
+{
+    memset(&a, 0, sizeof(a));
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AreaHeader)) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    a.map = p;
+    a.size = (size_t)st.st_size;
+
+    const AreaHeader* h = (const AreaHeader*)p;
+    uint64_t need = sizeof(AreaHeader) + (uint64_t)h->files * sizeof(AreaFile) +
+                    (uint64_t)h->cells * sizeof(AreaCell) +
+                    (uint64_t)h->runs * sizeof(AreaRun);
+    if (memcmp(h->magic, AREA_MAGIC, 4) != 0 || h->version != AREA_VERSION ||
+        h->maxLevel != AREA_MAX_LEVEL || need > a.size) {
+        areaIndexClose(a);
+        return false;
+    }
+    a.hdr = h;
+    a.files = (const AreaFile*)(h + 1);
+    a.cells = (const AreaCell*)(a.files + h->files);
+    a.runs = (const AreaRun*)(a.cells + h->cells);
+    return true;
+}
+
+/**
+ *
+ */
+void areaIndexClose(AreaIndex &a)
+{
+    if (a.map != NULL)
+        munmap(a.map, a.size);
+    memset(&a, 0, sizeof(a));
+}
+
+static void addCell(const AreaIndex &a, const AreaCell &c, vector<AreaRun> &out)
+{
+    for (uint32_t r = 0; r < c.count; r++)
+        out.push_back(a.runs[c.first + r]);
+}
+
+/**
+ * On each level the box's cells are looked up one by one, or when it
+ * covers more cells than the level has in use those are scanned.
+ */
+void areaIndexQuery(const AreaIndex &a, double south, double west,
+                    double north, double east, vector<AreaRun> &out)
+{
+    out.clear();
+    if (south > north || west > east)
+        return;
+    const AreaCell* begin = a.cells;
+    const AreaCell* end = a.cells + a.hdr->cells;
+    for (int level = 0; level <= AREA_MAX_LEVEL; level++) {
+        AreaCell lo, hi;
+        lo.key = (uint64_t)level << KEY_LEVEL_SHIFT;
+        hi.key = (uint64_t)(level + 1) << KEY_LEVEL_SHIFT;
+        const AreaCell* first = lower_bound(begin, end, lo, cellLess);
+        const AreaCell* last = lower_bound(first, end, hi, cellLess);
+        if (first == last)
+            continue;
+
+        CellRange c = cellRange(south, west, north, east, level);
+        uint64_t want = (uint64_t)(c.x1 - c.x0 + 1) * (c.y1 - c.y0 + 1);
+        if (want > (uint64_t)(last - first)) {
+            for (const AreaCell* p = first; p < last; p++) {
+                uint32_t x = 0, y = 0;
+                for (int bit = 0; bit < level; bit++) {
+                    x |= (uint32_t)((p->key >> (2 * bit)) & 1) << bit;
+                    y |= (uint32_t)((p->key >> (2 * bit + 1)) & 1) << bit;
+                }
+                if (x >= c.x0 && x <= c.x1 && y >= c.y0 && y <= c.y1)
+                    addCell(a, *p, out);
+            }
+            continue;
+        }
+        for (uint32_t y = c.y0; y <= c.y1; y++) {
+            for (uint32_t x = c.x0; x <= c.x1; x++) {
+                AreaCell k;
+                k.key = cellKey(level, x, y);
+                const AreaCell* p = lower_bound(first, last, k, cellLess);
+                if (p != last && p->key == k.key)
+                    addCell(a, *p, out);
+            }
+        }
+    }
+
+    // a block can be in up to 4 cells
+    sort(out.begin(), out.end(), runLess);
+    size_t n = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (n > 0 && out[n - 1].file == out[i].file &&
+            out[n - 1].block + out[n - 1].count >= out[i].block) {
+            uint32_t end = out[i].block + out[i].count;
+            if (end > out[n - 1].block + out[n - 1].count)
+                out[n - 1].count = end - out[n - 1].block;
+            continue;
+        }
+        out[n++] = out[i];
+    }
+    out.resize(n);
+}
+
+/**
+ *
+ */
+void areaIndexFileSpans(const AreaIndex &a, vector<vector<AreaSpan> > &spans)
+{
+    spans.assign(a.hdr->files, vector<AreaSpan>());
+    for (uint32_t c = 0; c < a.hdr->cells; c++) {
+        const AreaCell &cell = a.cells[c];
+        for (uint32_t r = 0; r < cell.count; r++) {
+            const AreaRun &run = a.runs[cell.first + r];
+            if (run.file >= a.hdr->files)
+                continue;
+            AreaSpan s;
+            s.key = cell.key;
+            s.block = run.block;
+            s.count = run.count;
+            spans[run.file].push_back(s);
+        }
+    }
+}
+
+/**
+ * Every file's spans are merged into cells, through a temporary file.
+ */
+bool areaIndexWrite(const string &path, const vector<AreaFile> &files,
+                    const vector<vector<AreaSpan> > &spans)
+{
+    struct Ref {
+        uint64_t key;
+        AreaRun run;
+    };
+    vector<Ref> refs;
+    for (size_t f = 0; f < files.size(); f++) {
+        for (size_t i = 0; i < spans[f].size(); i++) {
+            Ref r;
+            r.key = spans[f][i].key;
+            r.run.file = (uint32_t)f;
+            r.run.block = spans[f][i].block;
+            r.run.count = spans[f][i].count;
+            refs.push_back(r);
+        }
+    }
+    sort(refs.begin(), refs.end(), [](const Ref &a, const Ref &b) {
+        return a.key != b.key ? a.key < b.key : runLess(a.run, b.run);
+    });
+
+    vector<AreaCell> cells;
+    vector<AreaRun> runs(refs.size());
+    for (size_t i = 0; i < refs.size(); i++) {
+        if (cells.empty() || cells.back().key != refs[i].key) {
+            AreaCell c;
+            c.key = refs[i].key;
+            c.first = (uint32_t)i;
+            c.count = 0;
+            cells.push_back(c);
+        }
+        cells.back().count += 1;
+        runs[i] = refs[i].run;
+    }
+
+    AreaHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, AREA_MAGIC, 4);
+    h.version = AREA_VERSION;
+    h.maxLevel = AREA_MAX_LEVEL;
+    h.files = (uint32_t)files.size();
+    h.cells = (uint32_t)cells.size();
+    h.runs = (uint32_t)runs.size();
+
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (f == NULL)
+        return false;
+    fwrite(&h, sizeof(h), 1, f);
+    if (!files.empty())
+        fwrite(&files[0], sizeof(AreaFile), files.size(), f);
+    if (!cells.empty())
+        fwrite(&cells[0], sizeof(AreaCell), cells.size(), f);
+    if (!runs.empty())
+        fwrite(&runs[0], sizeof(AreaRun), runs.size(), f);
+    if (fclose(f) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return replaceFile(tmp, path);
+}
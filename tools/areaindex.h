@@ -0,0 +1,114 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef AREAINDEX_H
+#define AREAINDEX_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "../include/blockindex.h"
+
+/*
+ * Spatial index over the blocks of every GPX track in a folder,
+ * DataLog-area.dla, built from the tracks' .idx sidecars by
+ * tools/dl_area and memory mapped to query it. Host (little endian)
+ * byte order.
+ *
+ *      char[4]     "DLA1"
+ *      u16         format version
+ *      u16         deepest level, AREA_MAX_LEVEL
+ *      u32         files, cells, runs
+ *      AreaFile    files, sorted by name
+ *      AreaCell    cells, sorted by key
+ *      AreaRun     runs, each cell's sorted by file and block
+ *
+ * The world is a quadtree on lat/lon, level l has 2^l x 2^l cells and
+ * a key is the level above the cell's Morton code. A block goes in the
+ * deepest level where its bounding box spans at most 2 x 2 cells, so a
+ * query looks up the few cells it overlaps on each level. Adjacent
+ * blocks of a track in the same cell share a run.
+ */
+#define AREA_FILE "DataLog-area.dla"
+#define AREA_MAGIC "DLA1"
+#define AREA_VERSION (1)
+#define AREA_MAX_LEVEL (16)     // ~600 x 300 m at the equator
+#define AREA_NAME_SIZE (64)
+
+// file flags
+#define AREA_TRAFFIC (0x01)     // a multiplayer plane's track
+
+struct AreaHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t maxLevel;
+    uint32_t files;
+    uint32_t cells;
+    uint32_t runs;
+    uint32_t reserved;
+};
+
+/**
+ * A track, its .idx's size and time tell a rescan whether it changed.
+ */
+struct AreaFile {
+    char name[AREA_NAME_SIZE];  // the GPX track, NUL terminated
+    uint64_t idxSize;
+    int64_t idxMtime;
+    uint32_t blocks;
+    uint32_t flags;
+};
+
+struct AreaCell {
+    uint64_t key;
+    uint32_t first;             // into the runs
+    uint32_t count;
+};
+
+struct AreaRun {
+    uint32_t file;
+    uint32_t block;
+    uint32_t count;
+};
+
+/**
+ * A run of a track's blocks in a cell, while building.
+ */
+struct AreaSpan {
+    uint64_t key;
+    uint32_t block;
+    uint32_t count;
+};
+
+struct AreaIndex {
+    void* map;
+    size_t size;
+    const AreaHeader* hdr;
+    const AreaFile* files;
+    const AreaCell* cells;
+    const AreaRun* runs;
+};
+
+// maps the index, false if there's none or it's from another version
+bool areaIndexOpen(AreaIndex &a, const std::string &path);
+void areaIndexClose(AreaIndex &a);
+
+// the runs of blocks in the cells that overlap the box, merged and
+// sorted by file and block; a run's blocks may still lie outside it
+void areaIndexQuery(const AreaIndex &a, double south, double west,
+                    double north, double east, std::vector<AreaRun> &out);
+
+// a track's spans, from its blocks
+void areaIndexSpans(const std::vector<IndexEntry> &blocks,
+                    std::vector<AreaSpan> &spans);
+
+// every file's spans of an open index, spans[i] are file i's
+void areaIndexFileSpans(const AreaIndex &a, std::vector<std::vector<AreaSpan> > &spans);
+
+// writes the index, spans[i] are files[i]'s, replacing path
+bool areaIndexWrite(const std::string &path, const std::vector<AreaFile> &files,
+                    const std::vector<std::vector<AreaSpan> > &spans);
+
+#endif /* AREAINDEX_H */
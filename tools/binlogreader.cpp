@@ -0,0 +1,168 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <cstring>
+
+#include "./binlogreader.h"
+
+using namespace std;
+
+// bitmap, wall, cycle, elapsed, flags and every channel as a double
+#define RECORD_FIXED_SIZE (4 + 4 + 4 + 1)
+#define MAX_RECORD_SIZE (BINLOG_BITMAP_SIZE(BINLOG_READER_MAX_CHANNELS) + RECORD_FIXED_SIZE + \
+                         BINLOG_READER_MAX_CHANNELS * 8)
+
+template <typename T>
+static inline const char* get(const char* p, T &v)
+{
+    memcpy(&v, p, sizeof(v));
+    return p + sizeof(v);
+}
+
+/**
+ * Keeps at least n bytes at buf[pos], false at the end of the file.
+ */
+static bool fill(BinlogReader &r, size_t n)
+{
+    if (r.len - r.pos >= n)
+        return true;
+    memmove(&r.buf[0], &r.buf[r.pos], r.len - r.pos);
+    r.len -= r.pos;
+    r.pos = 0;
+    while (!r.eof && r.len < n) {
+        size_t got = fread(&r.buf[r.len], 1, r.buf.size() - r.len, r.f);
+        if (got == 0)
+            r.eof = true;
+        r.len += got;
+    }
+    return r.len >= n;
+}
+
+/**
+ *
+ */
+static bool readHeader(BinlogReader &r)
+{
+    uint16_t version, count;
+    if (!fill(r, 8) || memcmp(&r.buf[0], BINLOG_MAGIC, 4) != 0)
+        return false;
+    get(&r.buf[4], version);
+    get(&r.buf[6], count);
+    if (version != BINLOG_VERSION || count > BINLOG_READER_MAX_CHANNELS)
+        return false;
+    r.pos += 8;
+    r.offset += 8;
+
+    for (int i = 0; i < count; i++) {
+        if (!fill(r, 3))
+            return false;
+        size_t len = (uint8_t)r.buf[r.pos + 2];
+        if (!fill(r, 3 + len + 8))
+            return false;
+        const char* p = &r.buf[r.pos];
+        BinlogChannel c;
+        c.group = (uint8_t)p[0];
+        c.isDouble = p[1] == 'd';
+        c.name.assign(p + 3, len);
+        p = get(p + 3 + len, c.deadAbs);
+        get(p, c.deadRel);
+        r.channels.push_back(c);
+        r.pos += 3 + len + 8;
+        r.offset += 3 + len + 8;
+    }
+    return true;
+}
+
+/**
+ * Opens the log and reads its header.
+ */
+bool binlogReaderOpen(BinlogReader &r, const string &path)
+{
+    r.f = fopen(path.c_str(), "rb");
+    if (r.f == NULL)
+        return false;
+    r.buf.resize(BINLOG_READER_BUFFER);
+    r.pos = r.len = 0;
+    r.eof = false;
+    r.offset = 0;
+    r.channels.clear();
+    memset(&r.rec, 0, sizeof(r.rec));
+    if (!readHeader(r)) {
+        binlogReaderClose(r);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the next record into r.rec.
+ */
+int binlogReaderNext(BinlogReader &r)
+{
+    int count = (int)r.channels.size();
+    size_t bitmap = BINLOG_BITMAP_SIZE(count);
+    fill(r, MAX_RECORD_SIZE);
+    if (r.pos == r.len)
+        return BINLOG_READ_END;
+    if (r.len - r.pos < bitmap + RECORD_FIXED_SIZE)
+        return BINLOG_READ_TRUNCATED;
+
+    const char* start = &r.buf[r.pos];
+    const char* end = &r.buf[0] + r.len;
+    uint64_t present = 0;
+    for (size_t b = 0; b < bitmap; b++)
+        present |= (uint64_t)(uint8_t)start[b] << (b * 8);
+    size_t size = bitmap + RECORD_FIXED_SIZE;
+    for (int i = 0; i < count; i++) {
+        if (present & ((uint64_t)1 << i))
+            size += r.channels[i].isDouble ? 8 : 4;
+    }
+    if ((size_t)(end - start) < size)
+        return BINLOG_READ_TRUNCATED;
+
+    BinlogRecord &rec = r.rec;
+    const char* p = get(start + bitmap, rec.wallTime);
+    p = get(p, rec.cycle);
+    p = get(p, rec.elapsed);
+    p = get(p, rec.flags);
+    for (int i = 0; i < count; i++) {
+        if (!(present & ((uint64_t)1 << i)))
+            continue;
+        if (r.channels[i].isDouble) {
+            p = get(p, rec.ch[i]);
+        } else {
+            float f;
+            p = get(p, f);
+            rec.ch[i] = f;
+        }
+    }
+    rec.present = present;
+    rec.seen |= present;
+    r.pos += size;
+    r.offset += size;
+    return BINLOG_READ_OK;
+}
+
+/**
+ *
+ */
+void binlogReaderClose(BinlogReader &r)
+{
+    if (r.f != NULL)
+        fclose(r.f);
+    r.f = NULL;
+    r.buf.clear();
+}
+
+/**
+ *
+ */
+int binlogReaderChannel(const BinlogReader &r, const char* name)
+{
+    for (size_t i = 0; i < r.channels.size(); i++) {
+        if (r.channels[i].name == name)
+            return (int)i;
+    }
+    return -1;
+}
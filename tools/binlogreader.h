@@ -0,0 +1,65 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef BINLOGREADER_H
+#define BINLOGREADER_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../include/binlog.h"
+
+/*
+ * Streaming reader of the binary session log, see include/binlog.h.
+ * The file is read through a fixed buffer, memory use doesn't grow with
+ * the file, and each record comes with the last value of every channel.
+ */
+#define BINLOG_READER_BUFFER (1 << 20)
+#define BINLOG_READER_MAX_CHANNELS (64)
+
+enum {
+    BINLOG_READ_OK = 0
+    ,BINLOG_READ_END
+    ,BINLOG_READ_TRUNCATED      // a partial last record, e.g. a sim crash
+};
+
+struct BinlogChannel {
+    std::string name;
+    int group;
+    bool isDouble;
+    float deadAbs;
+    float deadRel;
+};
+
+struct BinlogRecord {
+    uint64_t present;           // channels in this record
+    uint64_t seen;              // channels written so far
+    uint32_t wallTime;
+    uint32_t cycle;
+    float elapsed;
+    uint8_t flags;              // BINLOG_NEW_SEGMENT
+    double ch[BINLOG_READER_MAX_CHANNELS];  // last value of each channel
+};
+
+struct BinlogReader {
+    FILE* f;
+    std::vector<BinlogChannel> channels;
+    std::vector<char> buf;
+    size_t pos;
+    size_t len;
+    bool eof;
+    uint64_t offset;            // file offset of buf[pos]
+    BinlogRecord rec;
+};
+
+bool binlogReaderOpen(BinlogReader &r, const std::string &path);
+int binlogReaderNext(BinlogReader &r);
+void binlogReaderClose(BinlogReader &r);
+
+// the channel's index or -1
+int binlogReaderChannel(const BinlogReader &r, const char* name);
+
+#endif /* BINLOGREADER_H */
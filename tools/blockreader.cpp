@@ -0,0 +1,114 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <fstream>
+#include <cstring>
+
+#include "./blockreader.h"
+
+using namespace std;
+
+static bool readRange(const string &path, uint64_t off, uint64_t len,
+                      string &out);
+
+/**
+ * Loads the whole index, a partial entry at the end is still being
+ * written and is left for the next open.
+ */
+bool blockReaderOpen(BlockReader &r, const string &data)
+{
+    r.data = data;
+    r.blocks.clear();
+    ifstream fd(data + ".idx", ifstream::binary);
+    if (!fd.is_open())
+        return false;
+
+    char hdr[INDEX_HEADER_SIZE];
+    uint16_t version, size;
+    if (!fd.read(hdr, sizeof(hdr)) || memcmp(hdr, INDEX_MAGIC, 4) != 0)
+        return false;
+    memcpy(&version, hdr + 4, sizeof(version));
+    memcpy(&size, hdr + 6, sizeof(size));
+    if (version != INDEX_VERSION || size != sizeof(IndexEntry))
+        return false;
+
+    IndexEntry e;
+    while (fd.read((char*)&e, sizeof(e)))
+        r.blocks.push_back(e);
+    return true;
+}
+
+/**
+ * Blocks are in time order, a binary search on each block's last time.
+ */
+size_t blockReaderFind(const BlockReader &r, uint32_t wall)
+{
+    size_t lo = 0;
+    size_t hi = r.blocks.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r.blocks[mid].wallLast < wall)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ *
+ */
+bool blockReaderRead(const BlockReader &r, size_t first, size_t last,
+                     string &out)
+{
+    if (first > last || last >= r.blocks.size())
+        return false;
+    uint64_t off = r.blocks[first].offset;
+    uint64_t end = r.blocks[last].offset + r.blocks[last].length;
+    return readRange(r.data, off, end - off, out);
+}
+
+/**
+ *
+ */
+bool blockReaderHeader(const BlockReader &r, string &out)
+{
+    if (r.blocks.empty())
+        return false;
+    return readRange(r.data, 0, r.blocks[0].offset, out);
+}
+
+/**
+ *
+ */
+bool blockReaderTail(const BlockReader &r, string &out)
+{
+    ifstream fd(r.data, ifstream::binary | ifstream::ate);
+    if (!fd.is_open())
+        return false;
+    uint64_t size = (uint64_t)fd.tellg();
+    uint64_t end = 0;
+    if (!r.blocks.empty())
+        end = r.blocks.back().offset + r.blocks.back().length;
+    if (size < end)
+        return false;
+    return readRange(r.data, end, size - end, out);
+}
+
+/**
+ *
+ */
+bool readRange(const string &path, uint64_t off, uint64_t len, string &out)
+{
+    ifstream fd(path, ifstream::binary);
+    if (!fd.is_open() || !fd.seekg((streamoff)off))
+        return false;
+    size_t n = out.size();
+    out.resize(n + len);
+    if (len > 0 && !fd.read(&out[n], (streamsize)len)) {
+        out.resize(n);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "../include/blockindex.h"
+
+/*
+ * Random access into a GPX track or binary log through its .idx sidecar,
+ * only the blocks asked for are read from the data file. Works on a
+ * session still being written, blockReaderOpen again picks up the blocks
+ * added since.
+ */
+
+struct BlockReader {
+    std::string data;                   // the data file
+    std::vector<IndexEntry> blocks;
+};
+
+// reads data + ".idx", false without a usable index
+bool blockReaderOpen(BlockReader &r, const std::string &data);
+
+// the first block ending at or after the unix time, blocks.size() if none
+size_t blockReaderFind(const BlockReader &r, uint32_t wall);
+
+// appends the data file's bytes of blocks [first, last]
+bool blockReaderRead(const BlockReader &r, size_t first, size_t last,
+                     std::string &out);
+
+// appends the bytes before the first block, the file's header
+bool blockReaderHeader(const BlockReader &r, std::string &out);
+
+// appends the bytes after the last block: the records not indexed yet,
+// or the GPX epilog of a closed file
+bool blockReaderTail(const BlockReader &r, std::string &out);
+
+#endif /* BLOCKREADER_H */
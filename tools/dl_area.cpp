@@ -0,0 +1,338 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Finds where the tracks in a folder pass through an area, e.g. every
+// approach into an airport, through a spatial index of the tracks'
+// blocks, DataLog-area.dla (see tools/areaindex.h). Each run first
+// brings the index up to date, only the tracks whose .idx changed are
+// read again, on every core. A query looks up the area's cells in the
+// mapped index, checks the candidate blocks against their .idx entries
+// and lists each run of matching blocks; -o writes them to one GPX file,
+// a track segment per run, reading only those blocks. Whole blocks are
+// returned, so a segment can start and end up to a block outside the
+// area. -p is a box of the given half width around a point.
+//
+//  $ ./tools/dl_area [-j threads] [-n] [-a] [-o out.gpx]
+//                    (-b south,west,north,east | -p lat,lon,km) <dir>
+//
+// -n queries the index as it is, -a includes multiplayer planes.
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/gpxformat.h"
+#include "./areaindex.h"
+#include "./blockreader.h"
+#include "./toolutil.h"
+
+using namespace std;
+
+#define KM_PER_DEG_LAT (111.32)
+
+static string gDir;
+static vector<AreaFile> gFiles;
+static vector<vector<AreaSpan> > gSpans;
+static vector<size_t> gJobs;
+static atomic<size_t> gNext(0);
+static atomic<uint64_t> gBlocks(0);
+
+static bool fileLess(const AreaFile &a, const AreaFile &b)
+{
+    return strcmp(a.name, b.name) < 0;
+}
+
+static double since(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+static void workerLoop(void)
+{
+    size_t i;
+    while ((i = gNext.fetch_add(1)) < gJobs.size()) {
+        size_t f = gJobs[i];
+        BlockReader r;
+        if (!blockReaderOpen(r, gDir + gFiles[f].name))
+            r.blocks.clear();
+        areaIndexSpans(r.blocks, gSpans[f]);
+        gFiles[f].blocks = (uint32_t)r.blocks.size();
+        gBlocks.fetch_add(r.blocks.size());
+    }
+}
+
+/**
+ * Stats every track's .idx, the spans of the unchanged ones are taken
+ * from the old index.
+ */
+static bool update(int threads)
+{
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    string path = gDir + AREA_FILE;
+    AreaIndex old;
+    vector<AreaFile> oldFiles;
+    vector<vector<AreaSpan> > oldSpans;
+    bool had = areaIndexOpen(old, path);
+    if (had) {
+        oldFiles.assign(old.files, old.files + old.hdr->files);
+        areaIndexFileSpans(old, oldSpans);
+        areaIndexClose(old);
+    }
+
+    DIR* d = opendir(gDir.c_str());
+    if (d == NULL) {
+        perror(gDir.c_str());
+        return false;
+    }
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        string name = de->d_name;
+        if (name.compare(0, 8, "DataLog-") != 0 || !hasSuffix(name, ".gpx.idx"))
+            continue;
+        name.resize(name.size() - 4);
+        if (name.size() >= AREA_NAME_SIZE)
+            continue;
+        struct stat st;
+        if (stat((gDir + name + ".idx").c_str(), &st) != 0)
+            continue;
+        AreaFile f;
+        memset(&f, 0, sizeof(f));
+        memcpy(f.name, name.c_str(), name.size());
+        f.idxSize = (uint64_t)st.st_size;
+        f.idxMtime = (int64_t)st.st_mtime;
+        if (name.find("-AI") != string::npos)
+            f.flags |= AREA_TRAFFIC;
+        gFiles.push_back(f);
+    }
+    closedir(d);
+    sort(gFiles.begin(), gFiles.end(), fileLess);
+
+    gSpans.assign(gFiles.size(), vector<AreaSpan>());
+    size_t known = 0;
+    for (size_t i = 0; i < gFiles.size(); i++) {
+        vector<AreaFile>::iterator it =
+            lower_bound(oldFiles.begin(), oldFiles.end(), gFiles[i], fileLess);
+        if (it != oldFiles.end() && strcmp(it->name, gFiles[i].name) == 0) {
+            known += 1;
+            if (it->idxSize == gFiles[i].idxSize && it->idxMtime == gFiles[i].idxMtime) {
+                gFiles[i].blocks = it->blocks;
+                gSpans[i].swap(oldSpans[it - oldFiles.begin()]);
+                continue;
+            }
+        }
+        gJobs.push_back(i);
+    }
+    size_t removed = oldFiles.size() - known;
+
+    vector<thread> pool;
+    for (int k = 0; k < threads && (size_t)k < gJobs.size(); k++)
+        pool.push_back(thread(workerLoop));
+    for (size_t k = 0; k < pool.size(); k++)
+        pool[k].join();
+
+    if ((!had || !gJobs.empty() || removed > 0) && !areaIndexWrite(path, gFiles, gSpans)) {
+        fprintf(stderr, "unable to write %s\n", path.c_str());
+        return false;
+    }
+    fprintf(stderr, "indexed %zu tracks in %.1f ms on %d threads: %zu new or "
+                    "changed (%llu blocks read), %zu removed\n",
+            gFiles.size(), since(t0) * 1e3, threads, gJobs.size(),
+            (unsigned long long)gBlocks.load(), removed);
+    gFiles.clear();
+    gSpans.clear();
+    return true;
+}
+
+/**
+ * A run of adjacent matching blocks of a track.
+ */
+struct Segment {
+    uint32_t file;
+    uint32_t first;
+    uint32_t last;
+    uint32_t wallFirst;
+    uint32_t wallLast;
+    uint32_t points;
+};
+
+/**
+ * Entries [first, first + count) of an open .idx, fewer past its end.
+ */
+static void readEntries(FILE* f, uint32_t first, uint32_t count,
+                        vector<IndexEntry> &out)
+{
+    out.resize(count);
+    long off = INDEX_HEADER_SIZE + (long)first * (long)sizeof(IndexEntry);
+    size_t got = 0;
+    if (fseek(f, off, SEEK_SET) == 0)
+        got = fread(&out[0], sizeof(IndexEntry), count, f);
+    out.resize(got);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dl_area [-j threads] [-n] [-a] [-o out.gpx]\n"
+                    "               (-b south,west,north,east | -p lat,lon,km) <dir>\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = (int)thread::hardware_concurrency();
+    bool scan = true;
+    bool traffic = false;
+    bool area = false;
+    string out;
+    double south = 0, west = 0, north = 0, east = 0;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        string opt = argv[i];
+        if (opt == "-n") {
+            scan = false;
+        } else if (opt == "-a") {
+            traffic = true;
+        } else if (i + 1 == argc) {
+            usage();
+        } else if (opt == "-j") {
+            threads = atoi(argv[++i]);
+        } else if (opt == "-o") {
+            out = argv[++i];
+        } else if (opt == "-b") {
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &south, &west, &north, &east) != 4)
+                usage();
+            area = true;
+        } else if (opt == "-p") {
+            double lat, lon, km;
+            if (sscanf(argv[++i], "%lf,%lf,%lf", &lat, &lon, &km) != 3)
+                usage();
+            double dlat = km / KM_PER_DEG_LAT;
+            double dlon = dlat / max(cos(lat * DEG_TO_RAD), 0.01);
+            south = lat - dlat;
+            north = lat + dlat;
+            west = lon - dlon;
+            east = lon + dlon;
+            area = true;
+        } else {
+            usage();
+        }
+    }
+    if (argc - i != 1 || !area)
+        usage();
+    if (threads < 1)
+        threads = 1;
+    gDir = argv[i];
+    if (!gDir.empty() && gDir[gDir.size() - 1] != '/')
+        gDir += "/";
+
+    if (scan && !update(threads))
+        return 1;
+    AreaIndex a;
+    if (!areaIndexOpen(a, gDir + AREA_FILE)) {
+        fprintf(stderr, "no area index in %s, run without -n\n", gDir.c_str());
+        return 1;
+    }
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    vector<AreaRun> runs;
+    areaIndexQuery(a, south, west, north, east, runs);
+    double lookup = since(t0);
+
+    // the candidates' own bounds, only their entries of each track's
+    // .idx are read
+    vector<Segment> segs;
+    vector<IndexEntry> entries;
+    size_t candidates = 0;
+    FILE* idx = NULL;
+    uint32_t open = UINT32_MAX;
+    for (size_t k = 0; k < runs.size(); k++) {
+        const AreaRun &run = runs[k];
+        if ((a.files[run.file].flags & AREA_TRAFFIC) && !traffic)
+            continue;
+        if (run.file != open) {
+            if (idx != NULL)
+                fclose(idx);
+            open = run.file;
+            idx = fopen((gDir + a.files[run.file].name + ".idx").c_str(), "rb");
+        }
+        if (idx == NULL)
+            continue;
+        readEntries(idx, run.block, run.count, entries);
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            const IndexEntry &e = entries[i];
+            uint32_t b = run.block + i;
+            candidates += 1;
+            if (!blockIndexOverlaps(e, south, west, north, east))
+                continue;
+            if (!segs.empty() && segs.back().file == run.file && segs.back().last + 1 == b) {
+                segs.back().last = b;
+                segs.back().wallLast = e.wallLast;
+                segs.back().points += e.count;
+                continue;
+            }
+            Segment s;
+            s.file = run.file;
+            s.first = s.last = b;
+            s.wallFirst = e.wallFirst;
+            s.wallLast = e.wallLast;
+            s.points = e.count;
+            segs.push_back(s);
+        }
+    }
+    if (idx != NULL)
+        fclose(idx);
+    double query = since(t0);
+
+    uint64_t points = 0;
+    for (size_t k = 0; k < segs.size(); k++) {
+        const Segment &s = segs[k];
+        points += s.points;
+        uint32_t secs = s.wallLast - s.wallFirst;
+        string t = gpxDateTime((time_t)s.wallFirst, false);
+        printf("%s  blocks %u-%u  %s  %u:%02u:%02u  %u points\n", a.files[s.file].name,
+               s.first, s.last, t.c_str(), secs / 3600, secs / 60 % 60, secs % 60,
+               s.points);
+    }
+
+    int ret = 0;
+    if (!out.empty()) {
+        // the blocks hold whole lines, a segment break between the runs
+        string gpx = gpxProlog(gpxDateTime(time(0), false));
+        BlockReader r;
+        for (size_t k = 0; k < segs.size(); k++) {
+            if (k > 0)
+                gpx += GPX_SEGMENT_BREAK;
+            string data = gDir + a.files[segs[k].file].name;
+            if (r.data != data)
+                blockReaderOpen(r, data);
+            if (!blockReaderRead(r, segs[k].first, segs[k].last, gpx)) {
+                fprintf(stderr, "unable to read %s\n", a.files[segs[k].file].name);
+                ret = 1;
+            }
+        }
+        gpx += GPX_EPILOG;
+        FILE* f = fopen(out.c_str(), "wb");
+        if (f == NULL || fwrite(gpx.data(), 1, gpx.size(), f) != gpx.size()) {
+            perror(out.c_str());
+            ret = 1;
+        }
+        if (f != NULL)
+            fclose(f);
+    }
+    fprintf(stderr, "%zu segments, %llu points, from %zu candidate blocks of %u "
+                    "tracks: cells %.2f ms, blocks %.2f ms, total %.2f ms\n",
+            segs.size(), (unsigned long long)points, candidates, a.hdr->files,
+            lookup * 1e3, query * 1e3, since(t0) * 1e3);
+    areaIndexClose(a);
+    return ret;
+}
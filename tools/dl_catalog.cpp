@@ -0,0 +1,339 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Keeps the output directory's flight catalog, DataLog-catalog.dlc (see
+// include/catalog.h), up to date and queries it. A rescan only stats the
+// directory; a track that's new or whose size or modification time
+// changed is summarized again on every core, from its .json sidecar when
+// that's complete and covers the whole file, else by reading the track.
+// The sessions whose track overlaps the area and time window are listed,
+// times are unix seconds or YYYY-MM-DD[THH:MM:SS], either end can be
+// left out, -d is the last n days.
+//
+//  $ ./tools/dl_catalog [-j threads] [-n] [-a] [-b south,west,north,east]
+//                       [-t from,to] [-d days] <dir>
+//
+// -n queries the catalog as it is, -a lists multiplayer planes too.
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/catalog.h"
+#include "../include/crc32.h"
+#include "./gpxreader.h"
+#include "./toolutil.h"
+
+using namespace std;
+
+struct Query {
+    bool bbox;
+    double south;
+    double west;
+    double north;
+    double east;
+    int64_t from;
+    int64_t to;
+    bool traffic;
+};
+
+static string gDir;
+static vector<CatalogEntry> gJobs;
+static atomic<size_t> gNext(0);
+static atomic<uint64_t> gFromSidecar(0);
+static atomic<uint64_t> gBytesRead(0);
+
+static bool readFile(const string &path, string &s)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+    char buf[4096];
+    size_t n;
+    s.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        s.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+/**
+ * From the sidecar if it's the closed file's, nothing else is read.
+ */
+static bool fromSidecar(CatalogEntry &e, const string &path)
+{
+    string json;
+    uint64_t size;
+    uint32_t crc;
+    bool complete;
+    if (!readFile(path + SUMMARY_SUFFIX, json) ||
+        !summaryParse(json, e.summary, size, crc, complete) ||
+        !complete || size != e.size)
+        return false;
+    e.crc = crc;
+    e.flags |= CATALOG_COMPLETE;
+    return true;
+}
+
+/**
+ * A track being read by fromTrack.
+ */
+struct TrackScan {
+    CatalogEntry* e;
+    string last;                // the file's last bytes
+    uint64_t total;
+};
+
+static void scanChunk(void* ctx, const char* data, size_t n, const GpxPoints &pts)
+{
+    TrackScan &t = *(TrackScan*)ctx;
+    const size_t tail = sizeof(GPX_EPILOG) - 1;
+    t.e->crc = crc32Update(t.e->crc, data, n);
+    t.last.append(data, n);
+    if (t.last.size() > tail)
+        t.last.erase(0, t.last.size() - tail);
+    t.total += n;
+
+    size_t s = 0;
+    for (size_t k = 0; k < pts.lat.size(); k++) {
+        bool first = s < pts.segments.size() && pts.segments[s] == k;
+        if (first)
+            s += 1;
+        summaryAdd(t.e->summary, (uint32_t)pts.time[k], 0.0f, pts.lat[k],
+                   pts.lon[k], pts.ele[k], first);
+    }
+}
+
+/**
+ * Reads the track a chunk at a time, its points are summarized the way
+ * the writer does and the bytes checksummed on the way through. A track
+ * is complete if it ends with the epilog.
+ */
+static bool fromTrack(CatalogEntry &e, const string &path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+    TrackScan t;
+    t.e = &e;
+    t.total = 0;
+    summaryReset(e.summary);
+    e.crc = 0;
+    gpxStream(f, scanChunk, &t);
+    fclose(f);
+    gBytesRead.fetch_add(t.total);
+    e.size = t.total;
+    if (t.last == GPX_EPILOG)
+        e.flags |= CATALOG_COMPLETE;
+    return true;
+}
+
+static void workerLoop(void)
+{
+    size_t i;
+    while ((i = gNext.fetch_add(1)) < gJobs.size()) {
+        CatalogEntry &e = gJobs[i];
+        string path = gDir + e.name;
+        if (fromSidecar(e, path))
+            gFromSidecar.fetch_add(1);
+        else if (!fromTrack(e, path))
+            e.name[0] = '\0';   // gone since the scan
+    }
+}
+
+/**
+ * Brings the catalog up to date with the directory, returns false if
+ * the directory can't be read.
+ */
+static bool rescan(vector<CatalogEntry> &entries, int threads)
+{
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    DIR* d = opendir(gDir.c_str());
+    if (d == NULL) {
+        perror(gDir.c_str());
+        return false;
+    }
+    vector<string> names;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        string name = de->d_name;
+        if (name.compare(0, 8, "DataLog-") == 0 && hasSuffix(name, ".gpx") &&
+            name.size() < CATALOG_NAME_SIZE)
+            names.push_back(name);
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+
+    // both lists are sorted by name
+    vector<CatalogEntry> keep;
+    size_t old = 0;
+    size_t removed = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        CatalogEntry e;
+        memset(&e, 0, sizeof(e));
+        memcpy(e.name, names[i].c_str(), names[i].size());
+        if (!catalogStat(gDir + names[i], e.size, e.mtime))
+            continue;
+        while (old < entries.size() && strcmp(entries[old].name, e.name) < 0) {
+            old += 1;
+            removed += 1;
+        }
+        if (old < entries.size() && strcmp(entries[old].name, e.name) == 0) {
+            const CatalogEntry &c = entries[old++];
+            if (c.size == e.size && c.mtime == e.mtime) {
+                keep.push_back(c);
+                continue;
+            }
+        }
+        if (names[i].find("-AI") != string::npos)
+            e.flags |= CATALOG_TRAFFIC;
+        gJobs.push_back(e);
+    }
+    removed += entries.size() - old;
+
+    if (!gJobs.empty()) {
+        vector<thread> pool;
+        for (int k = 0; k < threads; k++)
+            pool.push_back(thread(workerLoop));
+        for (size_t k = 0; k < pool.size(); k++)
+            pool[k].join();
+    }
+    size_t changed = 0;
+    for (size_t i = 0; i < gJobs.size(); i++) {
+        if (gJobs[i].name[0] != '\0') {
+            keep.push_back(gJobs[i]);
+            changed += 1;
+        }
+    }
+    if (changed > 0 || removed > 0) {
+        sort(keep.begin(), keep.end(), catalogLess);
+        if (!catalogSave(gDir + CATALOG_FILE, keep))
+            fprintf(stderr, "unable to write %s%s\n", gDir.c_str(), CATALOG_FILE);
+    }
+    entries.swap(keep);
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    fprintf(stderr, "rescanned %zu tracks in %.1f ms on %d threads: %zu new or "
+                    "changed (%llu from sidecars, %.1f MB read), %zu removed\n",
+            entries.size(), secs * 1e3, threads, changed,
+            (unsigned long long)gFromSidecar.load(), gBytesRead.load() / 1e6,
+            removed);
+    return true;
+}
+
+static bool matches(const CatalogEntry &e, const Query &q)
+{
+    const SessionSummary &m = e.summary;
+    if ((e.flags & CATALOG_TRAFFIC) && !q.traffic)
+        return false;
+    if (m.points == 0)
+        return !q.bbox && q.from == 0 && q.to == 0;
+    if (q.bbox && !(m.minLat <= q.north && m.maxLat >= q.south &&
+                    m.minLon <= q.east && m.maxLon >= q.west))
+        return false;
+    if (q.from != 0 && (int64_t)m.wallLast < q.from)
+        return false;
+    if (q.to != 0 && (int64_t)m.wallFirst > q.to)
+        return false;
+    return true;
+}
+
+static void print(const CatalogEntry &e)
+{
+    const SessionSummary &m = e.summary;
+    uint32_t secs = m.wallLast - m.wallFirst;
+    string t = m.points > 0 ? gpxDateTime((time_t)m.wallFirst, false) : "-";
+    printf("%s  %s  %u:%02u:%02u  %8.1f km  %8llu points  %s",
+           e.name, t.c_str(), secs / 3600, secs / 60 % 60, secs % 60,
+           m.distance / 1000.0, (unsigned long long)m.points,
+           (e.flags & CATALOG_COMPLETE) ? "" : "(incomplete)  ");
+    if (m.points > 0)
+        printf("%.5f,%.5f,%.5f,%.5f", m.minLat, m.minLon, m.maxLat, m.maxLon);
+    printf("\n");
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dl_catalog [-j threads] [-n] [-a] [-b south,west,north,east]\n"
+                    "                  [-t from,to] [-d days] <dir>\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = (int)thread::hardware_concurrency();
+    bool scan = true;
+    Query q;
+    memset(&q, 0, sizeof(q));
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        string opt = argv[i];
+        if (opt == "-n") {
+            scan = false;
+        } else if (opt == "-a") {
+            q.traffic = true;
+        } else if (i + 1 == argc) {
+            usage();
+        } else if (opt == "-j") {
+            threads = atoi(argv[++i]);
+        } else if (opt == "-b") {
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &q.south, &q.west,
+                       &q.north, &q.east) != 4)
+                usage();
+            q.bbox = true;
+        } else if (opt == "-t") {
+            string s = argv[++i];
+            size_t comma = s.find(',');
+            if (comma == string::npos)
+                usage();
+            string from = s.substr(0, comma);
+            string to = s.substr(comma + 1);
+            if ((!from.empty() && !parseTime(from.c_str(), q.from)) ||
+                (!to.empty() && !parseTime(to.c_str(), q.to)))
+                usage();
+        } else if (opt == "-d") {
+            q.from = (int64_t)time(0) - (int64_t)atoi(argv[++i]) * 86400;
+        } else {
+            usage();
+        }
+    }
+    if (argc - i != 1)
+        usage();
+    if (threads < 1)
+        threads = 1;
+
+    gDir = argv[i];
+    if (!gDir.empty() && gDir[gDir.size() - 1] != '/')
+        gDir += "/";
+
+    vector<CatalogEntry> entries;
+    if (!catalogLoad(gDir + CATALOG_FILE, entries) && !scan) {
+        fprintf(stderr, "no catalog in %s, run without -n\n", gDir.c_str());
+        return 1;
+    }
+    if (scan && !rescan(entries, threads))
+        return 1;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    vector<size_t> found;
+    for (size_t k = 0; k < entries.size(); k++) {
+        if (matches(entries[k], q))
+            found.push_back(k);
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    for (size_t k = 0; k < found.size(); k++)
+        print(entries[found[k]]);
+    fprintf(stderr, "%zu of %zu tracks match, %.2f ms\n", found.size(),
+            entries.size(), secs * 1e3);
+    return 0;
+}
@@ -0,0 +1,490 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Converts a directory of DataLogger session files to GPX, KML or CSV
+// on every core. Each binary log, and each GPX track without one, is
+// streamed through a fixed buffer into <out-dir>/<name>.<format>; a GPX
+// track from a binary log is formatted by the plugin's own code and
+// breaks its segments where the live track did, so it's byte for byte
+// the track logged live with the default deadbands. Files
+// are dealt out to per-thread queues and idle threads steal from the
+// others, files/s and MB/s are reported as it runs.
+//
+//  $ ./tools/dl_convert [-j threads] [-f gpx|kml|csv] <in-dir> <out-dir>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/gpxformat.h"
+#include "./binlogreader.h"
+#include "./gpxreader.h"
+#include "./toolutil.h"
+
+using namespace std;
+
+enum {
+    FMT_GPX = 0
+    ,FMT_KML
+    ,FMT_CSV
+    ,NUM_FORMATS
+};
+
+static const char* gFormatNames[NUM_FORMATS] = {
+    "gpx"
+    ,"kml"
+    ,"csv"
+};
+
+#define OUT_BUFFER (1 << 20)
+
+struct Job {
+    string in;
+    string out;
+    uint64_t size;
+    bool binlog;
+};
+
+/**
+ * A file being written. lat..elapsed and points follow the writer's
+ * GpxTrack so a binary log turns into the same points and segments.
+ */
+struct Output {
+    FILE* f;
+    int format;
+    double lat;
+    double lon;
+    double alt;
+    float elapsed;
+    int points;                 // in the current segment
+    bool any;                   // a point was written
+    time_t wall;
+    string t;                   // wall, formatted once a second
+};
+
+struct Worker {
+    mutex m;
+    deque<size_t> q;
+};
+
+static vector<Job> gJobs;
+static vector<Worker*> gWorkers;
+static int gFormat = FMT_GPX;
+static atomic<uint64_t> gDone(0);
+static atomic<uint64_t> gFailed(0);
+static atomic<uint64_t> gBytesIn(0);
+
+/**
+ * DataLog-YYYY-MM-DDTHH-MM-SSZ... names the session start time, the
+ * GPX metadata has the same dashed form.
+ */
+static string sessionTime(const string &path)
+{
+    size_t slash = path.rfind('/');
+    string name = path.substr(slash == string::npos ? 0 : slash + 1);
+    if (name.compare(0, 8, "DataLog-") != 0 || name.size() < 28 || name[27] != 'Z')
+        return "";
+    return name.substr(8, 20);
+}
+
+static void trackBegin(Output &o, const string &t, const string &name)
+{
+    switch (o.format) {
+    case FMT_GPX:
+        fputs(gpxProlog(t).c_str(), o.f);
+        break;
+    case FMT_KML:
+        fprintf(o.f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n"
+                     "<Document><name>%s</name>\n", name.c_str());
+        break;
+    }
+    o.points = 0;
+    o.any = false;
+    o.wall = (time_t)-1;
+}
+
+static void trackBreak(Output &o)
+{
+    if (o.points == 0)
+        return;
+    switch (o.format) {
+    case FMT_GPX:
+        fputs(GPX_SEGMENT_BREAK, o.f);
+        break;
+    case FMT_KML:
+        fputs("</coordinates></LineString></Placemark>\n", o.f);
+        break;
+    }
+    o.points = 0;
+}
+
+static void trackPoint(Output &o, double lat, double lon, double alt,
+                       time_t wall)
+{
+    switch (o.format) {
+    case FMT_GPX: {
+        if (wall != o.wall) {
+            o.wall = wall;
+            o.t = gpxDateTime(wall, false);
+        }
+        char buf[GPX_POINT_SIZE];
+        fwrite(buf, 1, gpxPoint(buf, lat, lon, alt, o.t.c_str()), o.f);
+        break;
+    }
+    case FMT_KML:
+        if (o.points == 0)
+            fputs("<Placemark><LineString><altitudeMode>absolute</altitudeMode><coordinates>\n", o.f);
+        fprintf(o.f, "%f,%f,%f\n", lon, lat, alt);
+        break;
+    }
+    o.points += 1;
+}
+
+static void trackEnd(Output &o)
+{
+    switch (o.format) {
+    case FMT_GPX:
+        fputs(GPX_EPILOG, o.f);
+        break;
+    case FMT_KML:
+        if (o.points > 0)
+            fputs("</coordinates></LineString></Placemark>\n", o.f);
+        fputs("</Document>\n</kml>\n", o.f);
+        break;
+    }
+}
+
+/**
+ * The writer's writeData: repeated positions are dropped and a jump
+ * starts a new segment. The live writer only sees the position when it
+ * moved, a block's first record repeats it even after a segment break.
+ */
+static void binlogPoint(Output &o, const BinlogRecord &rec, int lat, int lon,
+                        int alt)
+{
+    double la = rec.ch[lat];
+    double lo = rec.ch[lon];
+    double al = rec.ch[alt];
+    if (o.any && la == o.lat && lo == o.lon && al == o.alt)
+        return;
+    if (o.points > 0 && gpxTeleport(o.lat, o.lon, o.elapsed, la, lo, rec.elapsed))
+        trackBreak(o);
+    o.lat = la;
+    o.lon = lo;
+    o.alt = al;
+    o.elapsed = rec.elapsed;
+    o.any = true;
+    trackPoint(o, la, lo, al, (time_t)rec.wallTime);
+}
+
+/**
+ * Every record is a CSV row, a track point is written whenever the
+ * position moved, as the GPX encoder does.
+ */
+static bool convertBinlog(const Job &job, Output &o)
+{
+    BinlogReader r;
+    if (!binlogReaderOpen(r, job.in)) {
+        fprintf(stderr, "dl_convert: %s: not a binary log\n", job.in.c_str());
+        return false;
+    }
+    int lat = binlogReaderChannel(r, "lat");
+    int lon = binlogReaderChannel(r, "lon");
+    int alt = binlogReaderChannel(r, "alt");
+    if (o.format != FMT_CSV && (lat < 0 || lon < 0 || alt < 0)) {
+        fprintf(stderr, "dl_convert: %s: no position channels\n", job.in.c_str());
+        binlogReaderClose(r);
+        return false;
+    }
+    uint64_t pos = ((uint64_t)1 << lat) | ((uint64_t)1 << lon) | ((uint64_t)1 << alt);
+
+    int st = binlogReaderNext(r);
+    string t = sessionTime(job.in);
+    if (t.empty())
+        t = gpxDateTime(st == BINLOG_READ_OK ? r.rec.wallTime : 0, true);
+
+    if (o.format == FMT_CSV) {
+        fputs("wall,cycle,elapsed", o.f);
+        for (size_t i = 0; i < r.channels.size(); i++)
+            fprintf(o.f, ",%s", r.channels[i].name.c_str());
+        fputs("\n", o.f);
+    } else {
+        trackBegin(o, t, job.in);
+    }
+
+    for (; st == BINLOG_READ_OK; st = binlogReaderNext(r)) {
+        const BinlogRecord &rec = r.rec;
+        if (o.format != FMT_CSV) {
+            if (rec.flags & BINLOG_NEW_SEGMENT)
+                trackBreak(o);
+            if ((rec.present & pos) && (rec.seen & pos) == pos)
+                binlogPoint(o, rec, lat, lon, alt);
+            continue;
+        }
+        // channels not written yet are left empty
+        fprintf(o.f, "%u,%u,%.3f", rec.wallTime, rec.cycle, rec.elapsed);
+        for (size_t i = 0; i < r.channels.size(); i++) {
+            if (rec.seen & ((uint64_t)1 << i))
+                fprintf(o.f, ",%.9g", rec.ch[i]);
+            else
+                fputs(",", o.f);
+        }
+        fputs("\n", o.f);
+    }
+    if (st == BINLOG_READ_TRUNCATED)
+        fprintf(stderr, "dl_convert: %s: partial last record\n", job.in.c_str());
+
+    if (o.format != FMT_CSV)
+        trackEnd(o);
+    binlogReaderClose(r);
+    return true;
+}
+
+/**
+ * A track being converted by convertGpx.
+ */
+struct GpxConvert {
+    Output* o;
+    bool first;
+    uint32_t segment;
+};
+
+static void convertChunk(void* ctx, const char* data, size_t n, const GpxPoints &pts)
+{
+    GpxConvert &c = *(GpxConvert*)ctx;
+    Output &o = *c.o;
+    size_t s = 0;
+    for (size_t k = 0; k < pts.lat.size(); k++) {
+        if (s < pts.segments.size() && pts.segments[s] == k) {
+            s += 1;
+            if (!c.first) {
+                c.segment += 1;
+                if (o.format != FMT_CSV)
+                    trackBreak(o);
+            }
+        }
+        c.first = false;
+        if (o.format == FMT_CSV)
+            fprintf(o.f, "%lld,%f,%f,%f,%u\n", (long long)pts.time[k],
+                    pts.lat[k], pts.lon[k], pts.ele[k], c.segment);
+        else
+            trackPoint(o, pts.lat[k], pts.lon[k], pts.ele[k], (time_t)pts.time[k]);
+    }
+    // a segment opened at the end of the chunk
+    if (s < pts.segments.size() && !c.first) {
+        c.segment += 1;
+        if (o.format != FMT_CSV)
+            trackBreak(o);
+    }
+}
+
+/**
+ * Reads the track a chunk at a time, only the points of one chunk are
+ * held.
+ */
+static bool convertGpx(const Job &job, Output &o)
+{
+    FILE* f = fopen(job.in.c_str(), "rb");
+    if (f == NULL) {
+        perror(job.in.c_str());
+        return false;
+    }
+
+    string t = sessionTime(job.in);
+    if (o.format == FMT_CSV)
+        fputs("time,lat,lon,ele,segment\n", o.f);
+    else
+        trackBegin(o, t, job.in);
+
+    GpxConvert c;
+    c.o = &o;
+    c.first = true;
+    c.segment = 0;
+    gpxStream(f, convertChunk, &c);
+    fclose(f);
+
+    if (o.format != FMT_CSV)
+        trackEnd(o);
+    return true;
+}
+
+static void convert(const Job &job)
+{
+    Output o;
+    o.format = gFormat;
+    o.f = fopen(job.out.c_str(), "wb");
+    bool ok = false;
+    if (o.f == NULL) {
+        perror(job.out.c_str());
+    } else {
+        setvbuf(o.f, NULL, _IOFBF, OUT_BUFFER);
+        ok = job.binlog ? convertBinlog(job, o) : convertGpx(job, o);
+        if (fclose(o.f) != 0)
+            ok = false;
+    }
+    if (!ok)
+        gFailed.fetch_add(1);
+    gBytesIn.fetch_add(job.size);
+    gDone.fetch_add(1);
+}
+
+/**
+ * The thread's own queue from the back, else another's from the front.
+ */
+static bool takeJob(size_t self, size_t &job)
+{
+    for (size_t k = 0; k < gWorkers.size(); k++) {
+        Worker &w = *gWorkers[(self + k) % gWorkers.size()];
+        lock_guard<mutex> lock(w.m);
+        if (w.q.empty())
+            continue;
+        if (k == 0) {
+            job = w.q.back();
+            w.q.pop_back();
+        } else {
+            job = w.q.front();
+            w.q.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+static void workerLoop(size_t self)
+{
+    size_t job;
+    while (takeJob(self, job))
+        convert(gJobs[job]);
+}
+
+/**
+ * The binary logs and the GPX tracks that have no binary log, a file
+ * already in the output format is left alone.
+ */
+static bool scan(const string &in, const string &out)
+{
+    DIR* d = opendir(in.c_str());
+    if (d == NULL) {
+        perror(in.c_str());
+        return false;
+    }
+    vector<string> names;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL)
+        names.push_back(e->d_name);
+    closedir(d);
+    sort(names.begin(), names.end());
+
+    for (size_t i = 0; i < names.size(); i++) {
+        const string &name = names[i];
+        bool binlog = hasSuffix(name, ".dlb");
+        if (!binlog && !hasSuffix(name, ".gpx"))
+            continue;
+        string stem = name.substr(0, name.size() - 4);
+        if (!binlog && (gFormat == FMT_GPX ||
+                        binary_search(names.begin(), names.end(), stem + ".dlb")))
+            continue;
+
+        Job job;
+        job.in = in + "/" + name;
+        job.out = out + "/" + stem + "." + gFormatNames[gFormat];
+        job.binlog = binlog;
+        struct stat st;
+        job.size = stat(job.in.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+        gJobs.push_back(job);
+    }
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dl_convert [-j threads] [-f gpx|kml|csv] <in-dir> <out-dir>\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = (int)thread::hardware_concurrency();
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        if (strcmp(argv[i], "-j") == 0) {
+            threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-f") == 0) {
+            gFormat = NUM_FORMATS;
+            for (int f = 0; f < NUM_FORMATS; f++) {
+                if (strcmp(argv[i + 1], gFormatNames[f]) == 0)
+                    gFormat = f;
+            }
+            if (gFormat == NUM_FORMATS)
+                usage();
+        } else {
+            usage();
+        }
+    }
+    if (argc - i != 2)
+        usage();
+    if (threads < 1)
+        threads = 1;
+
+    string in = argv[i];
+    string out = argv[i + 1];
+    mkdir(out.c_str(), 0755);
+    if (!scan(in, out))
+        return 1;
+
+    // the biggest files first, dealt round robin
+    vector<size_t> order(gJobs.size());
+    for (size_t k = 0; k < order.size(); k++)
+        order[k] = k;
+    sort(order.begin(), order.end(), [](size_t a, size_t b) {
+        return gJobs[a].size > gJobs[b].size;
+    });
+    for (int k = 0; k < threads; k++)
+        gWorkers.push_back(new Worker);
+    for (size_t k = 0; k < order.size(); k++)
+        gWorkers[k % threads]->q.push_front(order[k]);
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int k = 0; k < threads; k++)
+        pool.push_back(thread(workerLoop, (size_t)k));
+
+    // progress once a second
+    int reported = 0;
+    while (gDone.load() < gJobs.size()) {
+        this_thread::sleep_for(chrono::milliseconds(50));
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if ((int)secs == reported)
+            continue;
+        reported = (int)secs;
+        fprintf(stderr, "%llu/%zu files, %.1f files/s, %.1f MB/s\n",
+                (unsigned long long)gDone.load(), gJobs.size(),
+                gDone.load() / secs, gBytesIn.load() / secs / 1e6);
+    }
+    for (size_t k = 0; k < pool.size(); k++)
+        pool[k].join();
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    fprintf(stderr, "converted %zu files to %s in %.2f s on %d threads: "
+                    "%.1f files/s, %.1f MB/s, %llu failed\n",
+            gJobs.size(), gFormatNames[gFormat], secs, threads,
+            secs > 0 ? gJobs.size() / secs : 0.0,
+            secs > 0 ? gBytesIn.load() / secs / 1e6 : 0.0,
+            (unsigned long long)gFailed.load());
+    for (size_t k = 0; k < gWorkers.size(); k++)
+        delete gWorkers[k];
+    return gFailed.load() == 0 ? 0 : 1;
+}
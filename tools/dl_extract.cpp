@@ -0,0 +1,105 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Cuts a time window, and optionally an area, out of a GPX track or
+// binary log using its .idx sidecar, reading only the blocks it needs.
+// The output is a file of the same format on stdout, whole blocks, so it
+// can start and end up to a block before and after the window. Times are
+// unix seconds or YYYY-MM-DDTHH:MM:SSZ.
+//
+//  $ ./tools/dl_extract [-b south,west,north,east] <file.gpx|file.dlb> <from> <to>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "../include/gpxformat.h"
+#include "./blockreader.h"
+#include "./toolutil.h"
+
+using namespace std;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dl_extract [-b south,west,north,east] <file.gpx|file.dlb> <from> <to>\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    bool area = false;
+    double south = 0, west = 0, north = 0, east = 0;
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "-b") == 0) {
+        if (sscanf(argv[i + 1], "%lf,%lf,%lf,%lf", &south, &west, &north, &east) != 4)
+            usage();
+        area = true;
+        i += 2;
+    }
+    int64_t from, to;
+    if (argc - i != 3 || !parseTime(argv[i + 1], from) || !parseTime(argv[i + 2], to))
+        usage();
+    string data = argv[i];
+    bool gpx = hasSuffix(data, ".gpx");
+
+    BlockReader r;
+    if (!blockReaderOpen(r, data) || r.blocks.empty()) {
+        fprintf(stderr, "dl_extract: no index for %s\n", data.c_str());
+        return 1;
+    }
+
+    string out;
+    if (!blockReaderHeader(r, out)) {
+        perror("dl_extract: read");
+        return 1;
+    }
+
+    // runs of adjacent matching blocks are read in one go
+    size_t n = r.blocks.size();
+    size_t used = 0;
+    size_t first = blockReaderFind(r, (uint32_t)from);
+    size_t last = first;
+    size_t b = first;
+    bool pending = false;
+    for (; b < n && r.blocks[b].wallFirst <= to; b++) {
+        const IndexEntry &e = r.blocks[b];
+        if (area && !blockIndexOverlaps(e, south, west, north, east))
+            continue;
+        used += 1;
+        if (pending && b == last + 1) {
+            last = b;
+            continue;
+        }
+        if (pending) {
+            blockReaderRead(r, first, last, out);
+            if (gpx)
+                out += GPX_SEGMENT_BREAK;
+        }
+        first = last = b;
+        pending = true;
+    }
+    if (pending && !blockReaderRead(r, first, last, out)) {
+        perror("dl_extract: read");
+        return 1;
+    }
+
+    // past the last block, the records written since it
+    if (b == n && !area && (!pending || last == n - 1)) {
+        string tail;
+        blockReaderTail(r, tail);
+        size_t epilog = sizeof(GPX_EPILOG) - 1;
+        if (gpx && tail.size() >= epilog &&
+            tail.compare(tail.size() - epilog, epilog, GPX_EPILOG) == 0)
+            tail.resize(tail.size() - epilog);
+        out += tail;
+    }
+    if (gpx)
+        out += GPX_EPILOG;
+
+    fwrite(out.data(), 1, out.size(), stdout);
+    fprintf(stderr, "%zu of %zu blocks, %zu bytes\n", used, n, out.size());
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Converts finished binary logs to Apache Parquet for pandas, DuckDB or
+// Spark, one <name>.parquet next to each <name>.dlb or in -o's folder.
+// The columns are those of the .arrow log (see include/arrowsink.h):
+// time (f64 sim elapsed seconds), wall (timestamp[ms, UTC]), cycle (i32)
+// and one per channel, f64 for double datarefs and f32 for the rest.
+// A channel holds its last logged value, within its deadband, and is
+// null until first logged. wall and cycle are delta encoded and each
+// channel is dictionary encoded in the row groups where it repeats
+// enough, see tools/parquetwriter.h.
+//
+//  $ ./tools/dl_parquet [-g rows] [-o dir] <file.dlb>...
+//
+// -g sets the rows per row group.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+
+#include "./binlogreader.h"
+#include "./parquetwriter.h"
+#include "./toolutil.h"
+
+using namespace std;
+
+enum {
+    COL_TIME = 0
+    ,COL_WALL
+    ,COL_CYCLE
+    ,NUM_FIXED_COLS
+};
+
+static string outPath(const string &in, const string &dir)
+{
+    string name = in;
+    if (hasSuffix(name, ".dlb"))
+        name.resize(name.size() - 4);
+    if (!dir.empty()) {
+        size_t slash = name.rfind('/');
+        name = dir + name.substr(slash == string::npos ? 0 : slash + 1);
+    }
+    return name + ".parquet";
+}
+
+/**
+ * One row per record.
+ */
+static bool convert(const string &in, const string &out, uint32_t groupRows)
+{
+    BinlogReader r;
+    if (!binlogReaderOpen(r, in)) {
+        fprintf(stderr, "dl_parquet: %s isn't a binary log\n", in.c_str());
+        return false;
+    }
+    ParquetWriter w;
+    parquetColumn(w, "time", PARQUET_DOUBLE, PARQUET_ENC_PLAIN, false);
+    parquetColumn(w, "wall", PARQUET_INT64, PARQUET_ENC_DELTA, false, true);
+    parquetColumn(w, "cycle", PARQUET_INT32, PARQUET_ENC_DELTA, false);
+    for (size_t i = 0; i < r.channels.size(); i++)
+        parquetColumn(w, r.channels[i].name,
+                      r.channels[i].isDouble ? PARQUET_DOUBLE : PARQUET_FLOAT,
+                      PARQUET_ENC_DICT, true);
+    if (!parquetOpen(w, out, groupRows)) {
+        perror(out.c_str());
+        binlogReaderClose(r);
+        return false;
+    }
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    uint64_t rows = 0;
+    int st;
+    bool ok = true;
+    while (ok && (st = binlogReaderNext(r)) == BINLOG_READ_OK) {
+        const BinlogRecord &rec = r.rec;
+        parquetReal(w.cols[COL_TIME], rec.elapsed);
+        parquetInt(w.cols[COL_WALL], (int64_t)rec.wallTime * 1000);
+        parquetInt(w.cols[COL_CYCLE], (int32_t)rec.cycle);
+        for (size_t i = 0; i < r.channels.size(); i++) {
+            ParquetColumn &c = w.cols[NUM_FIXED_COLS + i];
+            if (rec.seen & ((uint64_t)1 << i))
+                parquetReal(c, rec.ch[i]);
+            else
+                parquetNull(c);
+        }
+        ok = parquetEndRow(w);
+        rows += 1;
+    }
+    if (st == BINLOG_READ_TRUNCATED)
+        fprintf(stderr, "dl_parquet: %s: partial last record\n", in.c_str());
+    uint64_t size = r.offset;
+    binlogReaderClose(r);
+    if (!parquetClose(w) || !ok) {
+        perror(out.c_str());
+        remove(out.c_str());
+        return false;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    fprintf(stderr, "%s: %llu rows in %zu row groups, %.1f MB from %.1f MB in %.0f ms;"
+                    " column chunks: %llu dictionary, %llu delta, %llu plain\n",
+            out.c_str(), (unsigned long long)rows, w.groups.size(), w.offset / 1e6,
+            size / 1e6, secs * 1e3, (unsigned long long)w.dictChunks,
+            (unsigned long long)w.deltaChunks, (unsigned long long)w.plainChunks);
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dl_parquet [-g rows] [-o dir] <file.dlb>...\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t groupRows = PARQUET_GROUP_ROWS;
+    string dir;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        string opt = argv[i];
+        if (i + 1 == argc)
+            usage();
+        if (opt == "-g")
+            groupRows = (uint32_t)atoi(argv[++i]);
+        else if (opt == "-o")
+            dir = argv[++i];
+        else
+            usage();
+    }
+    if (i == argc)
+        usage();
+    if (!dir.empty() && dir[dir.size() - 1] != '/')
+        dir += "/";
+
+    int failed = 0;
+    for (; i < argc; i++) {
+        if (!convert(argv[i], outPath(argv[i], dir), groupRows))
+            failed += 1;
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Receives the DataLogger GDL-90 feed (gdl90=1) and validates it: every
+// frame's escaping and CRC are checked, and every message is decoded,
+// re-encoded with the plugin's encoder and compared byte for byte with the
+// received frame. Message rates and errors are reported once a second,
+// pass -v to also print every decoded message.
+//
+//  $ ./tools/gdl90_listener [-v] [port]
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "../include/gdl90.h"
+
+static bool gVerbose = false;
+static unsigned long gCount[256];
+static unsigned long gBadCrc = 0;
+static unsigned long gMismatch = 0;
+
+/**
+ * Rebuilds the message from its decoded fields, returns its size or 0
+ * for unknown ids.
+ */
+static size_t reencode(uint8_t* out, const uint8_t* msg, size_t n)
+{
+    switch (msg[0]) {
+    case GDL90_MSG_HEARTBEAT: {
+        if (n != GDL90_HEARTBEAT_SIZE)
+            return 0;
+        uint32_t secs = (uint32_t)((msg[2] >> 7) << 16 | msg[4] << 8 | msg[3]);
+        if (gVerbose)
+            printf("heartbeat  gps %s  %02u:%02u:%02uZ\n",
+                   (msg[1] & 0x80) ? "valid" : "invalid",
+                   secs / 3600, secs / 60 % 60, secs % 60);
+        return gdl90EncodeHeartbeat(out, (msg[1] & 0x80) != 0, secs);
+    }
+    case GDL90_MSG_GEO_ALTITUDE: {
+        if (n != GDL90_GEO_ALTITUDE_SIZE)
+            return 0;
+        int16_t alt = (int16_t)(msg[1] << 8 | msg[2]);
+        uint16_t vfom = (uint16_t)((msg[3] & 0x7f) << 8 | msg[4]);
+        if (gVerbose)
+            printf("geo alt    %d ft  vfom %u m\n", alt * 5, vfom);
+        return gdl90EncodeGeoAltitude(out, alt * 5.0, vfom);
+    }
+    case GDL90_MSG_OWNSHIP:
+    case GDL90_MSG_TRAFFIC: {
+        Gdl90Report r;
+        if (!gdl90DecodeReport(msg, n, r))
+            return 0;
+        if (gVerbose) {
+            printf("%-10s %06x %.8s  %.5f %.5f  %d ft  %u kt  %d fpm  %.0f deg%s\n",
+                   msg[0] == GDL90_MSG_OWNSHIP ? "ownship" : "traffic",
+                   r.address, r.callsign,
+                   r.lat * (180.0 / 0x800000), r.lon * (180.0 / 0x800000),
+                   r.alt == GDL90_ALT_INVALID ? 0 : r.alt * 25 - 1000,
+                   r.hvel, r.vvel * 64, r.track * (360.0 / 256.0),
+                   (r.misc & GDL90_MISC_AIRBORNE) ? "  airborne" : "");
+        }
+        return gdl90EncodeReport(out, msg[0], r);
+    }
+    }
+    return 0;
+}
+
+static void checkFrame(const uint8_t* frame, size_t n)
+{
+    // frame includes both flags
+    uint8_t msg[GDL90_MAX_FRAME];
+    size_t len = gdl90Unframe(msg, frame + 1, n - 2);
+    if (len == 0) {
+        gBadCrc += 1;
+        return;
+    }
+    gCount[msg[0]] += 1;
+
+    uint8_t again[GDL90_REPORT_SIZE];
+    uint8_t out[GDL90_MAX_FRAME];
+    size_t m = reencode(again, msg, len);
+    if (m == 0)
+        return;
+    size_t o = gdl90Frame(out, again, m);
+    if (o != n || memcmp(out, frame, n) != 0) {
+        gMismatch += 1;
+        if (gVerbose)
+            printf("re-encoded message %d differs\n", msg[0]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int port = GDL90_DEFAULT_PORT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0)
+            gVerbose = true;
+        else
+            port = atoi(argv[i]);
+    }
+    gdl90Init();
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("gdl90_listener: bind");
+        return 1;
+    }
+    fprintf(stderr, "listening on udp port %d\n", port);
+
+    static uint8_t buf[65536];
+    unsigned long dgrams = 0, badFraming = 0;
+    unsigned long last[256];
+    memset(last, 0, sizeof(last));
+    time_t lastTime = time(0);
+    for (;;) {
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0)
+            continue;
+        dgrams += 1;
+
+        // frames are back to back, each opened and closed by a flag
+        ssize_t i = 0;
+        while (i < n) {
+            if (buf[i] != GDL90_FLAG) {
+                badFraming += 1;
+                break;
+            }
+            ssize_t e = i + 1;
+            while (e < n && buf[e] != GDL90_FLAG)
+                e++;
+            if (e == n || e - i - 1 > 2 * (GDL90_REPORT_SIZE + 2)) {
+                badFraming += 1;
+                break;
+            }
+            checkFrame(buf + i, (size_t)(e - i + 1));
+            i = e + 1;
+        }
+        if (gVerbose)
+            fflush(stdout);
+
+        time_t now = time(0);
+        if (now != lastTime) {
+            double dt = (double)(now - lastTime);
+            fprintf(stderr, "%.0f datagrams/s  heartbeat %.1f/s  ownship %.1f/s  "
+                    "geo alt %.1f/s  traffic %.1f/s  bad crc %lu  bad framing %lu  "
+                    "mismatch %lu\n", dgrams / dt,
+                    (gCount[GDL90_MSG_HEARTBEAT] - last[GDL90_MSG_HEARTBEAT]) / dt,
+                    (gCount[GDL90_MSG_OWNSHIP] - last[GDL90_MSG_OWNSHIP]) / dt,
+                    (gCount[GDL90_MSG_GEO_ALTITUDE] - last[GDL90_MSG_GEO_ALTITUDE]) / dt,
+                    (gCount[GDL90_MSG_TRAFFIC] - last[GDL90_MSG_TRAFFIC]) / dt,
+                    gBadCrc, badFraming, gMismatch);
+            memcpy(last, gCount, sizeof(last));
+            dgrams = 0;
+            lastTime = now;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Loads DataLogger GPX files with tools/gpxreader and reports the points,
+// segments and read rate of each. Pass -c to print the points as CSV.
+//
+//  $ ./tools/gpx_read [-c] DataLog-*.gpx
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <string>
+
+#include "./gpxreader.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    bool csv = false;
+    int i = 1;
+    if (i < argc && strcmp(argv[i], "-c") == 0) {
+        csv = true;
+        i += 1;
+    }
+    if (i == argc) {
+        fprintf(stderr, "usage: gpx_read [-c] <file.gpx>...\n");
+        return 2;
+    }
+    if (csv)
+        printf("file,segment,lat,lon,ele,time\n");
+
+    GpxPoints pts;
+    int failed = 0;
+    for (; i < argc; i++) {
+        FILE* f = fopen(argv[i], "rb");
+        long size = 0;
+        if (f != NULL) {
+            fseek(f, 0, SEEK_END);
+            size = ftell(f);
+            fclose(f);
+        }
+
+        gpxClear(pts);
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        if (!gpxRead(argv[i], pts)) {
+            perror(argv[i]);
+            failed += 1;
+            continue;
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        fprintf(stderr, "%s: %zu points, %zu segments, %.1f MB in %.1f ms, %.2f GB/s\n",
+                argv[i], pts.lat.size(), pts.segments.size(), size / 1e6,
+                secs * 1e3, secs > 0 ? size / secs / 1e9 : 0.0);
+
+        if (!csv)
+            continue;
+        size_t seg = 0;
+        for (size_t k = 0; k < pts.lat.size(); k++) {
+            while (seg + 1 < pts.segments.size() && pts.segments[seg + 1] <= k)
+                seg += 1;
+            printf("%s,%zu,%f,%f,%f,%lld\n", argv[i], seg, pts.lat[k], pts.lon[k],
+                   pts.ele[k], (long long)pts.time[k]);
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GPX_X86 (1)
+#endif
+
+#include "./gpxreader.h"
+
+using namespace std;
+
+// the fixed parts of a point line, see writeData
+static const char gPoint[] = "<trkpt lat=\"";
+static const char gLon[] = "\" lon=\"";
+static const char gEle[] = "\"><ele>";
+static const char gEleEnd[] = "</ele>";
+static const char gTime[] = "<time>";
+static const char gTimeEnd[] = "</time>";
+static const char gPointEnd[] = "</trkpt>";
+static const char gSegment[] = "<trkseg>";
+
+#define LIT(s) (s), (sizeof(s) - 1)
+
+// exact powers of ten, a mantissa below 2^53 divided by one of them is
+// correctly rounded, the same double strtod returns
+static const double gPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char* findScalar(const char* p, const char* end)
+{
+    const void* q = memchr(p, '<', end - p);
+    return q != NULL ? (const char*)q : end;
+}
+
+#ifdef GPX_X86
+static const char* findSse2(const char* p, const char* end)
+{
+    const __m128i lt = _mm_set1_epi8('<');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lt));
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+    return findScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* findAvx2(const char* p, const char* end)
+{
+    const __m256i lt = _mm256_set1_epi8('<');
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lt));
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+    return findSse2(p, end);
+}
+#endif
+
+typedef const char* (*FindFn)(const char* p, const char* end);
+
+static FindFn findFn(void)
+{
+#ifdef GPX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return findAvx2;
+    return findSse2;
+#else
+    return findScalar;
+#endif
+}
+
+static inline bool match(const char* &p, const char* end, const char* lit,
+                         size_t n)
+{
+    if ((size_t)(end - p) < n || memcmp(p, lit, n) != 0)
+        return false;
+    p += n;
+    return true;
+}
+
+// the buffer ends inside lit
+static inline bool partial(const char* p, const char* end, const char* lit,
+                           size_t n)
+{
+    return (size_t)(end - p) < n && memcmp(p, lit, end - p) == 0;
+}
+
+/**
+ * The value of 8 ASCII digits loaded little endian, or -1 if one isn't
+ * a digit.
+ */
+static inline int64_t eightDigits(uint64_t w)
+{
+    if (((w & 0xf0f0f0f0f0f0f0f0ull) | (((w + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4))
+        != 0x3333333333333333ull)
+        return -1;
+    w -= 0x3030303030303030ull;
+    w = w * 10 + (w >> 8);
+    w = (((w & 0x000000ff000000ffull) * (100 + (1000000ull << 32))) +
+         (((w >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))) >> 32;
+    return (int64_t)w;
+}
+
+/**
+ * A %f number. Up to 19 digits are parsed here, longer ones by strtod.
+ * %f always writes 6 decimals, they're read 8 bytes at a time.
+ */
+static bool parseNumber(const char* &p, const char* end, double &v)
+{
+    const char* s = p;
+    bool neg = false;
+    if (s < end && *s == '-') {
+        neg = true;
+        s++;
+    }
+    uint64_t m = 0;
+    int digits = 0;
+    int frac = 0;
+    for (; s < end && (unsigned)(*s - '0') < 10; s++, digits++)
+        m = m * 10 + (uint64_t)(*s - '0');
+    if (end - s >= 9 && *s == '.' && (unsigned)(s[7] - '0') >= 10) {
+        uint64_t w;
+        memcpy(&w, s + 1, sizeof(w));
+        // the 6 decimals behind two '0's
+        int64_t f = eightDigits((w << 16) | 0x3030);
+        if (f >= 0) {
+            m = m * 1000000 + (uint64_t)f;
+            digits += 6;
+            frac = 6;
+            s += 7;
+        }
+    }
+    if (frac == 0 && s < end && *s == '.') {
+        for (s++; s < end && (unsigned)(*s - '0') < 10; s++, digits++, frac++)
+            m = m * 10 + (uint64_t)(*s - '0');
+    }
+    if (digits == 0)
+        return false;
+
+    if (digits <= 19 && frac <= 22 && m < ((uint64_t)1 << 53)) {
+        v = (double)m / gPow10[frac];
+        if (neg)
+            v = -v;
+    } else {
+        char buf[64];
+        size_t n = (size_t)(s - p);
+        if (n >= sizeof(buf))
+            return false;
+        memcpy(buf, p, n);
+        buf[n] = '\0';
+        v = strtod(buf, NULL);
+    }
+    p = s;
+    return true;
+}
+
+static inline int digits2(const char* p)
+{
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+/**
+ * YYYY-MM-DDTHH:MM:SSZ as unix seconds. The time only changes once a
+ * second, the last one is kept.
+ */
+static bool parseTime(const char* &p, const char* end, int64_t &t)
+{
+    static const char shape[] = "0000-00-00T00:00:00Z";
+    static thread_local char last[20];
+    static thread_local int64_t lastTime = -1;
+    if (end - p < 20)
+        return false;
+    if (lastTime >= 0 && memcmp(p, last, 20) == 0) {
+        t = lastTime;
+        p += 20;
+        return true;
+    }
+    for (int i = 0; i < 20; i++) {
+        if (shape[i] == '0' ? (unsigned)(p[i] - '0') >= 10 : p[i] != shape[i])
+            return false;
+    }
+    int y = digits2(p) * 100 + digits2(p + 2);
+    int mon = digits2(p + 5);
+    int d = digits2(p + 8);
+
+    // days from civil, proleptic Gregorian
+    y -= mon <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+
+    t = days * 86400 + digits2(p + 11) * 3600 + digits2(p + 14) * 60 + digits2(p + 17);
+    memcpy(last, p, 20);
+    lastTime = t;
+    p += 20;
+    return true;
+}
+
+/**
+ * One point line, returns the start of the next line or NULL.
+ */
+static const char* parsePoint(const char* p, const char* end, GpxPoints &pts)
+{
+    double lat, lon, ele;
+    int64_t t = 0;
+    if (!match(p, end, LIT(gPoint)) || !parseNumber(p, end, lat) ||
+        !match(p, end, LIT(gLon)) || !parseNumber(p, end, lon) ||
+        !match(p, end, LIT(gEle)) || !parseNumber(p, end, ele) ||
+        !match(p, end, LIT(gEleEnd)))
+        return NULL;
+    if (match(p, end, LIT(gTime))) {
+        if (!parseTime(p, end, t) || !match(p, end, LIT(gTimeEnd)))
+            return NULL;
+    }
+    if (!match(p, end, LIT(gPointEnd)) || p == end || *p != '\n')
+        return NULL;
+
+    pts.lat.push_back(lat);
+    pts.lon.push_back(lon);
+    pts.ele.push_back(ele);
+    pts.time.push_back(t);
+    return p + 1;
+}
+
+/**
+ *
+ */
+size_t gpxParse(const char* buf, size_t n, GpxPoints &pts)
+{
+    static const FindFn find = findFn();
+    const char* p = buf;
+    const char* end = buf + n;
+    const char* done = buf;
+    for (;;) {
+        p = find(p, end);
+        if (p == end)
+            break;
+        const char* q = p;
+        if (match(q, end, LIT(gPoint))) {
+            const char* next = parsePoint(p, end, pts);
+            if (next == NULL) {
+                // a malformed line is skipped, a partial last one ends it
+                next = (const char*)memchr(p, '\n', end - p);
+                if (next == NULL)
+                    break;
+                next += 1;
+            }
+            p = done = next;
+            continue;
+        }
+        if (partial(p, end, LIT(gPoint)) || partial(p, end, LIT(gSegment)))
+            break;              // a partial last line
+        if (match(q, end, LIT(gSegment))) {
+            uint32_t first = (uint32_t)pts.lat.size();
+            if (pts.segments.empty() || pts.segments.back() != first)
+                pts.segments.push_back(first);
+            p = done = q;
+            continue;
+        }
+        p += 1;
+        done = p;
+    }
+    return (size_t)(done - buf);
+}
+
+/**
+ *
+ */
+bool gpxRead(const string &path, GpxPoints &pts)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+#ifdef MAP_POPULATE
+    // fault the file in at once rather than a page at a time
+    int flags = MAP_PRIVATE | MAP_POPULATE;
+#else
+    int flags = MAP_PRIVATE;
+#endif
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    // roughly 90 bytes a point
+    size_t guess = pts.lat.size() + (size_t)st.st_size / 90;
+    pts.lat.reserve(guess);
+    pts.lon.reserve(guess);
+    pts.ele.reserve(guess);
+    pts.time.reserve(guess);
+
+    gpxParse((const char*)p, (size_t)st.st_size, pts);
+    munmap(p, (size_t)st.st_size);
+    return true;
+}
+
+/**
+ *
+ */
+void gpxClear(GpxPoints &pts)
+{
+    pts.lat.clear();
+    pts.lon.clear();
+    pts.ele.clear();
+    pts.time.clear();
+    pts.segments.clear();
+}
+
+/**
+ * A line cut by the end of the buffer is moved to its front and read
+ * again with the next chunk.
+ */
+void gpxStream(FILE* f, GpxChunkFn fn, void* ctx)
+{
+    vector<char> buf(GPX_READ_CHUNK);
+    GpxPoints pts;
+    size_t len = 0;
+    for (;;) {
+        size_t got = fread(&buf[len], 1, buf.size() - len, f);
+        len += got;
+        gpxClear(pts);
+        size_t used = gpxParse(&buf[0], len, pts);
+        if (got == 0)
+            used = len;
+        else if (used == 0 && len == buf.size())
+            used = len;         // a line longer than the buffer isn't ours
+        fn(ctx, &buf[len - got], got, pts);
+
+        memmove(&buf[0], &buf[used], len - used);
+        len -= used;
+        if (got == 0)
+            break;
+    }
+}
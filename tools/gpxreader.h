@@ -0,0 +1,59 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef GPXREADER_H
+#define GPXREADER_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Reader for the plugin's own GPX files, not a general GPX parser: it
+ * only knows the lines writeData and writeSegmentBreak emit,
+ *
+ *      <trkpt lat="%f" lon="%f"><ele>%f</ele><time>...Z</time></trkpt>
+ *      </trkseg><trkseg>
+ *
+ * and skips everything else. The file is memory mapped, the next '<' is
+ * found 16 or 32 bytes at a time (SSE2/AVX2) and the numbers are parsed
+ * in place, so it runs at memory bandwidth rather than XML parser speed.
+ * A file without its epilog, e.g. still being written or left by a sim
+ * crash, reads up to its last complete point.
+ */
+#define GPX_READ_CHUNK (4 << 20)
+
+/**
+ * The points, one array per field.
+ */
+struct GpxPoints {
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<double> ele;
+    std::vector<int64_t> time;          // unix seconds, 0 without a time
+    std::vector<uint32_t> segments;     // index of each segment's first point
+};
+
+// appends the file's points, false if it can't be mapped
+bool gpxRead(const std::string &path, GpxPoints &pts);
+
+// the same for a buffer, returns the bytes consumed up to the last
+// complete line
+size_t gpxParse(const char* p, size_t n, GpxPoints &pts);
+
+void gpxClear(GpxPoints &pts);
+
+/**
+ * Called for each read of gpxStream with the bytes read, as they are in
+ * the file, and the points of the lines it completed. A segment opened
+ * after the last of them is in segments as lat.size().
+ */
+typedef void (*GpxChunkFn)(void* ctx, const char* data, size_t n, const GpxPoints &pts);
+
+// reads an open file GPX_READ_CHUNK bytes at a time, only one chunk's
+// points are held
+void gpxStream(FILE* f, GpxChunkFn fn, void* ctx);
+
+#endif /* GPXREADER_H */
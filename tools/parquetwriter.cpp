@@ -0,0 +1,625 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <cstring>
+#include <cmath>
+#include <unordered_map>
+
+#include "./parquetwriter.h"
+
+using namespace std;
+
+// parquet.thrift Encoding, PageType and field types
+#define ENC_PLAIN (0)
+#define ENC_RLE (3)
+#define ENC_DELTA_BINARY_PACKED (5)
+#define ENC_RLE_DICTIONARY (8)
+#define PAGE_DATA (0)
+#define PAGE_DICTIONARY (2)
+#define REPETITION_REQUIRED (0)
+#define REPETITION_OPTIONAL (1)
+#define CONVERTED_TIMESTAMP_MILLIS (9)
+
+// Thrift compact protocol types
+#define T_TRUE (1)
+#define T_FALSE (2)
+#define T_I32 (5)
+#define T_I64 (6)
+#define T_BINARY (8)
+#define T_LIST (9)
+#define T_STRUCT (12)
+
+#define DELTA_BLOCK (128)
+#define DELTA_MINIBLOCKS (4)
+#define DELTA_MINIBLOCK (DELTA_BLOCK / DELTA_MINIBLOCKS)
+
+/**
+ * Thrift compact protocol output, the last field id of each open struct
+ * is kept for the field header deltas.
+ */
+struct Thrift {
+    string out;
+    vector<int> last;
+};
+
+static void varint(string &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static void field(Thrift &t, int id, int type)
+{
+    int delta = id - t.last.back();
+    if (delta > 0 && delta <= 15) {
+        t.out += (char)((delta << 4) | type);
+    } else {
+        t.out += (char)type;
+        varint(t.out, zigzag(id));
+    }
+    t.last.back() = id;
+}
+
+static void structBegin(Thrift &t)
+{
+    t.last.push_back(0);
+}
+
+static void structEnd(Thrift &t)
+{
+    t.out += (char)0;
+    t.last.pop_back();
+}
+
+static void fieldStruct(Thrift &t, int id)
+{
+    field(t, id, T_STRUCT);
+    structBegin(t);
+}
+
+static void fieldI32(Thrift &t, int id, int32_t v)
+{
+    field(t, id, T_I32);
+    varint(t.out, zigzag(v));
+}
+
+static void fieldI64(Thrift &t, int id, int64_t v)
+{
+    field(t, id, T_I64);
+    varint(t.out, zigzag(v));
+}
+
+static void fieldBool(Thrift &t, int id, bool v)
+{
+    field(t, id, v ? T_TRUE : T_FALSE);
+}
+
+static void binary(string &out, const string &s)
+{
+    varint(out, s.size());
+    out += s;
+}
+
+static void fieldBinary(Thrift &t, int id, const string &s)
+{
+    field(t, id, T_BINARY);
+    binary(t.out, s);
+}
+
+static void fieldList(Thrift &t, int id, int type, size_t n)
+{
+    field(t, id, T_LIST);
+    if (n < 15) {
+        t.out += (char)((n << 4) | type);
+    } else {
+        t.out += (char)(0xf0 | type);
+        varint(t.out, n);
+    }
+}
+
+/**
+ * Appends n values of w bits, least significant bit first. n * w is a
+ * multiple of 8 wherever it's used.
+ */
+static void packBits(string &out, const uint64_t* v, size_t n, int w)
+{
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t x = v[i];
+        int left = w;
+        while (left > 0) {
+            int take = left < 64 - bits ? left : 64 - bits;
+            uint64_t part = take == 64 ? x : x & ((1ull << take) - 1);
+            acc |= part << bits;
+            bits += take;
+            x = take == 64 ? 0 : x >> take;
+            left -= take;
+            if (bits == 64) {
+                out.append((const char*)&acc, 8);
+                acc = 0;
+                bits = 0;
+            }
+        }
+    }
+    out.append((const char*)&acc, (bits + 7) / 8);
+}
+
+static inline int bitWidth(uint64_t v)
+{
+    int w = 0;
+    while (v != 0) {
+        w += 1;
+        v >>= 1;
+    }
+    return w;
+}
+
+static bool runAt(const uint32_t* v, size_t i, size_t n)
+{
+    if (i + 8 > n)
+        return false;
+    for (size_t k = 1; k < 8; k++) {
+        if (v[i + k] != v[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * The RLE / bit-packing hybrid: runs of 8 or more repeats are RLE, the
+ * values between them bit-packed 8 at a time, the last group padded.
+ */
+static void rleEncode(string &out, const uint32_t* v, size_t n, int w)
+{
+    uint64_t group[8];
+    size_t i = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && v[i + run] == v[i])
+            run += 1;
+        if (run >= 8) {
+            varint(out, (uint64_t)run << 1);
+            uint32_t x = v[i];
+            out.append((const char*)&x, (w + 7) / 8);
+            i += run;
+            continue;
+        }
+        size_t j = i;
+        do {
+            j += 8;
+        } while (j < n && !runAt(v, j, n));
+        varint(out, (uint64_t)((j - i) / 8) << 1 | 1);
+        for (size_t g = i; g < j; g += 8) {
+            for (size_t k = 0; k < 8; k++)
+                group[k] = g + k < n ? v[g + k] : 0;
+            packBits(out, group, 8, w);
+        }
+        i = j;
+    }
+}
+
+/**
+ * DELTA_BINARY_PACKED, blocks of 128 deltas in 4 miniblocks. INT32
+ * deltas wrap at 32 bits, as the readers compute them.
+ */
+static void deltaEncode(string &out, const int64_t* v, size_t n, bool is32)
+{
+    varint(out, DELTA_BLOCK);
+    varint(out, DELTA_MINIBLOCKS);
+    varint(out, n);
+    varint(out, zigzag(n > 0 ? v[0] : 0));
+
+    uint64_t packed[DELTA_BLOCK];
+    int64_t delta[DELTA_BLOCK];
+    for (size_t i = 1; i < n; i += DELTA_BLOCK) {
+        size_t count = n - i < DELTA_BLOCK ? n - i : DELTA_BLOCK;
+        int64_t min = 0;
+        for (size_t k = 0; k < count; k++) {
+            uint64_t d = (uint64_t)v[i + k] - (uint64_t)v[i + k - 1];
+            delta[k] = is32 ? (int64_t)(int32_t)(uint32_t)d : (int64_t)d;
+            if (k == 0 || delta[k] < min)
+                min = delta[k];
+        }
+        varint(out, zigzag(min));
+
+        int widths[DELTA_MINIBLOCKS];
+        for (int m = 0; m < DELTA_MINIBLOCKS; m++) {
+            uint64_t most = 0;
+            for (size_t k = (size_t)m * DELTA_MINIBLOCK; k < (size_t)(m + 1) * DELTA_MINIBLOCK; k++) {
+                uint64_t x = 0;
+                if (k < count) {
+                    x = (uint64_t)delta[k] - (uint64_t)min;
+                    if (is32)
+                        x &= 0xffffffffull;
+                }
+                packed[k] = x;
+                most |= x;
+            }
+            widths[m] = bitWidth(most);
+            out += (char)widths[m];
+        }
+        // the miniblocks past the last value aren't written
+        for (int m = 0; m < DELTA_MINIBLOCKS && (size_t)m * DELTA_MINIBLOCK < count; m++)
+            packBits(out, packed + m * DELTA_MINIBLOCK, DELTA_MINIBLOCK, widths[m]);
+    }
+}
+
+static int valueSize(int type)
+{
+    return type == PARQUET_INT32 || type == PARQUET_FLOAT ? 4 : 8;
+}
+
+/**
+ * A value's PLAIN bytes, also its dictionary key.
+ */
+static inline uint64_t plainBits(const ParquetColumn &c, size_t i)
+{
+    uint64_t b = 0;
+    switch (c.type) {
+    case PARQUET_INT32: {
+        int32_t x = (int32_t)c.ints[i];
+        memcpy(&b, &x, 4);
+        break;
+    }
+    case PARQUET_INT64:
+        memcpy(&b, &c.ints[i], 8);
+        break;
+    case PARQUET_FLOAT: {
+        float x = (float)c.reals[i];
+        memcpy(&b, &x, 4);
+        break;
+    }
+    default:
+        memcpy(&b, &c.reals[i], 8);
+        break;
+    }
+    return b;
+}
+
+static size_t valueCount(const ParquetColumn &c)
+{
+    return c.type == PARQUET_INT32 || c.type == PARQUET_INT64 ? c.ints.size() : c.reals.size();
+}
+
+/**
+ * The chunk's min and max, NaNs left out, as PLAIN bytes.
+ */
+static void stats(const ParquetColumn &c, ParquetChunk &ch)
+{
+    size_t n = valueCount(c);
+    size_t lo = n, hi = n;
+    for (size_t i = 0; i < n; i++) {
+        if (c.type == PARQUET_INT32 || c.type == PARQUET_INT64) {
+            if (lo == n || c.ints[i] < c.ints[lo])
+                lo = i;
+            if (hi == n || c.ints[i] > c.ints[hi])
+                hi = i;
+        } else if (!std::isnan(c.reals[i])) {
+            if (lo == n || c.reals[i] < c.reals[lo])
+                lo = i;
+            if (hi == n || c.reals[i] > c.reals[hi])
+                hi = i;
+        }
+    }
+    ch.min.clear();
+    ch.max.clear();
+    if (lo == n)
+        return;
+    uint64_t b = plainBits(c, lo);
+    ch.min.assign((const char*)&b, valueSize(c.type));
+    b = plainBits(c, hi);
+    ch.max.assign((const char*)&b, valueSize(c.type));
+}
+
+static bool writeBytes(ParquetWriter &w, const string &s)
+{
+    if (fwrite(s.data(), 1, s.size(), w.f) != s.size())
+        w.failed = true;
+    w.offset += s.size();
+    return !w.failed;
+}
+
+/**
+ * A page with its header.
+ */
+static void writePage(ParquetWriter &w, int type, const string &body, int values,
+                      int encoding)
+{
+    Thrift t;
+    structBegin(t);
+    fieldI32(t, 1, type);
+    fieldI32(t, 2, (int32_t)body.size());
+    fieldI32(t, 3, (int32_t)body.size());
+    if (type == PAGE_DICTIONARY) {
+        fieldStruct(t, 7);
+        fieldI32(t, 1, values);
+        fieldI32(t, 2, ENC_PLAIN);
+        structEnd(t);
+    } else {
+        fieldStruct(t, 5);
+        fieldI32(t, 1, values);
+        fieldI32(t, 2, encoding);
+        fieldI32(t, 3, ENC_RLE);
+        fieldI32(t, 4, ENC_RLE);
+        structEnd(t);
+    }
+    structEnd(t);
+    writeBytes(w, t.out);
+    writeBytes(w, body);
+}
+
+/**
+ * Writes the column's chunk of the row group and clears its values.
+ */
+static void writeChunk(ParquetWriter &w, ParquetColumn &c, uint32_t rows)
+{
+    ParquetChunk ch;
+    size_t n = valueCount(c);
+    int size = valueSize(c.type);
+    ch.values = rows;
+    ch.nulls = rows - n;
+    stats(c, ch);
+    uint64_t start = w.offset;
+
+    // a dictionary where the chunk comes out smaller
+    vector<uint32_t> idx;
+    string dict;
+    int idxWidth = 0;
+    ch.dict = false;
+    if (c.encoding == PARQUET_ENC_DICT) {
+        unordered_map<uint64_t, uint32_t> seen;
+        idx.resize(n);
+        size_t i = 0;
+        for (; i < n && seen.size() <= PARQUET_DICT_MAX; i++) {
+            uint64_t b = plainBits(c, i);
+            unordered_map<uint64_t, uint32_t>::iterator it = seen.find(b);
+            if (it == seen.end()) {
+                it = seen.insert(make_pair(b, (uint32_t)seen.size())).first;
+                dict.append((const char*)&b, size);
+            }
+            idx[i] = it->second;
+        }
+        idxWidth = bitWidth(seen.size() > 1 ? seen.size() - 1 : 1);
+        ch.dict = i == n && seen.size() <= PARQUET_DICT_MAX &&
+                  dict.size() + n * idxWidth / 8 < n * (size_t)size;
+    }
+    if (ch.dict) {
+        ch.encoding = ENC_RLE_DICTIONARY;
+        ch.dictOffset = w.offset;
+        writePage(w, PAGE_DICTIONARY, dict, (int)(dict.size() / size), ENC_PLAIN);
+        w.dictChunks += 1;
+    } else if (c.encoding == PARQUET_ENC_DELTA) {
+        ch.encoding = ENC_DELTA_BINARY_PACKED;
+        w.deltaChunks += 1;
+    } else {
+        ch.encoding = ENC_PLAIN;
+        w.plainChunks += 1;
+    }
+    ch.dataOffset = w.offset;
+
+    vector<uint32_t> defs;
+    size_t v = 0;
+    for (uint32_t r = 0; r < rows; r += PARQUET_PAGE_ROWS) {
+        uint32_t pageRows = rows - r < PARQUET_PAGE_ROWS ? rows - r : PARQUET_PAGE_ROWS;
+        size_t count = pageRows;
+        string body;
+        if (c.optional) {
+            defs.assign(c.defs.begin() + r, c.defs.begin() + r + pageRows);
+            count = 0;
+            for (size_t k = 0; k < defs.size(); k++)
+                count += defs[k];
+            string levels;
+            rleEncode(levels, &defs[0], defs.size(), 1);
+            uint32_t len = (uint32_t)levels.size();
+            body.append((const char*)&len, 4);
+            body += levels;
+        }
+        if (ch.dict) {
+            body += (char)idxWidth;
+            rleEncode(body, count > 0 ? &idx[v] : NULL, count, idxWidth);
+        } else if (ch.encoding == ENC_DELTA_BINARY_PACKED) {
+            deltaEncode(body, count > 0 ? &c.ints[v] : NULL, count, c.type == PARQUET_INT32);
+        } else {
+            for (size_t k = v; k < v + count; k++) {
+                uint64_t b = plainBits(c, k);
+                body.append((const char*)&b, size);
+            }
+        }
+        writePage(w, PAGE_DATA, body, (int)pageRows, ch.encoding);
+        v += count;
+    }
+    ch.size = w.offset - start;
+    c.chunks.push_back(ch);
+    c.ints.clear();
+    c.reals.clear();
+    c.defs.clear();
+}
+
+static void writeGroup(ParquetWriter &w)
+{
+    if (w.rows == 0)
+        return;
+    for (size_t i = 0; i < w.cols.size(); i++)
+        writeChunk(w, w.cols[i], w.rows);
+    w.groups.push_back(w.rows);
+    w.rows = 0;
+}
+
+static void statistics(Thrift &t, int id, const ParquetChunk &ch)
+{
+    fieldStruct(t, id);
+    fieldI64(t, 3, (int64_t)ch.nulls);
+    if (!ch.min.empty()) {
+        fieldBinary(t, 5, ch.max);
+        fieldBinary(t, 6, ch.min);
+    }
+    structEnd(t);
+}
+
+/**
+ * FileMetaData, see parquet.thrift.
+ */
+static string footer(const ParquetWriter &w)
+{
+    Thrift t;
+    structBegin(t);
+    fieldI32(t, 1, 1);
+
+    fieldList(t, 2, T_STRUCT, w.cols.size() + 1);
+    structBegin(t);
+    fieldBinary(t, 4, "schema");
+    fieldI32(t, 5, (int32_t)w.cols.size());
+    structEnd(t);
+    for (size_t i = 0; i < w.cols.size(); i++) {
+        const ParquetColumn &c = w.cols[i];
+        structBegin(t);
+        fieldI32(t, 1, c.type);
+        fieldI32(t, 3, c.optional ? REPETITION_OPTIONAL : REPETITION_REQUIRED);
+        fieldBinary(t, 4, c.name);
+        if (c.millis) {
+            fieldI32(t, 6, CONVERTED_TIMESTAMP_MILLIS);
+            fieldStruct(t, 10);         // LogicalType
+            fieldStruct(t, 8);          // TimestampType
+            fieldBool(t, 1, true);
+            fieldStruct(t, 2);          // TimeUnit
+            fieldStruct(t, 1);          // MILLIS
+            structEnd(t);
+            structEnd(t);
+            structEnd(t);
+            structEnd(t);
+        }
+        structEnd(t);
+    }
+
+    uint64_t rows = 0;
+    for (size_t g = 0; g < w.groups.size(); g++)
+        rows += w.groups[g];
+    fieldI64(t, 3, (int64_t)rows);
+
+    fieldList(t, 4, T_STRUCT, w.groups.size());
+    for (size_t g = 0; g < w.groups.size(); g++) {
+        structBegin(t);
+        uint64_t bytes = 0;
+        fieldList(t, 1, T_STRUCT, w.cols.size());
+        for (size_t i = 0; i < w.cols.size(); i++) {
+            const ParquetColumn &c = w.cols[i];
+            const ParquetChunk &ch = c.chunks[g];
+            uint64_t first = ch.dict ? ch.dictOffset : ch.dataOffset;
+            bytes += ch.size;
+            structBegin(t);
+            fieldI64(t, 2, (int64_t)first);
+            fieldStruct(t, 3);
+            fieldI32(t, 1, c.type);
+            int encodings[3];
+            int e = 0;
+            if (ch.dict)
+                encodings[e++] = ENC_PLAIN;
+            encodings[e++] = ch.encoding;
+            if (c.optional || ch.dict)
+                encodings[e++] = ENC_RLE;
+            fieldList(t, 2, T_I32, e);
+            for (int k = 0; k < e; k++)
+                varint(t.out, zigzag(encodings[k]));
+            fieldList(t, 3, T_BINARY, 1);
+            binary(t.out, c.name);
+            fieldI32(t, 4, 0);          // UNCOMPRESSED
+            fieldI64(t, 5, (int64_t)ch.values);
+            fieldI64(t, 6, (int64_t)ch.size);
+            fieldI64(t, 7, (int64_t)ch.size);
+            fieldI64(t, 9, (int64_t)ch.dataOffset);
+            if (ch.dict)
+                fieldI64(t, 11, (int64_t)ch.dictOffset);
+            statistics(t, 12, ch);
+            structEnd(t);
+            structEnd(t);
+        }
+        fieldI64(t, 2, (int64_t)bytes);
+        fieldI64(t, 3, w.groups[g]);
+        structEnd(t);
+    }
+    fieldBinary(t, 6, "DataLogger dl_parquet");
+
+    // the columns' min and max follow their type's order
+    fieldList(t, 7, T_STRUCT, w.cols.size());
+    for (size_t i = 0; i < w.cols.size(); i++) {
+        structBegin(t);
+        fieldStruct(t, 1);
+        structEnd(t);
+        structEnd(t);
+    }
+    structEnd(t);
+    return t.out;
+}
+
+/**
+ *
+ */
+void parquetColumn(ParquetWriter &w, const string &name, int type, int encoding,
+                   bool optional, bool millis)
+{
+    ParquetColumn c;
+    c.name = name;
+    c.type = type;
+    c.encoding = encoding;
+    c.optional = optional;
+    c.millis = millis;
+    w.cols.push_back(c);
+}
+
+/**
+ * Creates the file and writes the magic, the columns are added first.
+ */
+bool parquetOpen(ParquetWriter &w, const string &path, uint32_t groupRows)
+{
+    w.f = fopen(path.c_str(), "wb");
+    if (w.f == NULL)
+        return false;
+    w.path = path;
+    w.offset = 0;
+    w.groupRows = groupRows > 0 ? groupRows : PARQUET_GROUP_ROWS;
+    w.rows = 0;
+    w.groups.clear();
+    w.dictChunks = w.plainChunks = w.deltaChunks = 0;
+    w.failed = false;
+    return writeBytes(w, PARQUET_MAGIC);
+}
+
+/**
+ * A row group is written every groupRows rows.
+ */
+bool parquetEndRow(ParquetWriter &w)
+{
+    w.rows += 1;
+    if (w.rows == w.groupRows)
+        writeGroup(w);
+    return !w.failed;
+}
+
+/**
+ *
+ */
+bool parquetClose(ParquetWriter &w)
+{
+    if (w.f == NULL)
+        return false;
+    writeGroup(w);
+    string meta = footer(w);
+    uint32_t len = (uint32_t)meta.size();
+    writeBytes(w, meta);
+    writeBytes(w, string((const char*)&len, 4));
+    writeBytes(w, PARQUET_MAGIC);
+    if (fclose(w.f) != 0)
+        w.failed = true;
+    w.f = NULL;
+    return !w.failed;
+}
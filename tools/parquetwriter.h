@@ -0,0 +1,128 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef PARQUETWRITER_H
+#define PARQUETWRITER_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Minimal Apache Parquet file writer, flat schemas of INT32, INT64,
+ * FLOAT and DOUBLE columns, uncompressed v1 data pages. The metadata is
+ * Thrift compact protocol written by hand, no Parquet library needed.
+ * Layout:
+ *
+ *      "PAR1"
+ *      per row group, per column: [dictionary page] data pages
+ *      FileMetaData
+ *      u32         FileMetaData length
+ *      "PAR1"
+ *
+ * A column's values are PLAIN, DELTA_BINARY_PACKED, or dictionary
+ * encoded (a PLAIN dictionary page and RLE_DICTIONARY indices) in each
+ * chunk where that's smaller than PLAIN. Optional columns have RLE
+ * definition levels. Each chunk carries its min, max and null count so
+ * readers can skip row groups.
+ */
+#define PARQUET_MAGIC "PAR1"
+#define PARQUET_GROUP_ROWS (131072)     // default rows per row group
+#define PARQUET_PAGE_ROWS (16384)
+#define PARQUET_DICT_MAX (65536)        // entries before falling back to PLAIN
+
+// physical types
+enum {
+    PARQUET_INT32 = 1
+    ,PARQUET_INT64 = 2
+    ,PARQUET_FLOAT = 4
+    ,PARQUET_DOUBLE = 5
+};
+
+// what a column asks for
+enum {
+    PARQUET_ENC_PLAIN = 0
+    ,PARQUET_ENC_DELTA          // integers only
+    ,PARQUET_ENC_DICT           // PLAIN where a chunk's dictionary doesn't pay
+};
+
+/**
+ * A column chunk as the footer describes it.
+ */
+struct ParquetChunk {
+    bool dict;
+    int encoding;               // of the data pages, a Parquet Encoding
+    uint64_t dictOffset;
+    uint64_t dataOffset;
+    uint64_t size;
+    uint64_t values;            // rows, nulls included
+    uint64_t nulls;
+    std::string min;            // PLAIN, empty if there's no value
+    std::string max;
+};
+
+struct ParquetColumn {
+    std::string name;
+    int type;
+    int encoding;
+    bool optional;
+    bool millis;                // INT64 UTC milliseconds timestamp
+
+    // the row group being built, ints for INT32 and INT64 and reals for
+    // FLOAT and DOUBLE, only the non-null values
+    std::vector<int64_t> ints;
+    std::vector<double> reals;
+    std::vector<uint8_t> defs;  // optional columns, 1 where not null
+
+    std::vector<ParquetChunk> chunks;
+};
+
+struct ParquetWriter {
+    FILE* f;
+    std::string path;
+    uint64_t offset;
+    std::vector<ParquetColumn> cols;
+    uint32_t groupRows;         // rows per row group
+    uint32_t rows;              // in the row group being built
+    std::vector<uint32_t> groups;   // rows of each written row group
+    uint64_t dictChunks;
+    uint64_t plainChunks;
+    uint64_t deltaChunks;
+    bool failed;
+};
+
+// adds a column, before parquetOpen
+void parquetColumn(ParquetWriter &w, const std::string &name, int type,
+                   int encoding, bool optional, bool millis = false);
+
+bool parquetOpen(ParquetWriter &w, const std::string &path,
+                 uint32_t groupRows = PARQUET_GROUP_ROWS);
+
+// each column gets one value or null per row, then the row is ended
+static inline void parquetInt(ParquetColumn &c, int64_t v)
+{
+    c.ints.push_back(v);
+    if (c.optional)
+        c.defs.push_back(1);
+}
+
+static inline void parquetReal(ParquetColumn &c, double v)
+{
+    c.reals.push_back(v);
+    if (c.optional)
+        c.defs.push_back(1);
+}
+
+static inline void parquetNull(ParquetColumn &c)
+{
+    c.defs.push_back(0);
+}
+
+bool parquetEndRow(ParquetWriter &w);
+
+// writes the last row group and the footer, false if a write failed
+bool parquetClose(ParquetWriter &w);
+
+#endif /* PARQUETWRITER_H */
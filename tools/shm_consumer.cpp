@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Prints the DataLogger shared memory feed as CSV, one row per record.
+//
+//  $ ./tools/shm_consumer
+
+#include <cstdio>
+#include <thread>
+#include <chrono>
+
+#include "./shmreader.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    ShmReader r;
+    while (!shmReaderOpen(r)) {
+        fprintf(stderr, "waiting for the DataLogger feed...\n");
+        this_thread::sleep_for(chrono::seconds(1));
+    }
+
+    const ShmHeader &hdr = r.feed->hdr;
+    printf("index,cycle,elapsed");
+    for (uint32_t i = 0; i < hdr.channelCount; i++)
+        printf(",%.15s", hdr.channels[i].name);
+    printf("\n");
+
+    ShmSample s;
+    for (;;) {
+        switch (shmReaderNext(r, s)) {
+        case SHM_READ_OK:
+            printf("%llu,%d,%.3f", (unsigned long long)s.index, s.cycle, s.elapsed);
+            for (uint32_t i = 0; i < hdr.channelCount; i++) {
+                // channels of groups that weren't sampled are left empty
+                if (s.groups & (1u << hdr.channels[i].group))
+                    printf(",%.9g", s.ch[i]);
+                else
+                    printf(",");
+            }
+            printf("\n");
+            break;
+        case SHM_READ_EMPTY:
+            fflush(stdout);
+            this_thread::sleep_for(chrono::milliseconds(5));
+            break;
+        case SHM_READ_LAPPED:
+            fprintf(stderr, "reader fell behind, records skipped\n");
+            break;
+        case SHM_READ_GONE:
+            fprintf(stderr, "feed closed\n");
+            shmReaderClose(r);
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "./shmreader.h"
+
+using namespace std;
+
+/**
+ * Attaches read-only to the feed, reading starts with the next record
+ * published.
+ */
+bool shmReaderOpen(ShmReader &r)
+{
+    r.feed = NULL;
+    int fd = shm_open(SHM_FEED_NAME, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    void* p = mmap(NULL, sizeof(ShmFeed), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    const ShmFeed* feed = static_cast<const ShmFeed*>(p);
+    if (feed->hdr.magic != SHM_FEED_MAGIC ||
+        feed->hdr.version != SHM_FEED_VERSION ||
+        feed->hdr.recordSize != sizeof(ShmRecord)) {
+        munmap(p, sizeof(ShmFeed));
+        return false;
+    }
+    r.feed = feed;
+    r.schemaVersion = feed->hdr.schemaVersion;
+    r.next = feed->hdr.head.load(memory_order_acquire);
+    return true;
+}
+
+/**
+ * Copies the next record. On SHM_READ_LAPPED the reader skips ahead to
+ * the oldest record still available.
+ */
+int shmReaderNext(ShmReader &r, ShmSample &out)
+{
+    const ShmHeader &hdr = r.feed->hdr;
+    if (hdr.magic != SHM_FEED_MAGIC || hdr.schemaVersion != r.schemaVersion)
+        return SHM_READ_GONE;
+
+    uint64_t head = hdr.head.load(memory_order_acquire);
+    if (head < r.next)
+        return SHM_READ_GONE;   // the sequence restarted
+    if (head == r.next)
+        return SHM_READ_EMPTY;
+    if (head - r.next > SHM_FEED_SLOTS) {
+        r.next = head - SHM_FEED_SLOTS;
+        return SHM_READ_LAPPED;
+    }
+
+    uint64_t n = r.next;
+    const ShmRecord &rec = r.feed->slots[n & (SHM_FEED_SLOTS - 1)];
+    uint64_t s1 = rec.seq.load(memory_order_acquire);
+    if (s1 != 2 * n + 2) {
+        if (s1 < 2 * n + 2)
+            return SHM_READ_EMPTY;  // still being written
+        r.next = head - SHM_FEED_SLOTS + 1;
+        return SHM_READ_LAPPED;
+    }
+
+    out.index = n;
+    out.groups = rec.groups;
+    out.cycle = rec.cycle;
+    out.wallTime = rec.wallTime;
+    out.elapsed = rec.elapsed;
+    out.flags = rec.flags;
+    memcpy(out.ch, rec.ch, sizeof(out.ch));
+
+    atomic_thread_fence(memory_order_acquire);
+    if (rec.seq.load(memory_order_relaxed) != s1) {
+        r.next = head - SHM_FEED_SLOTS + 1;
+        return SHM_READ_LAPPED;
+    }
+    r.next = n + 1;
+    return SHM_READ_OK;
+}
+
+/**
+ *
+ */
+void shmReaderClose(ShmReader &r)
+{
+    if (r.feed != NULL)
+        munmap((void*)r.feed, sizeof(ShmFeed));
+    r.feed = NULL;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef SHMREADER_H
+#define SHMREADER_H
+
+#include <stdint.h>
+
+#include "../include/shmfeed.h"
+
+/*
+ * Reader side of the DataLogger shared memory feed. Any number of
+ * readers can attach, each keeps its own position.
+ */
+
+enum {
+    SHM_READ_OK = 0
+    ,SHM_READ_EMPTY         // nothing new yet
+    ,SHM_READ_LAPPED        // records were overwritten before being read
+    ,SHM_READ_GONE          // the plugin closed or restarted the feed
+};
+
+// a copied record
+struct ShmSample {
+    uint64_t index;
+    uint32_t groups;
+    int32_t cycle;
+    int64_t wallTime;
+    float elapsed;
+    uint32_t flags;
+    double ch[SHM_FEED_MAX_CHANNELS];
+};
+
+struct ShmReader {
+    const ShmFeed* feed;
+    uint64_t next;
+    uint32_t schemaVersion;
+};
+
+bool shmReaderOpen(ShmReader &r);
+int shmReaderNext(ShmReader &r, ShmSample &out);
+void shmReaderClose(ShmReader &r);
+
+#endif /* SHMREADER_H */
@@ -0,0 +1,48 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#ifndef TOOLUTIL_H
+#define TOOLUTIL_H
+
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Small helpers the command line tools share.
+ */
+
+/**
+ * True if s is longer than the suffix and ends with it.
+ */
+static inline bool hasSuffix(const std::string &s, const char* suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() > n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+/**
+ * A time argument, unix seconds or YYYY-MM-DD[THH:MM:SS[Z]] in UTC.
+ */
+static inline bool parseTime(const char* s, int64_t &t)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int n = sscanf(s, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                   &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n == 3 || n == 6) {
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        t = (int64_t)timegm(&tm);
+        return true;
+    }
+    char* end;
+    t = strtoll(s, &end, 10);
+    return *s != '\0' && *end == '\0';
+}
+
+#endif /* TOOLUTIL_H */
@@ -0,0 +1,130 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+// Receives the DataLogger udp feed (udp=1) and reports the datagram and
+// sample rates and any lost datagrams once a second. Pass -v to also
+// print every sample.
+//
+//  $ ./tools/udp_receiver [-v] [port]
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "../include/udpfeed.h"
+
+template <typename T>
+static inline const char* get(const char* p, T &v)
+{
+    memcpy(&v, p, sizeof(v));
+    return p + sizeof(v);
+}
+
+static void printRecord(const char* p, const char* end)
+{
+    uint16_t size;
+    uint64_t present;
+    int32_t cycle;
+    uint32_t wallTime;
+    float elapsed;
+    p = get(p, size);
+    p = get(p, present);
+    p = get(p, cycle);
+    p = get(p, wallTime);
+    p = get(p, elapsed);
+    printf("cycle %d  t %.3f ", cycle, elapsed);
+    for (int i = 0; i < 64 && p + sizeof(double) <= end; i++) {
+        if (!(present & ((uint64_t)1 << i)))
+            continue;
+        double v;
+        p = get(p, v);
+        printf(" %d:%.9g", i, v);
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    int port = UDP_FEED_DEFAULT_PORT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0)
+            verbose = true;
+        else
+            port = atoi(argv[i]);
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("udp_receiver: bind");
+        return 1;
+    }
+    fprintf(stderr, "listening on udp port %d\n", port);
+
+    static char buf[UDP_FEED_MAX_PAYLOAD];
+    bool first = true;
+    uint32_t expect = 0;
+    unsigned long dgrams = 0, samples = 0, lost = 0, bad = 0;
+    time_t last = time(0);
+    for (;;) {
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n < UDP_FEED_HEADER_SIZE) {
+            bad += 1;
+            continue;
+        }
+
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+        uint32_t seq;
+        const char* p = get(buf, magic);
+        p = get(p, version);
+        p = get(p, count);
+        p = get(p, seq);
+        if (magic != UDP_FEED_MAGIC || version != UDP_FEED_VERSION) {
+            bad += 1;
+            continue;
+        }
+
+        if (!first && seq != expect)
+            lost += (uint32_t)(seq - expect);
+        first = false;
+        expect = seq + 1;
+        dgrams += 1;
+        samples += count;
+
+        const char* end = buf + n;
+        for (int i = 0; i < count && p + UDP_FEED_RECORD_HEADER_SIZE <= end; i++) {
+            uint16_t size;
+            get(p, size);
+            if (size < UDP_FEED_RECORD_HEADER_SIZE || p + size > end) {
+                bad += 1;
+                break;
+            }
+            if (verbose)
+                printRecord(p, p + size);
+            p += size;
+        }
+        if (verbose)
+            fflush(stdout);
+
+        time_t now = time(0);
+        if (now != last) {
+            fprintf(stderr, "%lu datagrams/s  %lu samples/s  lost %lu  bad %lu\n",
+                    dgrams / (now - last), samples / (now - last), lost, bad);
+            dgrams = samples = 0;
+            last = now;
+        }
+    }
+}
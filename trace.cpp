@@ -0,0 +1,142 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <fstream>
+#include <atomic>
+#include <cstdio>
+#include <algorithm>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/sink.h"
+#include "./include/trace.h"
+
+using namespace std;
+
+// the sim and writer threads and a thread per sink
+#define TRACE_MAX_THREADS (MAX_SINKS + 2)
+#define TRACE_MAX_EVENTS (1 << 15)   // per thread, a power of two
+
+struct TraceEvent {
+    const char* name;
+    int64_t ts;
+    int64_t dur;
+};
+
+// a ring holding the thread's last TRACE_MAX_EVENTS events, only the
+// owning thread appends, the count of events ever recorded is published
+// with release
+struct TraceBuffer {
+    atomic<uint64_t> count;
+    TraceEvent ev[TRACE_MAX_EVENTS];
+};
+
+atomic<bool> gTracing(false);
+
+static TraceBuffer* gTraceBufs[TRACE_MAX_THREADS];
+static atomic<int> gTraceThreads(0);
+static atomic<unsigned> gTraceGen(0);
+
+static thread_local int tSlot = -1;
+static thread_local unsigned tGen = 0;
+
+/**
+ * Allocates the per-thread buffers, the hot path never allocates.
+ */
+void traceStart(void)
+{
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        if (gTraceBufs[i] == NULL)
+            gTraceBufs[i] = new TraceBuffer;
+        gTraceBufs[i]->count.store(0);
+    }
+    gTraceThreads.store(0);
+    gTraceGen.fetch_add(1);
+    gTracing.store(true);
+}
+
+/**
+ * Appends an event to the calling thread's buffer over its oldest one
+ * once it's full, a stutter late in a long session is still caught.
+ * Events are dropped once the thread slots run out.
+ */
+void traceRecord(const char* name, int64_t ts, int64_t dur)
+{
+    unsigned gen = gTraceGen.load(memory_order_relaxed);
+    if (tGen != gen) {
+        tGen = gen;
+        tSlot = gTraceThreads.fetch_add(1);
+    }
+    if (tSlot < 0 || tSlot >= TRACE_MAX_THREADS)
+        return;
+
+    TraceBuffer* b = gTraceBufs[tSlot];
+    uint64_t n = b->count.load(memory_order_relaxed);
+    TraceEvent &e = b->ev[n & (TRACE_MAX_EVENTS - 1)];
+    e.name = name;
+    e.ts = ts;
+    e.dur = dur;
+    b->count.store(n + 1, memory_order_release);
+}
+
+/**
+ * Stops recording and writes the events in Chrome trace-event format,
+ * each thread's from its oldest one still in the ring. The number of
+ * events each thread overwrote goes in the file's otherData metadata.
+ * The writer thread must have been joined.
+ */
+void traceStop(const string &file)
+{
+    if (!gTracing.exchange(false))
+        return;
+
+    ofstream fd(file, ofstream::trunc);
+    if (!fd.is_open()) {
+        LPRINTF("DataLogger Plugin: unable to open the trace file ");
+        LPRINTF(file.c_str()); LPRINTF("\n");
+        return;
+    }
+
+    fd << "{\"traceEvents\":[\n";
+    bool first = true;
+    int threads = min(gTraceThreads.load(), TRACE_MAX_THREADS);
+    if (gTraceThreads.load() > TRACE_MAX_THREADS) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "DataLogger Plugin: %d threads weren't traced\n",
+                 gTraceThreads.load() - TRACE_MAX_THREADS);
+        LPRINTF(buf);
+    }
+    string overwritten;
+    uint64_t total = 0;
+    for (int t = 0; t < threads; t++) {
+        TraceBuffer* b = gTraceBufs[t];
+        uint64_t n = b->count.load(memory_order_acquire);
+        uint64_t start = n > TRACE_MAX_EVENTS ? n - TRACE_MAX_EVENTS : 0;
+        for (uint64_t i = start; i < n; i++) {
+            const TraceEvent &e = b->ev[i & (TRACE_MAX_EVENTS - 1)];
+            char buf[192];
+            snprintf(buf, sizeof(buf),
+                     "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                     "\"pid\":1,\"tid\":%d}",
+                     first ? "" : ",\n", e.name, (long long)e.ts, (long long)e.dur, t + 1);
+            fd << buf;
+            first = false;
+        }
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%s\"%d\":%llu", t == 0 ? "" : ",", t + 1,
+                 (unsigned long long)start);
+        overwritten += buf;
+        total += start;
+    }
+    fd << "\n],\n\"otherData\":{\"overwritten\":{" << overwritten << "}}}\n";
+    if (total > 0) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "DataLogger Plugin: the trace kept the last %d events"
+                 " of each thread, %llu older ones were overwritten\n", TRACE_MAX_EVENTS,
+                 (unsigned long long)total);
+        LPRINTF(buf);
+    }
+}
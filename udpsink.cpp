@@ -0,0 +1,96 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#include "./include/defs.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/sink.h"
+#include "./include/net.h"
+#include "./include/udpfeed.h"
+#include "./include/udpsink.h"
+
+using namespace std;
+
+static size_t gPayload;
+static uint32_t gDgramSeq;
+static SinkBuffer* gCur = NULL;     // datagram being filled
+static uint16_t gCount;
+
+template <typename T>
+static inline char* put(char* p, T v)
+{
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static void endDatagram(void);
+
+/**
+ * Registers a net sink per host, all of them share the datagrams.
+ */
+bool udpSinkOpen(const string &hosts, int port, int mtu)
+{
+    gPayload = (size_t)max(UDP_FEED_HEADER_SIZE + UDP_FEED_RECORD_HEADER_SIZE +
+                           gChannelCount * 8, min(mtu, UDP_FEED_MAX_PAYLOAD));
+    gDgramSeq = 0;
+    gCur = NULL;
+    return netSinkOpen(ENC_UDP, hosts, port);
+}
+
+/**
+ * Packs the channels of the sampled groups into the current datagram.
+ */
+void udpEncode(const Sample &s, uint64_t changed)
+{
+    uint64_t present = channelsInGroups(s.groups);
+    size_t size = UDP_FEED_RECORD_HEADER_SIZE;
+    for (uint64_t m = present; m != 0; m &= m - 1)
+        size += sizeof(double);
+
+    if (gCur != NULL && gCur->len + size > gPayload)
+        endDatagram();
+    if (gCur == NULL) {
+        gCur = sinkBufferGet(0);
+        gCur->len = UDP_FEED_HEADER_SIZE;
+        gCount = 0;
+    }
+
+    char* p = gCur->data + gCur->len;
+    p = put<uint16_t>(p, (uint16_t)size);
+    p = put<uint64_t>(p, present);
+    p = put<int32_t>(p, s.cycle);
+    p = put<uint32_t>(p, (uint32_t)s.wallTime);
+    p = put<float>(p, s.elapsed);
+    for (int i = 0; i < gChannelCount; i++) {
+        if (present & CHANNEL_BIT(i))
+            p = put<double>(p, s.ch[i]);
+    }
+    gCur->len += size;
+    gCount += 1;
+}
+
+/**
+ * Sends the partly filled datagram at the end of each block so the
+ * latency is bounded by the writer's idle period.
+ */
+void udpEncodeEnd(void)
+{
+    if (gCur != NULL)
+        endDatagram();
+}
+
+void endDatagram(void)
+{
+    char* p = gCur->data;
+    p = put<uint32_t>(p, UDP_FEED_MAGIC);
+    p = put<uint16_t>(p, UDP_FEED_VERSION);
+    p = put<uint16_t>(p, gCount);
+    p = put<uint32_t>(p, gDgramSeq++);
+    sinkPublish(ENC_UDP, gCur);
+    gCur = NULL;
+}
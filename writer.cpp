@@ -0,0 +1,596 @@
+// Copyright (c) 2015 Joseph D Poirier
+// Distributable under the terms of The Simplified BSD License
+// that can be found in the LICENSE file.
+
+#include <string>
+#include <vector>
+#include <time.h>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+#include "./SDK/CHeaders/XPLM/XPLMUtilities.h"
+
+#include "./include/defs.h"
+#include "./include/msgqueue.h"
+#include "./include/gpxformat.h"
+#include "./include/config.h"
+#include "./include/channels.h"
+#include "./include/sample.h"
+#include "./include/deadband.h"
+#include "./include/sink.h"
+#include "./include/binlog.h"
+#include "./include/blockindex.h"
+#include "./include/summary.h"
+#include "./include/crc32.h"
+#include "./include/catalog.h"
+#include "./include/replace.h"
+#include "./include/stats.h"
+#include "./include/trace.h"
+#include "./include/udpsink.h"
+#include "./include/gdl90sink.h"
+#include "./include/nmeasink.h"
+#include "./include/httpd.h"
+#include "./include/sqlitesink.h"
+#include "./include/arrowsink.h"
+#include "./include/writer.h"
+
+using namespace std;
+
+/**
+ * The GPX encoder's state for a track: the last point written to its
+ * current segment. Track 0 is the user's plane, 1..MAX_TRAFFIC are the
+ * multiplayer planes, mirroring X-Plane's plane indices. Each track is
+ * a stream of buffers tagged with its index, its block index entries
+ * go out tagged with GPX_TAG_INDEX added and its summary after each
+ * entry tagged with GPX_TAG_SUMMARY added.
+ */
+#define GPX_TAG_INDEX (0x100)
+#define GPX_TAG_SUMMARY (0x200)
+struct GpxTrack {
+    SinkStream st;
+    SinkStream idx;
+    SinkStream sum;
+    IndexEntry blk;
+    SessionSummary summary;
+    double lat;
+    double lon;
+    double alt;
+    float elapsed;
+    int points;
+};
+
+/**
+ * A GPX output file, owned by the gpx sink's thread once it's started.
+ */
+struct GpxFile {
+    ofstream fd;
+    ofstream idx;
+    string path;
+    uint64_t size;
+    uint32_t crc;               // of the size bytes written
+    uint64_t blockStart;
+    SessionSummary summary;     // the last one published
+    bool summarized;
+    bool failed;
+};
+
+/**
+ * An encoding's writer thread half, end publishes the partly filled
+ * buffers at the end of each block of samples and finish runs once
+ * the last block is done.
+ */
+struct Encoder {
+    void (*encode)(const Sample &s, uint64_t changed);
+    void (*end)(void);
+    void (*finish)(void);
+};
+
+static bool openLogFile(GpxFile &file, const string &dir, const string &f,
+                        const string &t);
+static void closeLogFile(GpxFile &file);
+static void writeSummary(GpxFile &file, bool complete);
+static void writeBytes(GpxFile &file, const char* buf, size_t n);
+static void writeFileProlog(GpxFile &file, const string &t);
+static void writeFileEpilog(GpxFile &file);
+static void writeSegmentBreak(GpxTrack &trk);
+static void writeData(GpxTrack &trk, const Sample &s, double lat, double lon,
+                      double alt, const string &t);
+static void closeBlock(GpxTrack &trk);
+static void gpxEncode(const Sample &s, uint64_t changed);
+static void gpxEncodeEnd(void);
+static void gpxEncodeFinish(void);
+static void gpxWrite(Sink* s, SinkBuffer* const* bufs, int n);
+static void gpxFlush(Sink* s);
+static void gpxClose(Sink* s);
+static void writeSample(const Sample &s);
+static void writerLoop(void);
+
+SampleQueue gSampleQueue;
+
+static const Encoder gEncoders[NUM_ENCODINGS] = {
+    {gpxEncode,     gpxEncodeEnd,       gpxEncodeFinish}
+    ,{binlogEncode, binlogEncodeEnd,    binlogEncodeFinish}
+    ,{udpEncode,    udpEncodeEnd,       NULL}
+    ,{gdl90Encode,  NULL,               NULL}
+    ,{nmeaEncode,   NULL,               NULL}
+    ,{httpEncode,   NULL,               NULL}
+    ,{sqliteEncode, sqliteEncodeEnd,    NULL}
+    ,{arrowEncode,  NULL,               arrowEncodeFinish}
+};
+
+static GpxTrack gTracks[1 + MAX_TRAFFIC];
+// bit i is set once track i appends, until the block ends
+static uint32_t gAppended;
+static GpxFile gFiles[1 + MAX_TRAFFIC];
+static DeadbandState gDeadband;
+static int gLastCycle;
+static string gSessionDir;
+static string gSessionTime;
+static thread gWriter;
+static atomic<bool> gWriterRun(false);
+
+/**
+ * Opens the session file, registers the sinks and starts the writer
+ * thread. If the file can't be created in dir it falls back to the
+ * X-Plane root and clears dir.
+ */
+bool writerStart(string &dir)
+{
+    if (gWriterRun.load())
+        writerStop();
+
+    if (gConfig.trace)
+        traceStart();
+    gSessionTime = gpxDateTime(time(0), true);
+    string f = string("DataLog-") + gSessionTime + string(".gpx");
+    if (!openLogFile(gFiles[0], dir, f, gSessionTime)) {
+        LPRINTF("DataLogger Plugin: trying to open the base file...\n");
+        if (!openLogFile(gFiles[0], "", f, gSessionTime)) {
+            LPRINTF("DataLogger Plugin: couldn't open the base file either...\n");
+            gTracing.store(false);
+            return false;
+        }
+        dir = "";
+    }
+    gSessionDir = dir;
+    memset(&gDeadband, 0, sizeof(gDeadband));
+    gLastCycle = -1;
+    gAppended = 0;
+    for (int i = 0; i < 1 + MAX_TRAFFIC; i++) {
+        GpxTrack &trk = gTracks[i];
+        trk.st.encoding = ENC_GPX;
+        trk.st.tag = (uint32_t)i;
+        trk.st.cur = NULL;
+        trk.idx.encoding = ENC_GPX;
+        trk.idx.tag = (uint32_t)i + GPX_TAG_INDEX;
+        trk.idx.cur = NULL;
+        trk.sum.encoding = ENC_GPX;
+        trk.sum.tag = (uint32_t)i + GPX_TAG_SUMMARY;
+        trk.sum.cur = NULL;
+        blockIndexReset(trk.blk);
+        summaryReset(trk.summary);
+        trk.points = 0;
+        gFiles[i].summarized = false;
+        gFiles[i].failed = false;
+    }
+    sinkCreate(ENC_GPX, gConfig.policy[ENC_GPX], NULL, gpxWrite, gpxFlush,
+               gpxClose);
+
+    if (gConfig.binary)
+        binlogOpen(dir + string("DataLog-") + gSessionTime + string(".dlb"));
+    if (gConfig.udp)
+        udpSinkOpen(gConfig.udpHost, gConfig.udpPort, gConfig.udpMtu);
+    if (gConfig.gdl90)
+        gdl90SinkOpen(gConfig.gdl90Host, gConfig.gdl90Port);
+    if (gConfig.nmea)
+        nmeaSinkOpen(gConfig.nmeaDevice, gConfig.nmeaBaud, gConfig.nmeaRate);
+    if (gConfig.arrow)
+        arrowSinkOpen(dir + string("DataLog-") + gSessionTime + string(".arrow"));
+    if (gConfig.sqlite)
+        sqliteSinkOpen(gConfig.sqliteFile.empty() ? dir + SQLITE_DEFAULT_FILE : gConfig.sqliteFile,
+                       gSessionTime);
+    if (gConfig.http)
+        httpSinkOpen(dir + f, gConfig.binary ? dir + string("DataLog-") + gSessionTime + string(".dlb") : "",
+                     gConfig.httpRate);
+    sinkStartAll();
+
+    // stale samples from a previous session
+    while (gSampleQueue.front() != NULL)
+        gSampleQueue.pop();
+
+    gWriterRun.store(true);
+    gWriter = thread(writerLoop);
+    return true;
+}
+
+/**
+ * Drains the queue, stops the writer thread and then the sinks, which
+ * close all files.
+ */
+void writerStop(void)
+{
+    gWriterRun.store(false);
+    if (gWriter.joinable())
+        gWriter.join();
+    sinkStopAll();
+    traceStop(gSessionDir + string("DataLog-") + gSessionTime + string("-trace.json"));
+}
+
+/**
+ *
+ */
+#define WRITER_IDLE_MS (20)
+void writerLoop(void)
+{
+    for (;;) {
+        // read the flag first so the queue is drained once more on stop
+        bool run = gWriterRun.load();
+        Sample* s;
+        int n = 0;
+        while ((s = gSampleQueue.front()) != NULL) {
+            writeSample(*s);
+            gSampleQueue.pop();
+            n += 1;
+        }
+        if (n > 0) {
+            // hand each block to the sinks, a sim crash then loses at
+            // most one block
+            TRACE_SCOPE("writer.publish");
+            for (int e = 0; e < NUM_ENCODINGS; e++) {
+                if (gEncoders[e].end != NULL && sinkSubscribed(e))
+                    gEncoders[e].end();
+            }
+        }
+        if (!run)
+            break;
+        this_thread::sleep_for(chrono::milliseconds(WRITER_IDLE_MS));
+    }
+    for (int e = 0; e < NUM_ENCODINGS; e++) {
+        if (gEncoders[e].finish != NULL && sinkSubscribed(e))
+            gEncoders[e].finish();
+    }
+}
+
+/**
+ * Runs a sample through every encoding that has a sink.
+ */
+void writeSample(const Sample &s)
+{
+    // the cycle number is an exact duplicate key, the same frame
+    // can't hold new data
+    if (s.cycle == gLastCycle)
+        return;
+    gLastCycle = s.cycle;
+
+    uint64_t moved = channelsMoved(gDeadband, s.ch, gConfig.deadAbs,
+                                   gConfig.deadRel);
+    uint64_t changed = deadbandCommit(gDeadband, s.ch, moved,
+                                      channelsInGroups(s.groups),
+                                      gChannelCount);
+    for (int e = 0; e < NUM_ENCODINGS; e++) {
+        if (sinkSubscribed(e))
+            gEncoders[e].encode(s, changed);
+    }
+    statsAdd(gStats.written, 1);
+    int64_t lag = statsTickUs() - s.tick;
+    gStats.writerLagMs.store(lag / 1000.0f, memory_order_relaxed);
+    statsObserve(gStats.writerLagUs, gLatencyBoundsUs, (uint64_t)lag);
+}
+
+/**
+ * Demultiplexes a sample into the per-aircraft tracks.
+ */
+void gpxEncode(const Sample &s, uint64_t changed)
+{
+    if (!(s.groups & GROUP_BIT(GROUP_POSITION)))
+        return;
+
+    // the wall clock has one second resolution, format it once per change
+    static time_t lastTime = 0;
+    static string t;
+    if (s.wallTime != lastTime) {
+        lastTime = s.wallTime;
+        t = gpxDateTime(s.wallTime, false);
+    }
+
+    summarySpeed(gTracks[0].summary, s.ch[CH_GS]);
+    if (s.flags & SAMPLE_NEW_SEGMENT)
+        writeSegmentBreak(gTracks[0]);
+    const uint64_t pos = CHANNEL_BIT(CH_LAT) | CHANNEL_BIT(CH_LON) | CHANNEL_BIT(CH_ALT);
+    if (changed & pos)
+        writeData(gTracks[0], s, s.ch[CH_LAT], s.ch[CH_LON], s.ch[CH_ALT], t);
+
+    // traffic is also sampled for the gdl-90 reports
+    int traffic = gConfig.traffic ? s.trafficCount : 0;
+    for (int i = 0; i < traffic; i++) {
+        // unused multiplayer slots sit at the origin
+        if (s.trafficLat[i] == 0.0 && s.trafficLon[i] == 0.0)
+            continue;
+        writeData(gTracks[i + 1], s, s.trafficLat[i], s.trafficLon[i],
+                  s.trafficAlt[i], t);
+    }
+}
+
+/**
+ * Publishes the tracks that appended since the last block.
+ */
+void gpxEncodeEnd(void)
+{
+    for (uint32_t m = gAppended; m != 0; m &= m - 1) {
+        int i = 0;
+        while (!(m & (1u << i)))
+            i++;
+        sinkEnd(gTracks[i].st);
+    }
+    gAppended = 0;
+}
+
+/**
+ *
+ */
+void gpxEncodeFinish(void)
+{
+    for (int i = 0; i < 1 + MAX_TRAFFIC; i++)
+        closeBlock(gTracks[i]);
+}
+
+/**
+ * Publishes the block's points, then its entry and the track's summary,
+ * so the sink thread sees both once the whole block is in the file.
+ */
+void closeBlock(GpxTrack &trk)
+{
+    if (trk.blk.count == 0)
+        return;
+    sinkEnd(trk.st);
+    sinkAppend(trk.idx, (const char*)&trk.blk, sizeof(trk.blk));
+    sinkEnd(trk.idx);
+    sinkAppend(trk.sum, (const char*)&trk.summary, sizeof(trk.summary));
+    sinkEnd(trk.sum);
+    blockIndexReset(trk.blk);
+}
+
+/**
+ * Appends each buffer to its track's file, a multiplayer plane's file
+ * is created with its first point. An index entry covers the file's
+ * bytes since the previous one.
+ */
+void gpxWrite(Sink* s, SinkBuffer* const* bufs, int n)
+{
+    for (int i = 0; i < n; i++) {
+        uint32_t track = bufs[i]->tag % GPX_TAG_INDEX;
+        GpxFile &file = gFiles[track];
+        if (bufs[i]->tag >= GPX_TAG_SUMMARY) {
+            if (file.fd.is_open()) {
+                memcpy(&file.summary, bufs[i]->data, sizeof(file.summary));
+                file.summarized = true;
+                writeSummary(file, false);
+            }
+            continue;
+        }
+        if (bufs[i]->tag >= GPX_TAG_INDEX) {
+            if (file.fd.is_open()) {
+                blockIndexWrite(file.idx, file.path + string(".idx"),
+                                bufs[i]->data, file.blockStart, file.size);
+                file.blockStart = file.size;
+            }
+            continue;
+        }
+        if (!file.fd.is_open()) {
+            if (file.failed)
+                continue;
+            char id[8];
+            snprintf(id, sizeof(id), "-AI%02u", track);
+            string f = string("DataLog-") + gSessionTime + id + string(".gpx");
+            if (!openLogFile(file, gSessionDir, f, gSessionTime)) {
+                file.failed = true;
+                continue;
+            }
+        }
+        writeBytes(file, bufs[i]->data, bufs[i]->len);
+    }
+}
+
+/**
+ * Hands every open track and its index to the OS each block.
+ */
+void gpxFlush(Sink* s)
+{
+    for (int i = 0; i < 1 + MAX_TRAFFIC; i++) {
+        if (gFiles[i].fd.is_open())
+            gFiles[i].fd.flush();
+        if (gFiles[i].idx.is_open())
+            gFiles[i].idx.flush();
+    }
+}
+
+/**
+ * Closes the session's tracks and adds them to the directory's catalog.
+ */
+void gpxClose(Sink* s)
+{
+    vector<CatalogEntry> entries;
+    for (int i = 0; i < 1 + MAX_TRAFFIC; i++) {
+        GpxFile &file = gFiles[i];
+        closeLogFile(file);
+        if (!file.summarized)
+            continue;
+        CatalogEntry e;
+        memset(&e, 0, sizeof(e));
+        size_t slash = file.path.find_last_of("/\\");
+        string name = slash == string::npos ? file.path : file.path.substr(slash + 1);
+        if (name.size() >= CATALOG_NAME_SIZE ||
+            !catalogStat(file.path, e.size, e.mtime))
+            continue;
+        memcpy(e.name, name.c_str(), name.size());
+        e.crc = file.crc;
+        e.flags = CATALOG_COMPLETE | (i > 0 ? CATALOG_TRAFFIC : 0);
+        e.summary = file.summary;
+        entries.push_back(e);
+    }
+    if (!entries.empty() && !catalogUpdate(gSessionDir + CATALOG_FILE, entries)) {
+        LPRINTF("DataLogger Plugin: unable to update the catalog ");
+        LPRINTF((gSessionDir + CATALOG_FILE).c_str()); LPRINTF("\n");
+    }
+}
+
+/**
+ *
+ */
+bool openLogFile(GpxFile &file, const string &dir, const string &f,
+                 const string &t)
+{
+    TRACE_SCOPE("file.open");
+    if (file.fd.is_open())
+        closeLogFile(file);
+
+    string path = dir + f;
+
+    // LPRINTF(path.c_str()); LPRINTF("\n");
+
+    // truncated, the sizes and the .idx offsets start from the prolog
+    file.fd.open(path, ofstream::trunc);
+    if (!file.fd.is_open()) {
+        msgPost("DataLogger Plugin: unable to open the output file %s\n", path.c_str());
+        return false;
+    }
+    file.path = path;
+    file.size = 0;
+    file.crc = 0;
+    file.summarized = false;
+    statsAddShared(gStats.filesOpened, 1);
+    writeFileProlog(file, t);
+    file.blockStart = file.size;
+    return true;
+}
+
+/**
+ *
+ */
+void closeLogFile(GpxFile &file)
+{
+    TRACE_SCOPE("file.close");
+    if (file.fd.is_open()) {
+        writeFileEpilog(file);
+        file.fd.close();
+        if (file.summarized)
+            writeSummary(file, true);
+    }
+    if (file.idx.is_open())
+        file.idx.close();
+}
+
+/**
+ * Replaces the summary sidecar, through a temporary file so a reader
+ * never sees half of one.
+ */
+void writeSummary(GpxFile &file, bool complete)
+{
+    TRACE_SCOPE("file.summary");
+    size_t slash = file.path.find_last_of("/\\");
+    string name = slash == string::npos ? file.path : file.path.substr(slash + 1);
+    string json = summaryJson(file.summary, name, file.size, file.crc, complete);
+
+    string path = file.path + string(SUMMARY_SUFFIX);
+    string tmp = path + string(".tmp");
+    ofstream fd(tmp, ofstream::binary | ofstream::trunc);
+    if (!fd.is_open()) {
+        msgPost("DataLogger Plugin: unable to open the summary file %s\n", tmp.c_str());
+        return;
+    }
+    fd.write(json.data(), json.size());
+    fd.close();
+    if (!replaceFile(tmp, path))
+        msgPost("DataLogger Plugin: unable to replace the summary file %s\n", path.c_str());
+    statsAddShared(gStats.bytesWritten, json.size());
+}
+
+/**
+ * All GPX output goes through here so the byte counters stay exact.
+ */
+void writeBytes(GpxFile &file, const char* buf, size_t n)
+{
+    file.fd.write(buf, n);
+    file.size += n;
+    file.crc = crc32Update(file.crc, buf, n);
+    statsAddShared(gStats.bytesWritten, n);
+    if (&file == &gFiles[0])
+        gStats.fileSize.store(file.size, memory_order_relaxed);
+}
+
+/**
+ *
+ */
+void writeFileProlog(GpxFile &file, const string &t)
+{
+    string s = gpxProlog(t);
+    writeBytes(file, s.data(), s.size());
+}
+
+/**
+ *
+ */
+void writeFileEpilog(GpxFile &file)
+{
+    static const char epilog[] = GPX_EPILOG;
+    writeBytes(file, epilog, sizeof(epilog) - 1);
+}
+
+/**
+ * Closes the current track segment and opens a new one, e.g. after
+ * a reposition, so consumers never see a straight line across the jump.
+ */
+void writeSegmentBreak(GpxTrack &trk)
+{
+    static const char brk[] = GPX_SEGMENT_BREAK;
+    if (trk.points == 0)
+        return;
+    sinkAppend(trk.st, brk, sizeof(brk) - 1);
+    gAppended |= 1u << trk.st.tag;
+    trk.blk.length += sizeof(brk) - 1;
+    trk.points = 0;
+}
+
+/**
+ *
+ */
+void writeData(GpxTrack &trk, const Sample &s, double lat, double lon,
+               double alt, const string &t)
+{
+    float elapsed = s.elapsed;
+    TRACE_SCOPE("gpx.format");
+    if (trk.points > 0) {
+        if (lat == trk.lat && lon == trk.lon && alt == trk.alt)
+            return;
+
+        if (gpxTeleport(trk.lat, trk.lon, trk.elapsed, lat, lon, elapsed)) {
+            msgPost("DataLogger Plugin: position jump, new track segment...\n");
+            writeSegmentBreak(trk);
+        }
+    }
+
+    bool first = trk.points == 0;
+    trk.lat = lat;
+    trk.lon = lon;
+    trk.alt = alt;
+    trk.elapsed = elapsed;
+    trk.points += 1;
+
+    char buf[GPX_POINT_SIZE];
+    size_t n = gpxPoint(buf, lat, lon, alt, t.c_str());
+    if (n > 0) {
+        sinkAppend(trk.st, buf, n);
+        gAppended |= 1u << trk.st.tag;
+        summaryAdd(trk.summary, (uint32_t)s.wallTime, elapsed, lat, lon, alt,
+                   first);
+        blockIndexAdd(trk.blk, (uint32_t)s.wallTime, elapsed, s.cycle);
+        blockIndexPosition(trk.blk, lat, lon, alt);
+        trk.blk.length += n;
+        if (blockIndexFull(trk.blk))
+            closeBlock(trk);
+    }
+}